@@ -4,28 +4,62 @@
 
 TEMPLATE = app
 TARGET = 
+QT += network
 DEPENDPATH += . src src/RayTracing
 INCLUDEPATH += . src/RayTracing src
 
+# GCC 12+ vectorises only trivial loops at -O2, inner loops of Denoiser need the full cost model
+*-g++*: QMAKE_CXXFLAGS_RELEASE += -ftree-vectorize -fvect-cost-model=dynamic
+
 # Input
 HEADERS += src/RayTracingRenderingWidget.h \
            src/RayTracingSettingsPanel.h \
+           src/RenderServer.h \
            src/SceneSetterWidget.h \
            src/Space2DDrawer.h \
+           src/TileFarm.h \
            src/VectorCamWidget.h \
+           src/RayTracing/AnimationRenderer.h \
+           src/RayTracing/BoundingHierarchy.h \
+           src/RayTracing/BudgetRenderer.h \
            src/RayTracing/Camera.h \
+           src/RayTracing/CameraPath.h \
+           src/RayTracing/Denoiser.h \
            src/RayTracing/DetailedSpaces.h \
+           src/RayTracing/ImageWriter.h \
+           src/RayTracing/Log.h \
+           src/RayTracing/Rasterizer.h \
            src/RayTracing/RayTracing.h \
+           src/RayTracing/RegionRenderer.h \
+           src/RayTracing/RenderJob.h \
+           src/RayTracing/SceneFile.h \
            src/RayTracing/Space2D.h \
-           src/RayTracing/Space3D.h
+           src/RayTracing/Space3D.h \
+           src/RayTracing/TaskGroup.h \
+           src/RayTracing/TiledRenderer.h
 SOURCES += src/main.cpp \
            src/RayTracingRenderingWidget.cpp \
            src/RayTracingSettingsPanel.cpp \
+           src/RenderServer.cpp \
            src/SceneSetterWidget.cpp \
            src/Space2DDrawer.cpp \
+           src/TileFarm.cpp \
            src/VectorCamWidget.cpp \
+           src/RayTracing/AnimationRenderer.cpp \
+           src/RayTracing/BoundingHierarchy.cpp \
+           src/RayTracing/BudgetRenderer.cpp \
            src/RayTracing/Camera.cpp \
+           src/RayTracing/CameraPath.cpp \
+           src/RayTracing/Denoiser.cpp \
            src/RayTracing/DetailedSpaces.cpp \
+           src/RayTracing/ImageWriter.cpp \
+           src/RayTracing/Log.cpp \
+           src/RayTracing/Rasterizer.cpp \
            src/RayTracing/RayTracing.cpp \
+           src/RayTracing/RegionRenderer.cpp \
+           src/RayTracing/RenderJob.cpp \
+           src/RayTracing/SceneFile.cpp \
            src/RayTracing/Space2D.cpp \
-           src/RayTracing/Space3D.cpp
+           src/RayTracing/Space3D.cpp \
+           src/RayTracing/TaskGroup.cpp \
+           src/RayTracing/TiledRenderer.cpp
@@ -0,0 +1,109 @@
+#include "AnimationRenderer.h"
+
+#include "Log.h"
+
+#include <QMutexLocker>
+#include <QRunnable>
+
+#include <algorithm>
+#include <cstdio>
+
+namespace {
+	const unsigned int ROWSPERTASK = 8;	//rows rendered by one task
+}
+
+//renders some rows of a frame
+class FrameRowsTask : public QRunnable {
+public:
+	FrameRowsTask(AnimationRenderer & renderer, AnimationRenderer::Frame & frame, const unsigned int firstRow, const unsigned int endRow)
+		: renderer(renderer), frame(frame), firstRow(firstRow), endRow(endRow) {}
+	void run() {renderer.renderRows(frame, firstRow, endRow);}
+private:
+	AnimationRenderer & renderer;
+	AnimationRenderer::Frame & frame;
+	const unsigned int firstRow, endRow;
+};
+//--------------------------------------AnimationRenderer----------------------------------------------------------------
+AnimationRenderer::AnimationRenderer() : finishedFrames(0), cancelled(0) {
+	framesInFlight = 2;
+	timer.start();
+}
+void AnimationRenderer::setFramesInFlight(const unsigned int frames)	{framesInFlight = std::max(frames, 1u);}
+bool AnimationRenderer::render(const RayTracerCam & cam, const CameraPath & path, const QString & fileName) {
+	finishedFrames.fetchAndStoreOrdered(0);
+	cancelled.fetchAndStoreOrdered(0);
+	timer.start();
+	const unsigned int total = path.getFrameCount();
+	frames.resize(std::min(framesInFlight, total));
+	for(unsigned int i=0; i<frames.size(); i++) startFrame(frames[i], cam, path, i);
+
+	bool ok = true;
+	for(unsigned int i=0; i<total; i++) {
+		Frame & frame = frames[i % frames.size()];
+		{
+			QMutexLocker locker(&lock);
+			while(frame.tasksLeft) rowsDone.wait(&lock);
+		}
+		if(cancelled.fetchAndAddOrdered(0) || ! writeFrame(frame, getFrameFileName(fileName, i))) {
+			ok = false;
+			break;
+		}
+		finishedFrames.fetchAndAddOrdered(1);
+		LOG_INFO("frame " << i << " written, " << getFramesPerHour() << " frames/hour");
+		if(i + frames.size() < total) startFrame(frame, cam, path, i + frames.size());
+	}
+	cancelled.fetchAndStoreOrdered(1);	//tasks still queued return at once
+	tasks.wait();
+	std::vector<Frame>().swap(frames);
+	return ok;
+}
+void AnimationRenderer::cancel()						{cancelled.fetchAndStoreOrdered(1);}
+unsigned int AnimationRenderer::getFinishedFrames() const	{return finishedFrames.fetchAndAddOrdered(0);}
+float AnimationRenderer::getFramesPerHour() const {
+	const qint64 ms = std::max(timer.elapsed(), (qint64)1);
+	return getFinishedFrames() * 3600000.0f / ms;
+}
+QString AnimationRenderer::getFrameFileName(const QString & fileName, const unsigned int frame) {
+	char number[16];
+	std::sprintf(number, "%04u", frame);
+	const int dot = fileName.lastIndexOf('.');
+	const int slash = std::max(fileName.lastIndexOf('/'), fileName.lastIndexOf('\\'));
+	if(dot <= slash) return fileName + number;	//no extension
+	return fileName.left(dot) + number + fileName.mid(dot);
+}
+//privates:
+void AnimationRenderer::startFrame(Frame & frame, const RayTracerCam & cam, const CameraPath & path, const unsigned int number) {
+	frame.cam = cam;
+	frame.cam.setPrimaryCache(false);	//each frame is seen from a different place
+	path.setCamera(frame.cam, number);
+	frame.number = number;
+	const unsigned int height = cam.getYres();
+	frame.rgb.resize((size_t)cam.getXres()*height*3);
+	frame.tasksLeft = (height + ROWSPERTASK-1) / ROWSPERTASK;
+	for(unsigned int y=0; y<height; y+=ROWSPERTASK) tasks.start(new FrameRowsTask(*this, frame, y, std::min(y+ROWSPERTASK, height)));
+}
+void AnimationRenderer::renderRows(Frame & frame, const unsigned int firstRow, const unsigned int endRow) {
+	if(! cancelled.fetchAndAddOrdered(0)) {
+		const int width = frame.cam.getXres();
+		const int height = frame.cam.getYres();
+		float * out = &frame.rgb[(size_t)firstRow*width*3];
+		for(int y=firstRow; y<(int)endRow; y++) {
+			for(int x=0; x<width; x++) {
+				const Color c = frame.cam.calcColor(x - width/2, height/2 - y);
+				*out++ = c.getR();
+				*out++ = c.getG();
+				*out++ = c.getB();
+			}
+		}
+	}
+	QMutexLocker locker(&lock);
+	if(! --frame.tasksLeft) rowsDone.wakeAll();
+}
+bool AnimationRenderer::writeFrame(const Frame & frame, const QString & fileName) const {
+	ImageWriter * writer = ImageWriter::create(fileName);
+	const bool ok = writer->open(fileName, frame.cam.getXres(), frame.cam.getYres())
+		&& writer->writeRows(&frame.rgb[0], frame.cam.getYres())
+		&& writer->close();
+	delete writer;
+	return ok;
+}
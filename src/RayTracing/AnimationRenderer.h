@@ -0,0 +1,83 @@
+/**
+ * @file AnimationRenderer.h
+ * @brief rendering frame sequences along a CameraPath
+ */
+
+#ifndef ANIMATIONRENDERER_H
+#define ANIMATIONRENDERER_H
+
+#include "CameraPath.h"
+#include "ImageWriter.h"
+#include "TaskGroup.h"
+
+#include <QAtomicInt>
+#include <QElapsedTimer>
+#include <QMutex>
+#include <QWaitCondition>
+
+#include <vector>
+
+/**
+ * @brief Renders each frame of a CameraPath into its own file, with one space and hierarchy for all frames.
+ *
+ * Rows of several frames are rendered by the shared thread pool (TaskGroup): rows of the next frame are queued before the current one is finished,
+ * so threads don't wait while the last rows of a frame are rendered or while a frame is written (calling thread writes the files).
+ * Space has to be built before render(): hierarchies are shared by all frames, they are not rebuilt.
+ */
+class AnimationRenderer {
+public:
+	/** @brief Constructs a renderer with 2 frames in memory.*/
+	AnimationRenderer();
+
+	/** @brief Setter for number of frames rendered at the same time, at least 2 to avoid gaps between frames.*/
+	void setFramesInFlight(const unsigned int frames);
+
+	/**
+	 * @brief Renders all frames of path, returns when they are written.
+	 *
+	 * @param cam camera with the space, resolution, angle of view and density of frames, its position, direction, focus and depth of field are set by path
+	 * @param path movement of camera
+	 * @param fileName name of files: frame number is inserted before extension (see getFrameFileName()), extension gives format (see ImageWriter::create())
+	 * @return false if a file can not be written or cancel() was called
+	 */
+	bool render(const RayTracerCam & cam, const CameraPath & path, const QString & fileName);
+
+	/** @brief Stops render() as soon as the rows being rendered finish. Can be called from any thread.*/
+	void cancel();
+
+	/** @brief Frames written by the current render(), can be called from any thread.*/
+	unsigned int getFinishedFrames() const;
+
+	/** @brief Speed of the last render() (or the current one so far).*/
+	float getFramesPerHour() const;
+
+	/** @brief Name of file of a frame: e.g. anim.pfm -> anim0042.pfm.*/
+	static QString getFrameFileName(const QString & fileName, const unsigned int frame);
+private:
+	//a frame being rendered
+	struct Frame {
+		RayTracerCam cam;
+		std::vector<float> rgb;
+		unsigned int number;
+		unsigned int tasksLeft;	//protected by lock
+	};
+
+	unsigned int framesInFlight;
+	std::vector<Frame> frames;
+	mutable QAtomicInt finishedFrames;
+	QAtomicInt cancelled;
+	QElapsedTimer timer;	//time since start of render()
+	QMutex lock;
+	QWaitCondition rowsDone;
+	TaskGroup tasks;
+
+	friend class FrameRowsTask;
+	void startFrame(Frame & frame, const RayTracerCam & cam, const CameraPath & path, const unsigned int number);	//starts tasks of all rows of frame
+	void renderRows(Frame & frame, const unsigned int firstRow, const unsigned int endRow);
+	bool writeFrame(const Frame & frame, const QString & fileName) const;
+
+	AnimationRenderer(const AnimationRenderer &);	//tasks refer to renderer
+	void operator=(const AnimationRenderer &);
+};
+
+#endif
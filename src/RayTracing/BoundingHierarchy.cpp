@@ -0,0 +1,1103 @@
+#include "BoundingHierarchy.h"
+#include "TaskGroup.h"
+
+#include <QAtomicInt>
+#include <QElapsedTimer>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QRunnable>
+#include <QWaitCondition>
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
+
+namespace {
+	const unsigned int LEAFSIZE = 4;	//nodes with less primitives are not split (median and Morton splits)
+	const unsigned int MAXLEAFSIZE = 8;	//SAH makes a leaf from nodes with at most this many primitives if checking them is cheaper than splitting
+	const unsigned int MAXDEPTH = 64;	//deeper nodes are split at median => depth of tree is at most 64 + log2 of number of primitives
+	const unsigned int STACKSIZE = 128;	//depth of traversal stack
+	const unsigned int BINS = 16;	//number of split positions checked by SAH on each axis
+	const unsigned int TASKSIZE = 4096;	//subtrees with more primitives are built by another thread
+	const unsigned int PARALLELSIZE = 65536;	//nodes with more primitives are binned and partitioned by several threads
+	const unsigned int CHUNKSIZE = 16384;	//number of primitives handled by one thread when a node is split by several threads
+	const unsigned int MORTONBITS = 10;	//bits of each coordinate in Morton code
+	const unsigned int LAZYLEVELS = 6;	//a lazy build splits this many levels at once, then leaves the nodes unsplit
+	enum LazyState {SPLIT, UNSPLIT, SPLITTING};	//state of a node of a lazy build
+	const unsigned int LEAFFLAG = 1u << 31;	//reference of CompactNodes is a leaf
+	const unsigned int FIRSTBITS = 28;	//bits of first position in the reference of a leaf
+	const float TRAVERSALCOST = 1;	//cost of checking box of a node
+	const float CROSSCOST = 1;	//cost of checking a primitive
+
+	float coord(const Vect3D v, const int axis) {
+		if(axis == 0) return v.getX();
+		if(axis == 1) return v.getY();
+		return v.getZ();
+	}
+
+	int longestAxis(const Box3D box) {
+		const Vect3D d = box.getMax() - box.getMin();
+		int axis = 0;
+		if(d.getY() > coord(d,axis)) axis = 1;
+		if(d.getZ() > coord(d,axis)) axis = 2;
+		return axis;
+	}
+
+	//orders indices of primitives by center of their box along an axis
+	class CenterLess {
+	public:
+		CenterLess(const std::vector<Vect3D> & centers, const int axis) : centers(centers), axis(axis) {}
+		bool operator()(const unsigned int a, const unsigned int b) const {
+			return coord(centers[a],axis) < coord(centers[b],axis);
+		}
+	private:
+		const std::vector<Vect3D> & centers;
+		int axis;
+	};
+
+	//orders indices of primitives by their Morton code
+	class CodeLess {
+	public:
+		CodeLess(const std::vector<unsigned int> & codes) : codes(codes) {}
+		bool operator()(const unsigned int a, const unsigned int b) const {return codes[a] < codes[b];}
+	private:
+		const std::vector<unsigned int> & codes;
+	};
+
+	//primitives whose center falls into a slice of a node
+	class Bin {
+	public:
+		Bin() {count = 0;}
+		void add(const Box3D box, const Vect3D center) {
+			this->box.extend(box);
+			cbox.extend(center);
+			count++;
+		}
+		void add(const Bin o) {
+			box.extend(o.box);
+			cbox.extend(o.cbox);
+			count += o.count;
+		}
+		Box3D box;	//box of primitives
+		Box3D cbox;	//box of centers of primitives
+		unsigned int count;
+	};
+
+	//position of a center among bins of a node along an axis
+	class Binner {
+	public:
+		Binner() {}
+		Binner(const Box3D cbox) {
+			min = cbox.getMin();
+			const Vect3D d = cbox.getMax() - min;
+			const float k = BINS * 0.9999f;	//so the max corner is still in the last bin
+			scale.set(d.getX() > 0 ? k/d.getX() : 0, d.getY() > 0 ? k/d.getY() : 0, d.getZ() > 0 ? k/d.getZ() : 0);
+		}
+		unsigned int bin(const Vect3D center, const int axis) const {
+			const unsigned int result = (unsigned int)((coord(center,axis) - coord(min,axis)) * coord(scale,axis));
+			return std::min(result, BINS-1);
+		}
+	private:
+		Vect3D min, scale;
+	};
+
+	//puts 2 zero bits between the lowest 10 bits of v
+	unsigned int spreadBits(unsigned int v) {
+		v = (v | (v << 16)) & 0x030000FF;
+		v = (v | (v << 8)) & 0x0300F00F;
+		v = (v | (v << 4)) & 0x030C30C3;
+		v = (v | (v << 2)) & 0x09249249;
+		return v;
+	}
+
+	//work that is split into chunks - each chunk can be done by a different thread
+	class ChunkJob {
+	public:
+		virtual ~ChunkJob() {}
+		virtual void run(const unsigned int chunk) = 0;
+	};
+
+	class ChunkTask : public QRunnable {
+	public:
+		ChunkTask(ChunkJob & job, const unsigned int chunk) : job(job), chunk(chunk) {}
+		void run() {job.run(chunk);}
+	private:
+		ChunkJob & job;
+		const unsigned int chunk;
+	};
+
+	//runs all chunks of job on the shared pool and waits for them - calling thread runs the first chunk
+	void parallelFor(ChunkJob & job, const unsigned int chunks) {
+		TaskGroup group;
+		for(unsigned int c=1; c<chunks; c++) group.start(new ChunkTask(job,c));
+		job.run(0);
+		group.wait();
+	}
+
+	unsigned int chunksOf(const unsigned int count) {return (count + CHUNKSIZE-1) / CHUNKSIZE;}
+
+	//entry of the traversal stack of a compressed hierarchy: reference and decoded box
+	//only plain members, so the stack is not initialized at each traversal
+	class CompactEntry {
+	public:
+		void set(const unsigned int ref, const Box3D box) {
+			this->ref = ref;
+			const Vect3D bmin = box.getMin(), bmax = box.getMax();
+			for(int axis=0; axis<3; axis++) {
+				min[axis] = coord(bmin,axis);
+				max[axis] = coord(bmax,axis);
+			}
+		}
+		Box3D getBox() const {return Box3D(Vect3D(min[0],min[1],min[2]), Vect3D(max[0],max[1],max[2]));}
+		unsigned int ref;
+		float min[3], max[3];
+	};
+}
+
+/**
+ * @brief Builds nodes of a BoundingHierarchy using all threads of the shared pool.
+ *
+ * Nodes are allocated from a preallocated list by an atomic counter, so threads building different subtrees don't need to lock anything.
+ * Children are always allocated after their parent, the box of a node is set by its parent.
+ * A lazy builder is kept by the hierarchy: it leaves nodes unsplit at every LAZYLEVELS depth and splits them later by expand().
+ */
+class HierarchyBuilder {
+public:
+	HierarchyBuilder(BoundingHierarchy & hierarchy, const std::vector<Box3D> & boxes, const BoundingHierarchy::BuildMethod method, const bool lazy);
+	HierarchyBuilder(BoundingHierarchy & hierarchy, const std::vector<Box3D> & boxes, const HierarchyBuilder & o);	//copies state of lazy build o for a copy of its hierarchy
+	void build();
+	void split(const unsigned int node, const unsigned int first, const unsigned int count, const Box3D box, const Box3D cbox, const unsigned int depth, const bool onCaller);
+	void expand(const unsigned int node);	//splits an unsplit node of lazy build
+	void updateCenters();	//after boxes changed
+	void reorder(const std::vector<unsigned int> & order);	//after primitives were moved to order
+	unsigned int getUsed() const;
+
+	BoundingHierarchy & hierarchy;
+	const std::vector<Box3D> & boxes;
+	const BoundingHierarchy::BuildMethod method;
+	const bool lazy;
+	std::vector<Vect3D> centers;	//centers of boxes
+	std::vector<unsigned int> codes;	//Morton codes of centers
+	std::vector<unsigned int> scratch;	//target of parallel partitioning
+	std::vector<QAtomicInt> states;	//lazy build: LazyState of each node
+	std::vector<unsigned int> depths;	//lazy build: depth of each unsplit node
+private:
+	TaskGroup subtrees;
+	mutable QAtomicInt used;	//number of allocated nodes
+
+	unsigned int allocate();	//allocates 2 nodes, returns index of first
+	void leaf(const unsigned int node, const unsigned int first, const unsigned int count);
+	void child(const unsigned int node, const unsigned int first, const unsigned int count, const Box3D box, const Box3D cbox, const unsigned int depth, const bool onCaller);
+	void splitSAH(const unsigned int node, const unsigned int first, const unsigned int count, const Box3D box, const Box3D cbox, const unsigned int depth, const bool onCaller);
+	void splitMedian(const unsigned int node, const unsigned int first, const unsigned int count, const Box3D cbox, const unsigned int depth, const bool onCaller);
+	void splitMorton(const unsigned int node, const unsigned int first, const unsigned int count, const unsigned int depth, const bool onCaller);
+};
+
+/** @brief State of a lazy build kept by the hierarchy: copy of boxes and the builder that splits the rest of the nodes.*/
+class LazyBuild {
+public:
+	LazyBuild(BoundingHierarchy & hierarchy, const std::vector<Box3D> & boxes, const BoundingHierarchy::BuildMethod method) : boxes(boxes), builder(hierarchy, this->boxes, method, true) {}
+	LazyBuild(BoundingHierarchy & hierarchy, const LazyBuild & o) : boxes(o.boxes), builder(hierarchy, boxes, o.builder) {}
+
+	std::vector<Box3D> boxes;
+	HierarchyBuilder builder;
+	QMutex lock;	//only for waiting on a node that another thread splits
+	QWaitCondition nodeSplit;
+};
+
+namespace {
+	//builds a subtree on a thread of the shared pool
+	class SubtreeTask : public QRunnable {
+	public:
+		SubtreeTask(HierarchyBuilder & builder, const unsigned int node, const unsigned int first, const unsigned int count, const Box3D box, const Box3D cbox, const unsigned int depth)
+			: builder(builder), node(node), first(first), count(count), box(box), cbox(cbox), depth(depth) {}
+		void run() {builder.split(node, first, count, box, cbox, depth, false);}
+	private:
+		HierarchyBuilder & builder;
+		const unsigned int node, first, count;
+		const Box3D box, cbox;
+		const unsigned int depth;
+	};
+
+	//centers of boxes, box of each chunk and box of centers of each chunk
+	class CenterJob : public ChunkJob {
+	public:
+		CenterJob(HierarchyBuilder & builder, const unsigned int chunks) : builder(builder), boxes(chunks), cboxes(chunks) {}
+		void run(const unsigned int chunk) {
+			const unsigned int end = std::min((chunk+1)*CHUNKSIZE, (unsigned int)builder.boxes.size());
+			for(unsigned int i=chunk*CHUNKSIZE; i<end; i++) {
+				builder.centers[i] = builder.boxes[i].getCenter();
+				boxes[chunk].extend(builder.boxes[i]);
+				cboxes[chunk].extend(builder.centers[i]);
+			}
+		}
+		HierarchyBuilder & builder;
+		std::vector<Box3D> boxes, cboxes;
+	};
+
+	//Morton codes of centers
+	class CodeJob : public ChunkJob {
+	public:
+		CodeJob(HierarchyBuilder & builder, const Box3D cbox) : builder(builder), min(cbox.getMin()) {
+			const Vect3D d = cbox.getMax() - min;
+			const float k = ((1 << MORTONBITS) - 1);
+			scale.set(d.getX() > 0 ? k/d.getX() : 0, d.getY() > 0 ? k/d.getY() : 0, d.getZ() > 0 ? k/d.getZ() : 0);
+		}
+		void run(const unsigned int chunk) {
+			const unsigned int end = std::min((chunk+1)*CHUNKSIZE, (unsigned int)builder.centers.size());
+			for(unsigned int i=chunk*CHUNKSIZE; i<end; i++) {
+				const Vect3D c = builder.centers[i] - min;
+				const unsigned int x = c.getX()*scale.getX();
+				const unsigned int y = c.getY()*scale.getY();
+				const unsigned int z = c.getZ()*scale.getZ();
+				builder.codes[i] = (spreadBits(x) << 2) | (spreadBits(y) << 1) | spreadBits(z);
+			}
+		}
+	private:
+		HierarchyBuilder & builder;
+		Vect3D min, scale;
+	};
+
+	//bins of each chunk of a node
+	class BinJob : public ChunkJob {
+	public:
+		BinJob(const HierarchyBuilder & builder, const std::vector<unsigned int> & indices, const unsigned int first, const unsigned int count, const Binner binner, const unsigned int chunkSize)
+			: builder(builder), indices(indices), first(first), count(count), binner(binner), chunkSize(chunkSize), bins((count + chunkSize-1) / chunkSize * 3*BINS) {}
+		void run(const unsigned int chunk) {
+			Bin * cbins = &bins[chunk*3*BINS];
+			const unsigned int end = first + std::min((chunk+1)*chunkSize, count);
+			for(unsigned int i=first+chunk*chunkSize; i<end; i++) {
+				const unsigned int prim = indices[i];
+				const Vect3D center = builder.centers[prim];
+				for(int axis=0; axis<3; axis++) cbins[axis*BINS + binner.bin(center,axis)].add(builder.boxes[prim], center);
+			}
+		}
+		const HierarchyBuilder & builder;
+		const std::vector<unsigned int> & indices;
+		const unsigned int first, count;
+		const Binner binner;
+		const unsigned int chunkSize;
+		std::vector<Bin> bins;	//3*BINS for each chunk
+	};
+
+	//moves primitives of each chunk to the left or right part of scratch, then copies scratch back
+	class PartitionJob : public ChunkJob {
+	public:
+		PartitionJob(HierarchyBuilder & builder, std::vector<unsigned int> & indices, const unsigned int first, const unsigned int count, const Binner binner, const int axis, const unsigned int splitBin, const std::vector<unsigned int> & leftOffsets, const std::vector<unsigned int> & rightOffsets)
+			: builder(builder), indices(indices), first(first), count(count), binner(binner), axis(axis), splitBin(splitBin), leftOffsets(leftOffsets), rightOffsets(rightOffsets) {copyBack = false;}
+		void run(const unsigned int chunk) {
+			const unsigned int begin = first + chunk*CHUNKSIZE;
+			const unsigned int end = first + std::min((chunk+1)*CHUNKSIZE, count);
+			if(copyBack) {
+				std::copy(builder.scratch.begin()+begin, builder.scratch.begin()+end, indices.begin()+begin);
+				return;
+			}
+			unsigned int left = first + leftOffsets[chunk];
+			unsigned int right = first + rightOffsets[chunk];
+			for(unsigned int i=begin; i<end; i++) {
+				if(binner.bin(builder.centers[indices[i]],axis) <= splitBin) builder.scratch[left++] = indices[i];
+				else builder.scratch[right++] = indices[i];
+			}
+		}
+		bool copyBack;	//second pass
+	private:
+		HierarchyBuilder & builder;
+		std::vector<unsigned int> & indices;
+		const unsigned int first, count;
+		const Binner binner;
+		const int axis;
+		const unsigned int splitBin;
+		const std::vector<unsigned int> & leftOffsets;
+		const std::vector<unsigned int> & rightOffsets;
+	};
+
+	//splits primitives by bin along an axis
+	class BinPredicate {
+	public:
+		BinPredicate(const std::vector<Vect3D> & centers, const Binner binner, const int axis, const unsigned int splitBin) : centers(centers), binner(binner), axis(axis), splitBin(splitBin) {}
+		bool operator()(const unsigned int prim) const {return binner.bin(centers[prim],axis) <= splitBin;}
+	private:
+		const std::vector<Vect3D> & centers;
+		const Binner binner;
+		const int axis;
+		const unsigned int splitBin;
+	};
+}
+//--------------------------------------HierarchyBuilder----------------------------------------------------------------
+HierarchyBuilder::HierarchyBuilder(BoundingHierarchy & hierarchy, const std::vector<Box3D> & boxes, const BoundingHierarchy::BuildMethod method, const bool lazy)
+	: hierarchy(hierarchy), boxes(boxes), method(method), lazy(lazy) {}
+HierarchyBuilder::HierarchyBuilder(BoundingHierarchy & hierarchy, const std::vector<Box3D> & boxes, const HierarchyBuilder & o)
+	: hierarchy(hierarchy), boxes(boxes), method(o.method), lazy(o.lazy), centers(o.centers), codes(o.codes), states(o.states), depths(o.depths) {
+	used.fetchAndStoreOrdered(o.getUsed());
+}
+void HierarchyBuilder::build() {
+	const unsigned int n = boxes.size();
+	std::vector<unsigned int> & indices = hierarchy.indices;
+	std::vector<BoundingNode> & nodes = hierarchy.nodes;
+	indices.resize(n);
+	for(unsigned int i=0; i<n; i++) indices[i] = i;
+	nodes.clear();
+	if(! n) return;
+
+	nodes.resize(2*n-1);	//binary tree with n leaves has at most 2n-1 nodes
+	centers.resize(n);
+	scratch.resize(n);
+	used.fetchAndStoreOrdered(1);	//root
+	if(lazy) {
+		states.resize(nodes.size());
+		depths.resize(nodes.size());
+	}
+
+	const unsigned int chunks = chunksOf(n);
+	CenterJob centerJob(*this, chunks);
+	parallelFor(centerJob, chunks);
+	Box3D box, cbox;
+	for(unsigned int c=0; c<chunks; c++) {
+		box.extend(centerJob.boxes[c]);
+		cbox.extend(centerJob.cboxes[c]);
+	}
+
+	if(method == BoundingHierarchy::MORTON) {
+		codes.resize(n);
+		CodeJob codeJob(*this, cbox);
+		parallelFor(codeJob, chunks);
+		std::sort(indices.begin(), indices.end(), CodeLess(codes));
+	}
+
+	nodes[0].setBox(box);
+	split(0, 0, n, box, cbox, 0, true);
+	subtrees.wait();
+	scratch.clear();
+	if(lazy) return;	//the rest of nodes are used by expand()
+
+	nodes.resize(getUsed());
+	centers.clear();
+	codes.clear();
+	if(method == BoundingHierarchy::MORTON) hierarchy.refit(boxes);	//Morton splits don't calculate boxes
+}
+void HierarchyBuilder::split(const unsigned int node, const unsigned int first, const unsigned int count, const Box3D box, const Box3D cbox, const unsigned int depth, const bool onCaller) {
+	if(method == BoundingHierarchy::MORTON) splitMorton(node, first, count, depth, onCaller);
+	else splitSAH(node, first, count, box, cbox, depth, onCaller);
+}
+void HierarchyBuilder::expand(const unsigned int node) {
+	const BoundingNode & n = hierarchy.nodes[node];
+	const unsigned int first = n.getFirst();
+	const unsigned int count = n.getCount();
+	Box3D cbox;
+	if(method != BoundingHierarchy::MORTON)
+		for(unsigned int i=first; i<first+count; i++) cbox.extend(centers[hierarchy.indices[i]]);
+	split(node, first, count, n.getBox(), cbox, depths[node], false);
+}
+void HierarchyBuilder::updateCenters() {
+	for(unsigned int i=0; i<boxes.size(); i++) centers[i] = boxes[i].getCenter();
+}
+void HierarchyBuilder::reorder(const std::vector<unsigned int> & order) {
+	std::vector<unsigned int> oldCodes(codes);
+	for(unsigned int i=0; i<order.size(); i++) {
+		centers[i] = boxes[i].getCenter();
+		if(! codes.empty()) codes[i] = oldCodes[order[i]];
+	}
+}
+unsigned int HierarchyBuilder::getUsed() const	{return used.fetchAndAddOrdered(0);}
+//privates:
+unsigned int HierarchyBuilder::allocate()	{return used.fetchAndAddOrdered(2);}
+void HierarchyBuilder::leaf(const unsigned int node, const unsigned int first, const unsigned int count) {
+	hierarchy.nodes[node].setLeaf(first, count);
+}
+void HierarchyBuilder::child(const unsigned int node, const unsigned int first, const unsigned int count, const Box3D box, const Box3D cbox, const unsigned int depth, const bool onCaller) {
+	if(lazy && depth % LAZYLEVELS == 0 && count > MAXLEAFSIZE) {
+		//node is published as a leaf and split when a traversal reaches it
+		leaf(node, first, count);
+		depths[node] = depth;
+		states[node].fetchAndStoreOrdered(UNSPLIT);
+		return;
+	}
+
+	//calling thread keeps the big nodes so it can split them with the help of the pool
+	//lazy build doesn't start tasks: expand() runs on threads of traversal that don't wait for subtrees
+	const bool big = onCaller && count >= PARALLELSIZE;
+	if(count >= TASKSIZE && ! big && ! lazy) subtrees.start(new SubtreeTask(*this, node, first, count, box, cbox, depth));
+	else split(node, first, count, box, cbox, depth, onCaller);
+}
+void HierarchyBuilder::splitSAH(const unsigned int node, const unsigned int first, const unsigned int count, const Box3D box, const Box3D cbox, const unsigned int depth, const bool onCaller) {
+	if(count == 1) {
+		leaf(node, first, count);
+		return;
+	}
+	const float area = box.area();
+	if(depth >= MAXDEPTH || area <= 0) {
+		splitMedian(node, first, count, cbox, depth, onCaller);
+		return;
+	}
+
+	//binning: for each axis the node is sliced into BINS parts by the centers of primitives
+	std::vector<unsigned int> & indices = hierarchy.indices;
+	const Binner binner(cbox);
+	const bool parallel = onCaller && count >= PARALLELSIZE;
+	const unsigned int chunks = parallel ? chunksOf(count) : 1;
+	BinJob binJob(*this, indices, first, count, binner, parallel ? CHUNKSIZE : count);
+	if(parallel) parallelFor(binJob, chunks);
+	else binJob.run(0);
+	Bin bins[3*BINS];
+	for(unsigned int c=0; c<chunks; c++)
+		for(unsigned int b=0; b<3*BINS; b++) bins[b].add(binJob.bins[c*3*BINS + b]);
+
+	//cost of splitting after each bin: area of left side * number of primitives on left side + same for right side
+	int bestAxis = -1;
+	unsigned int bestBin = 0;
+	float bestCost = std::numeric_limits<float>::infinity();
+	const Vect3D d = cbox.getMax() - cbox.getMin();
+	for(int axis=0; axis<3; axis++) {
+		if(coord(d,axis) <= 0) continue;	//all centers are on the same position
+		const Bin * abins = &bins[axis*BINS];
+		float rightCosts[BINS];	//rightCosts[i]: cost of bins after i
+		Bin right;
+		for(unsigned int b=BINS-1; b>0; b--) {
+			right.add(abins[b]);
+			rightCosts[b-1] = right.box.area() * right.count;
+		}
+		Bin left;
+		for(unsigned int b=0; b<BINS-1; b++) {
+			left.add(abins[b]);
+			if(! left.count || left.count == count) continue;	//one side would be empty
+			const float cost = left.box.area() * left.count + rightCosts[b];
+			if(cost >= bestCost) continue;
+			bestCost = cost;
+			bestAxis = axis;
+			bestBin = b;
+		}
+	}
+	if(bestAxis < 0) {
+		splitMedian(node, first, count, cbox, depth, onCaller);
+		return;
+	}
+	const float splitCost = TRAVERSALCOST + bestCost / area * CROSSCOST;
+	if(count <= MAXLEAFSIZE && count*CROSSCOST <= splitCost) {
+		leaf(node, first, count);
+		return;
+	}
+
+	//boxes of children are known from bins => no need to walk primitives again
+	Bin left, right;
+	for(unsigned int b=0; b<BINS; b++) {
+		if(b <= bestBin) left.add(bins[bestAxis*BINS + b]);
+		else right.add(bins[bestAxis*BINS + b]);
+	}
+
+	if(parallel) {
+		//each chunk knows from its bins where its primitives go
+		std::vector<unsigned int> leftOffsets(chunks), rightOffsets(chunks);
+		unsigned int leftPos = 0, rightPos = left.count;
+		for(unsigned int c=0; c<chunks; c++) {
+			leftOffsets[c] = leftPos;
+			rightOffsets[c] = rightPos;
+			for(unsigned int b=0; b<BINS; b++) {
+				const unsigned int binCount = binJob.bins[c*3*BINS + bestAxis*BINS + b].count;
+				if(b <= bestBin) leftPos += binCount;
+				else rightPos += binCount;
+			}
+		}
+		PartitionJob partitionJob(*this, indices, first, count, binner, bestAxis, bestBin, leftOffsets, rightOffsets);
+		parallelFor(partitionJob, chunks);
+		partitionJob.copyBack = true;
+		parallelFor(partitionJob, chunks);
+	} else std::partition(indices.begin()+first, indices.begin()+first+count, BinPredicate(centers, binner, bestAxis, bestBin));
+
+	const unsigned int l = allocate();
+	hierarchy.nodes[node].setInner(l);
+	hierarchy.nodes[l].setBox(left.box);
+	hierarchy.nodes[l+1].setBox(right.box);
+	child(l, first, left.count, left.box, left.cbox, depth+1, onCaller);
+	child(l+1, first+left.count, right.count, right.box, right.cbox, depth+1, onCaller);
+}
+void HierarchyBuilder::splitMedian(const unsigned int node, const unsigned int first, const unsigned int count, const Box3D cbox, const unsigned int depth, const bool onCaller) {
+	if(count <= LEAFSIZE) {
+		leaf(node, first, count);
+		return;
+	}
+
+	//splitting along the longest side of centers - at the median, so the tree is balanced
+	//if all centers are at the same position, order doesn't matter: primitives are simply halved
+	std::vector<unsigned int> & indices = hierarchy.indices;
+	const int axis = longestAxis(cbox);
+	const unsigned int half = count/2;
+	if(coord(cbox.getMax() - cbox.getMin(), axis) > 0)
+		std::nth_element(indices.begin()+first, indices.begin()+first+half, indices.begin()+first+count, CenterLess(centers,axis));
+
+	Bin left, right;
+	for(unsigned int i=first; i<first+count; i++) {
+		if(i < first+half) left.add(boxes[indices[i]], centers[indices[i]]);
+		else right.add(boxes[indices[i]], centers[indices[i]]);
+	}
+
+	const unsigned int l = allocate();
+	hierarchy.nodes[node].setInner(l);
+	hierarchy.nodes[l].setBox(left.box);
+	hierarchy.nodes[l+1].setBox(right.box);
+	child(l, first, half, left.box, left.cbox, depth+1, onCaller);
+	child(l+1, first+half, count-half, right.box, right.cbox, depth+1, onCaller);
+}
+void HierarchyBuilder::splitMorton(const unsigned int node, const unsigned int first, const unsigned int count, const unsigned int depth, const bool onCaller) {
+	//boxes are calculated by a refit after all nodes are built, except for lazy build where unsplit nodes need their box
+	if(count <= LEAFSIZE) {
+		leaf(node, first, count);
+		return;
+	}
+
+	//primitives are ordered by code => the first one where the highest differing bit of the range is set starts the right child
+	const std::vector<unsigned int> & indices = hierarchy.indices;
+	const unsigned int a = codes[indices[first]];
+	const unsigned int b = codes[indices[first+count-1]];
+	unsigned int half = count/2;	//if all codes are the same, primitives are simply halved
+	if(a != b) {
+		unsigned int bit = 1u << 31;
+		while(! ((a^b) & bit)) bit >>= 1;
+		unsigned int lo = first, hi = first+count-1;	//codes[hi] has the bit set
+		while(lo < hi) {
+			const unsigned int mid = (lo+hi)/2;
+			if(codes[indices[mid]] & bit) hi = mid;
+			else lo = mid+1;
+		}
+		half = lo - first;
+	}
+
+	const unsigned int l = allocate();
+	Box3D left, right;
+	if(lazy) {
+		for(unsigned int i=first; i<first+half; i++) left.extend(boxes[indices[i]]);
+		for(unsigned int i=first+half; i<first+count; i++) right.extend(boxes[indices[i]]);
+	}
+	hierarchy.nodes[node].setInner(l);
+	hierarchy.nodes[l].setBox(left);
+	hierarchy.nodes[l+1].setBox(right);
+	child(l, first, half, left, Box3D(), depth+1, onCaller);
+	child(l+1, first+half, count-half, right, Box3D(), depth+1, onCaller);
+}
+//--------------------------------------CompactNodes----------------------------------------------------------------
+CompactNodes::CompactNodes()	{clear(8);}
+void CompactNodes::clear(const unsigned int bits) {
+	this->bits = bits;
+	maxq = (1u << bits) - 1;
+	recordSize = 12*bits/8 + 2*sizeof(unsigned int);
+	std::vector<unsigned char>().swap(data);
+}
+void CompactNodes::reserve(const unsigned int records)	{data.reserve(records*recordSize);}
+unsigned int CompactNodes::add() {
+	data.resize(data.size() + recordSize);
+	return size()-1;
+}
+void CompactNodes::setRef(const unsigned int record, const unsigned int i, const unsigned int ref) {
+	std::memcpy(&data[record*recordSize + 12*bits/8 + i*sizeof(unsigned int)], &ref, sizeof(unsigned int));
+}
+Box3D CompactNodes::setBox(const unsigned int record, const unsigned int i, const Box3D parent, const Box3D box) {
+	const Vect3D pmin = parent.getMin(), pmax = parent.getMax();
+	const Vect3D bmin = box.getMin(), bmax = box.getMax();
+	float lo[3], hi[3];
+	for(int axis=0; axis<3; axis++) {
+		const float min = coord(pmin,axis), max = coord(pmax,axis);
+		const float b0 = coord(bmin,axis), b1 = coord(bmax,axis);
+
+		//rounded outwards, then corrected where rounding of float operations would cut into box
+		unsigned int q0 = 0, q1 = maxq;
+		if(max > min) {
+			const float f0 = std::floor((b0 - min) / (max - min) * maxq);
+			const float f1 = std::ceil((b1 - min) / (max - min) * maxq);
+			q0 = f0 <= 0 ? 0 : f0 >= maxq ? maxq : (unsigned int)f0;
+			q1 = f1 <= 0 ? 0 : f1 >= maxq ? maxq : (unsigned int)f1;
+		}
+		while(q0 > 0 && decode(min,max,q0) > b0) q0--;
+		while(q1 < maxq && decode(min,max,q1) < b1) q1++;
+
+		setQ(record, i*6 + axis, q0);
+		setQ(record, i*6 + 3 + axis, q1);
+		lo[axis] = decode(min,max,q0);
+		hi[axis] = decode(min,max,q1);
+	}
+	return Box3D(Vect3D(lo[0],lo[1],lo[2]), Vect3D(hi[0],hi[1],hi[2]));
+}
+unsigned int CompactNodes::getRef(const unsigned int record, const unsigned int i) const {
+	unsigned int result;
+	std::memcpy(&result, &data[record*recordSize + 12*bits/8 + i*sizeof(unsigned int)], sizeof(unsigned int));
+	return result;
+}
+Box3D CompactNodes::getBox(const unsigned int record, const unsigned int i, const Box3D parent) const {
+	const Vect3D pmin = parent.getMin(), pmax = parent.getMax();
+	float lo[3], hi[3];
+	for(int axis=0; axis<3; axis++) {
+		lo[axis] = decode(coord(pmin,axis), coord(pmax,axis), getQ(record, i*6 + axis));
+		hi[axis] = decode(coord(pmin,axis), coord(pmax,axis), getQ(record, i*6 + 3 + axis));
+	}
+	return Box3D(Vect3D(lo[0],lo[1],lo[2]), Vect3D(hi[0],hi[1],hi[2]));
+}
+unsigned int CompactNodes::size() const			{return data.size() / recordSize;}
+std::size_t CompactNodes::getMemory() const		{return data.capacity();}
+unsigned int CompactNodes::leafRef(const unsigned int first, const unsigned int count)	{return LEAFFLAG | ((count-1) << FIRSTBITS) | first;}
+bool CompactNodes::isLeaf(const unsigned int ref)			{return ref & LEAFFLAG;}
+unsigned int CompactNodes::getFirst(const unsigned int ref)	{return ref & ((1u << FIRSTBITS) - 1);}
+unsigned int CompactNodes::getCount(const unsigned int ref)	{return ((ref >> FIRSTBITS) & 7) + 1;}
+//privates:
+unsigned int CompactNodes::getQ(const unsigned int record, const unsigned int pos) const {
+	const unsigned char * q = &data[record*recordSize];
+	if(bits == 8) return q[pos];
+	unsigned short result;
+	std::memcpy(&result, q + pos*sizeof(unsigned short), sizeof(unsigned short));
+	return result;
+}
+void CompactNodes::setQ(const unsigned int record, const unsigned int pos, const unsigned int q) {
+	unsigned char * d = &data[record*recordSize];
+	if(bits == 8) {
+		d[pos] = q;
+		return;
+	}
+	const unsigned short value = q;
+	std::memcpy(d + pos*sizeof(unsigned short), &value, sizeof(unsigned short));
+}
+float CompactNodes::decode(const float min, const float max, const unsigned int q) const {
+	//exactly min at 0 and exactly max at maxq
+	const float t = (float)q / maxq;
+	return min*(1-t) + max*t;
+}
+//--------------------------------------BoundingNode----------------------------------------------------------------
+BoundingNode::BoundingNode() {first = 0; count = 0;}
+void BoundingNode::setLeaf(const unsigned int first, const unsigned int count) {
+	this->first = first;
+	this->count = count;
+}
+void BoundingNode::setInner(const unsigned int left) {
+	this->first = left;
+	this->count = 0;
+}
+void BoundingNode::setBox(const Box3D box)		{this->box = box;}
+bool BoundingNode::isLeaf() const				{return count;}
+Box3D BoundingNode::getBox() const				{return box;}
+unsigned int BoundingNode::getFirst() const		{return first;}
+unsigned int BoundingNode::getCount() const		{return count;}
+//--------------------------------------BoundingHierarchy----------------------------------------------------------------
+BoundingHierarchy::BoundingHierarchy() {
+	buildCost = 0;
+	buildTime = 0;
+	lazy = 0;
+	compressed = false;
+	compactBits = 0;
+	compactRoot = 0;
+}
+BoundingHierarchy::BoundingHierarchy(const BoundingHierarchy & o) {
+	lazy = 0;
+	*this = o;
+}
+BoundingHierarchy & BoundingHierarchy::operator=(const BoundingHierarchy & o) {
+	if(this == &o) return *this;
+	nodes = o.nodes;
+	indices = o.indices;
+	buildCost = o.buildCost;
+	buildTime = o.buildTime;
+	compressed = o.compressed;
+	compactBits = o.compactBits;
+	compact = o.compact;
+	compactRoot = o.compactRoot;
+	compactBox = o.compactBox;
+	delete lazy;
+	lazy = o.lazy ? new LazyBuild(*this, *o.lazy) : 0;
+	return *this;
+}
+BoundingHierarchy::~BoundingHierarchy()	{delete lazy;}
+void BoundingHierarchy::build(const std::vector<Box3D> & boxes, const BuildMethod method, const bool lazy) {
+	QElapsedTimer timer;
+	timer.start();
+	delete this->lazy;
+	this->lazy = 0;
+	compressed = false;
+	compact.clear(8);
+	if(lazy) {
+		this->lazy = new LazyBuild(*this, boxes, method);
+		this->lazy->builder.build();
+	} else HierarchyBuilder(*this, boxes, method, false).build();
+	buildCost = getCost();
+	buildTime = timer.nsecsElapsed() / 1000000.0;
+}
+void BoundingHierarchy::refit(const std::vector<Box3D> & boxes) {
+	if(lazy) {
+		//unsplit nodes will be split by the new boxes
+		lazy->boxes = boxes;
+		lazy->builder.updateCenters();
+	}
+
+	if(compressed) {
+		//exact boxes of children of records: records are stored after their parent => walking backwards visits children first
+		std::vector<Box3D> exact(2*compact.size());
+		for(unsigned int r=compact.size(); r-- > 0; ) {
+			for(unsigned int c=0; c<2; c++) {
+				const unsigned int ref = compact.getRef(r,c);
+				Box3D box;
+				if(CompactNodes::isLeaf(ref)) {
+					const unsigned int end = CompactNodes::getFirst(ref) + CompactNodes::getCount(ref);
+					for(unsigned int i=CompactNodes::getFirst(ref); i<end; i++) box.extend(boxes[indices[i]]);
+				} else {
+					box.extend(exact[2*ref]);
+					box.extend(exact[2*ref+1]);
+				}
+				exact[2*r+c] = box;
+			}
+		}
+		compactBox = Box3D();
+		if(compact.size()) {
+			compactBox.extend(exact[0]);
+			compactBox.extend(exact[1]);
+		} else {
+			const unsigned int end = CompactNodes::getFirst(compactRoot) + CompactNodes::getCount(compactRoot);
+			for(unsigned int i=CompactNodes::getFirst(compactRoot); i<end; i++) compactBox.extend(boxes[indices[i]]);
+		}
+		encode(exact);
+		return;
+	}
+
+	//children are always stored after their parent => walking backwards visits children first
+	for(unsigned int n=size(); n-- > 0; ) {
+		BoundingNode & node = nodes[n];
+		Box3D box;
+		if(node.isLeaf()) {
+			const unsigned int end = node.getFirst() + node.getCount();
+			for(unsigned int i=node.getFirst(); i<end; i++) box.extend(boxes[indices[i]]);
+		} else {
+			box.extend(nodes[node.getFirst()].getBox());
+			box.extend(nodes[node.getFirst()+1].getBox());
+		}
+		node.setBox(box);
+	}
+}
+bool BoundingHierarchy::compress(const unsigned int bits) {
+	if(compressed) return bits == compactBits;
+	if(isEmpty() || indices.size() >= (1u << FIRSTBITS)) return false;
+	expandAll();
+	for(unsigned int n=0; n<nodes.size(); n++)
+		if(nodes[n].isLeaf() && nodes[n].getCount() > 8) return false;
+
+	//inner nodes in the order of nodes => records of children come after the record of their parent
+	compact.clear(bits);
+	compact.reserve(nodes.size()/2);	//a binary tree has one less inner node than leaves
+	std::vector<unsigned int> records(nodes.size());
+	for(unsigned int n=0; n<nodes.size(); n++)
+		if(! nodes[n].isLeaf()) records[n] = compact.add();
+	std::vector<Box3D> exact(2*compact.size());
+	for(unsigned int n=0; n<nodes.size(); n++) {
+		if(nodes[n].isLeaf()) continue;
+		for(unsigned int c=0; c<2; c++) {
+			const BoundingNode & child = nodes[nodes[n].getFirst() + c];
+			const unsigned int ref = child.isLeaf() ? CompactNodes::leafRef(child.getFirst(), child.getCount()) : records[nodes[n].getFirst() + c];
+			compact.setRef(records[n], c, ref);
+			exact[2*records[n] + c] = child.getBox();
+		}
+	}
+	compactRoot = nodes[0].isLeaf() ? CompactNodes::leafRef(nodes[0].getFirst(), nodes[0].getCount()) : 0;
+	compactBox = nodes[0].getBox();
+	encode(exact);
+
+	compressed = true;
+	compactBits = bits;
+	std::vector<BoundingNode>().swap(nodes);
+	buildCost = getCost();	//quantized boxes are a bit bigger
+	return true;
+}
+bool BoundingHierarchy::isCompressed() const	{return compressed;}
+unsigned int BoundingHierarchy::getCompression() const	{return compressed ? compactBits : 0;}
+std::size_t BoundingHierarchy::getMemory() const {
+	return nodes.capacity()*sizeof(BoundingNode) + indices.capacity()*sizeof(unsigned int) + compact.getMemory();
+}
+float BoundingHierarchy::getCost() const {
+	if(isEmpty()) return 0;
+	if(compressed) {
+		const float rootArea = compactBox.area();
+		if(! rootArea) return 0;
+		if(CompactNodes::isLeaf(compactRoot)) return CompactNodes::getCount(compactRoot) * CROSSCOST;
+
+		std::vector<Box3D> decoded(compact.size());	//decoded box of each record
+		decoded[0] = compactBox;
+		float result = TRAVERSALCOST;	//root
+		for(unsigned int r=0; r<compact.size(); r++) {
+			for(unsigned int c=0; c<2; c++) {
+				const unsigned int ref = compact.getRef(r,c);
+				const Box3D box = compact.getBox(r, c, decoded[r]);
+				const float prob = box.area() / rootArea;
+				if(CompactNodes::isLeaf(ref)) result += prob * CompactNodes::getCount(ref) * CROSSCOST;
+				else {
+					decoded[ref] = box;
+					result += prob * TRAVERSALCOST;
+				}
+			}
+		}
+		return result;
+	}
+
+	const float rootArea = nodes[0].getBox().area();
+	if(! rootArea) return 0;
+
+	float result = 0;
+	for(unsigned int n=0; n<size(); n++) {
+		const float prob = nodes[n].getBox().area() / rootArea;	//probability of a line crossing root to cross node
+		if(nodes[n].isLeaf()) result += prob * nodes[n].getCount() * CROSSCOST;
+		else result += prob * TRAVERSALCOST;
+	}
+	return result;
+}
+float BoundingHierarchy::getBuildCost() const	{return buildCost;}
+float BoundingHierarchy::getBuildTime() const	{return buildTime;}
+std::vector<unsigned int> BoundingHierarchy::reorder() {
+	std::vector<unsigned int> order(indices);
+	for(unsigned int i=0; i<indices.size(); i++) indices[i] = i;
+	if(lazy) {
+		//unsplit nodes are split by the primitives in their new order
+		const std::vector<Box3D> boxes(lazy->boxes);
+		for(unsigned int i=0; i<order.size(); i++) lazy->boxes[i] = boxes[order[i]];
+		lazy->builder.reorder(order);
+	}
+	return order;
+}
+bool BoundingHierarchy::isLazy() const			{return lazy;}
+bool BoundingHierarchy::isEmpty() const			{return ! compressed && nodes.empty();}
+Box3D BoundingHierarchy::getBox() const {
+	if(compressed) return compactBox;
+	return isEmpty() ? Box3D() : nodes[0].getBox();
+}
+unsigned int BoundingHierarchy::size() const {
+	if(compressed) return 2*compact.size() + 1;
+	return lazy ? lazy->builder.getUsed() : nodes.size();
+}
+bool BoundingHierarchy::traverse(const Line3D line, const float tmin, float tmax, HierarchyVisitor & visitor) const {
+	if(isEmpty()) return false;
+	if(compressed) return traverseCompact(line, tmin, tmax, visitor);
+	const Vect3D p = line.getP();
+	const Vect3D inv = inverse(line.getV());
+	const float inf = std::numeric_limits<float>::infinity();
+
+	unsigned int stack[STACKSIZE];
+	unsigned int top = 0;
+	stack[top++] = 0;
+	while(top) {
+		const unsigned int index = stack[--top];
+		const BoundingNode & node = nodes[index];
+		if(node.getBox().distsign(p,inv,tmin,tmax) == inf) continue;	//tmax may have decreased since node was pushed
+		if(lazy) expand(index);
+
+		if(node.isLeaf()) {
+			const unsigned int end = node.getFirst() + node.getCount();
+			for(unsigned int i=node.getFirst(); i<end; i++)
+				if(visitor.visit(indices[i], tmax)) return true;
+			continue;
+		}
+
+		//closer child is visited first => it is pushed last
+		const unsigned int left = node.getFirst();
+		const float tleft = nodes[left].getBox().distsign(p,inv,tmin,tmax);
+		const float tright = nodes[left+1].getBox().distsign(p,inv,tmin,tmax);
+		if(tleft <= tright) {
+			if(tright != inf) stack[top++] = left+1;
+			if(tleft != inf) stack[top++] = left;
+		} else {
+			if(tleft != inf) stack[top++] = left;
+			stack[top++] = left+1;
+		}
+	}
+	return false;
+}
+unsigned int BoundingHierarchy::traverse(const std::vector<Line3D> & lines, const float tmin, const float tmax, std::vector<bool> & done, HierarchyGroupVisitor & visitor) const {
+	if(isEmpty()) return 0;
+	if(compressed) return traverseCompact(lines, tmin, tmax, done, visitor);
+	const float inf = std::numeric_limits<float>::infinity();
+
+	std::vector<Vect3D> invs(lines.size());
+	for(unsigned int l=0; l<lines.size(); l++) invs[l] = inverse(lines[l].getV());
+	const unsigned int start = std::count(done.begin(), done.end(), false);
+	unsigned int open = start;	//number of lines that are not done, visitor tells how many it finished
+
+	unsigned int stack[STACKSIZE];
+	unsigned int top = 0;
+	stack[top++] = 0;
+	while(top && open) {
+		const unsigned int index = stack[--top];
+		const BoundingNode & node = nodes[index];
+
+		bool crossed = false;	//true if any open line crosses node
+		for(unsigned int l=0; l<lines.size() && !crossed; l++)
+			if(! done[l] && node.getBox().distsign(lines[l].getP(),invs[l],tmin,tmax) != inf) crossed = true;
+		if(! crossed) continue;
+		if(lazy) expand(index);
+
+		if(node.isLeaf()) {
+			const unsigned int end = node.getFirst() + node.getCount();
+			for(unsigned int i=node.getFirst(); i<end && open; i++) open -= visitor.visit(indices[i], done);
+			continue;
+		}
+		stack[top++] = node.getFirst()+1;
+		stack[top++] = node.getFirst();
+	}
+	return start - open;
+}
+void BoundingHierarchy::traverse(HierarchyRegionVisitor & visitor) const {
+	if(isEmpty()) return;
+	if(compressed) {
+		traverseCompact(visitor);
+		return;
+	}
+
+	unsigned int stack[STACKSIZE];
+	bool inside[STACKSIZE];	//node is under a node that is inside region
+	unsigned int top = 0;
+	stack[top] = 0;
+	inside[top++] = false;
+	while(top) {
+		top--;
+		const unsigned int index = stack[top];
+		bool in = inside[top];
+		const BoundingNode & node = nodes[index];
+		if(! in) {
+			const Frustum3D::Overlap overlap = visitor.overlap(node.getBox());
+			if(overlap == Frustum3D::OUTSIDE) continue;
+			in = overlap == Frustum3D::INSIDE;
+		}
+		if(lazy) expand(index);
+
+		if(node.isLeaf()) {
+			const unsigned int end = node.getFirst() + node.getCount();
+			for(unsigned int i=node.getFirst(); i<end; i++) visitor.visit(indices[i], in);
+			continue;
+		}
+		stack[top] = node.getFirst()+1;
+		inside[top++] = in;
+		stack[top] = node.getFirst();
+		inside[top++] = in;
+	}
+}
+//privates:
+void BoundingHierarchy::expand(const unsigned int node) const {
+	QAtomicInt & state = lazy->builder.states[node];
+	if(state.fetchAndAddAcquire(0) == SPLIT) return;
+
+	if(state.testAndSetAcquire(UNSPLIT, SPLITTING)) {
+		//nodes are allocated atomically and the primitives of node belong only to it => threads can split different nodes at the same time
+		lazy->builder.expand(node);
+		QMutexLocker locker(&lazy->lock);
+		state.fetchAndStoreRelease(SPLIT);
+		lazy->nodeSplit.wakeAll();
+		return;
+	}
+
+	//another thread is splitting node
+	QMutexLocker locker(&lazy->lock);
+	while(state.fetchAndAddAcquire(0) != SPLIT) lazy->nodeSplit.wait(&lazy->lock);
+}
+void BoundingHierarchy::expandAll() {
+	if(! lazy) return;
+	for(unsigned int n=0; n<size(); n++) expand(n);	//children are allocated after their parent => loop reaches them
+	nodes.resize(size());
+	delete lazy;
+	lazy = 0;
+}
+void BoundingHierarchy::encode(const std::vector<Box3D> & exact) {
+	//records of children come after their parent => decoded box of a record is known when it is reached
+	std::vector<Box3D> decoded(compact.size());
+	if(compact.size()) decoded[0] = compactBox;
+	for(unsigned int r=0; r<compact.size(); r++) {
+		for(unsigned int c=0; c<2; c++) {
+			const Box3D box = compact.setBox(r, c, decoded[r], exact[2*r+c]);
+			const unsigned int ref = compact.getRef(r,c);
+			if(! CompactNodes::isLeaf(ref)) decoded[ref] = box;
+		}
+	}
+}
+bool BoundingHierarchy::traverseCompact(const Line3D line, const float tmin, float tmax, HierarchyVisitor & visitor) const {
+	const Vect3D p = line.getP();
+	const Vect3D inv = inverse(line.getV());
+	const float inf = std::numeric_limits<float>::infinity();
+
+	CompactEntry stack[STACKSIZE];
+	unsigned int top = 0;
+	stack[top++].set(compactRoot, compactBox);
+	while(top) {
+		top--;
+		const unsigned int ref = stack[top].ref;
+		const Box3D box = stack[top].getBox();
+		if(box.distsign(p,inv,tmin,tmax) == inf) continue;	//tmax may have decreased since node was pushed
+
+		if(CompactNodes::isLeaf(ref)) {
+			const unsigned int end = CompactNodes::getFirst(ref) + CompactNodes::getCount(ref);
+			for(unsigned int i=CompactNodes::getFirst(ref); i<end; i++)
+				if(visitor.visit(indices[i], tmax)) return true;
+			continue;
+		}
+
+		//closer child is visited first => it is pushed last
+		const Box3D left = compact.getBox(ref, 0, box);
+		const Box3D right = compact.getBox(ref, 1, box);
+		const float tleft = left.distsign(p,inv,tmin,tmax);
+		const float tright = right.distsign(p,inv,tmin,tmax);
+		if(tleft <= tright) {
+			if(tright != inf) stack[top++].set(compact.getRef(ref,1), right);
+			if(tleft != inf) stack[top++].set(compact.getRef(ref,0), left);
+		} else {
+			if(tleft != inf) stack[top++].set(compact.getRef(ref,0), left);
+			stack[top++].set(compact.getRef(ref,1), right);
+		}
+	}
+	return false;
+}
+unsigned int BoundingHierarchy::traverseCompact(const std::vector<Line3D> & lines, const float tmin, const float tmax, std::vector<bool> & done, HierarchyGroupVisitor & visitor) const {
+	const float inf = std::numeric_limits<float>::infinity();
+
+	std::vector<Vect3D> invs(lines.size());
+	for(unsigned int l=0; l<lines.size(); l++) invs[l] = inverse(lines[l].getV());
+	const unsigned int start = std::count(done.begin(), done.end(), false);
+	unsigned int open = start;	//number of lines that are not done, visitor tells how many it finished
+
+	CompactEntry stack[STACKSIZE];
+	unsigned int top = 0;
+	stack[top++].set(compactRoot, compactBox);
+	while(top && open) {
+		top--;
+		const unsigned int ref = stack[top].ref;
+		const Box3D box = stack[top].getBox();
+
+		bool crossed = false;	//true if any open line crosses node
+		for(unsigned int l=0; l<lines.size() && !crossed; l++)
+			if(! done[l] && box.distsign(lines[l].getP(),invs[l],tmin,tmax) != inf) crossed = true;
+		if(! crossed) continue;
+
+		if(CompactNodes::isLeaf(ref)) {
+			const unsigned int end = CompactNodes::getFirst(ref) + CompactNodes::getCount(ref);
+			for(unsigned int i=CompactNodes::getFirst(ref); i<end && open; i++) open -= visitor.visit(indices[i], done);
+			continue;
+		}
+		stack[top++].set(compact.getRef(ref,1), compact.getBox(ref, 1, box));
+		stack[top++].set(compact.getRef(ref,0), compact.getBox(ref, 0, box));
+	}
+	return start - open;
+}
+void BoundingHierarchy::traverseCompact(HierarchyRegionVisitor & visitor) const {
+	CompactEntry stack[STACKSIZE];
+	bool inside[STACKSIZE];	//node is under a node that is inside region
+	unsigned int top = 0;
+	stack[top].set(compactRoot, compactBox);
+	inside[top++] = false;
+	while(top) {
+		top--;
+		const unsigned int ref = stack[top].ref;
+		const Box3D box = stack[top].getBox();
+		bool in = inside[top];
+		if(! in) {
+			const Frustum3D::Overlap overlap = visitor.overlap(box);
+			if(overlap == Frustum3D::OUTSIDE) continue;
+			in = overlap == Frustum3D::INSIDE;
+		}
+
+		if(CompactNodes::isLeaf(ref)) {
+			const unsigned int end = CompactNodes::getFirst(ref) + CompactNodes::getCount(ref);
+			for(unsigned int i=CompactNodes::getFirst(ref); i<end; i++) visitor.visit(indices[i], in);
+			continue;
+		}
+		stack[top].set(compact.getRef(ref,1), compact.getBox(ref, 1, box));
+		inside[top++] = in;
+		stack[top].set(compact.getRef(ref,0), compact.getBox(ref, 0, box));
+		inside[top++] = in;
+	}
+}
+Vect3D BoundingHierarchy::inverse(const Vect3D v) {return Vect3D(1/v.getX(), 1/v.getY(), 1/v.getZ());}
@@ -0,0 +1,318 @@
+/**
+ * @file BoundingHierarchy.h
+ * @brief bounding volume hierarchy
+ *
+ * Acceleration structure that finds objects crossed by a line without checking each object of space.
+ */
+
+#ifndef BOUNDINGHIERARCHY_H
+#define BOUNDINGHIERARCHY_H
+
+#include "Space3D.h"
+
+#include <cstddef>
+#include <vector>
+
+class LazyBuild;
+
+/**
+ * @brief Node of a BoundingHierarchy: a box containing a group of primitives.
+ *
+ * Inner nodes have 2 children that are stored next to each other: first and first+1.
+ * Leaf nodes store a range of the index list of the hierarchy: [first, first+count[.
+ */
+class BoundingNode {
+public:
+	/** @brief Constructs an empty leaf.*/
+	BoundingNode();
+
+	/** @brief Sets node as a leaf containing count primitives from first position of index list.*/
+	void setLeaf(const unsigned int first, const unsigned int count);
+
+	/** @brief Sets node as an inner node whose children are left and left+1.*/
+	void setInner(const unsigned int left);
+
+	/** @brief Setter for bounding box.*/
+	void setBox(const Box3D box);
+
+	/** @brief True if node has no children.*/
+	bool isLeaf() const;
+
+	/** @brief Box that contains all primitives of node.*/
+	Box3D getBox() const;
+
+	/** @brief Leaf: first position in index list; inner node: index of left child.*/
+	unsigned int getFirst() const;
+
+	/** @brief Leaf: number of primitives; inner node: 0.*/
+	unsigned int getCount() const;
+private:
+	Box3D box;
+	unsigned int first;
+	unsigned int count;
+};
+
+/**
+ * @brief Inner nodes of a compressed BoundingHierarchy.
+ *
+ * Each record is an inner node: the boxes of its 2 children quantized to 8 or 16 bits inside the decoded box of the node, and references to the children.
+ * Boxes are rounded outwards, so a decoded box always contains the original one.
+ * A reference is either the index of the record of an inner child or a leaf: flag, number of primitives - 1 on 3 bits, first position in index list on 28 bits.
+ * References are not shortened: the first position of a leaf is an absolute position in index list, which needs more than 16 bits in any mesh of more than 65536 primitives.
+ * A record of 2 children is 20 (8 bit) or 32 (16 bit) bytes instead of the 64 bytes of 2 BoundingNodes, most of the saving comes from the boxes.
+ */
+class CompactNodes {
+public:
+	/** @brief Constructs an empty list with 8 bit quantization.*/
+	CompactNodes();
+
+	/** @brief Removes all records and sets quantization: 8 or 16 bits.*/
+	void clear(const unsigned int bits);
+
+	/** @brief Allocates memory for given number of records.*/
+	void reserve(const unsigned int records);
+
+	/** @brief Adds a record, returns its index.*/
+	unsigned int add();
+
+	/** @brief Sets reference of ith child (0 or 1) of record.*/
+	void setRef(const unsigned int record, const unsigned int i, const unsigned int ref);
+
+	/**
+	 * @brief Quantizes box of ith child of record.
+	 *
+	 * @param parent decoded box of record
+	 * @param box exact box of child, has to be inside parent
+	 * @return decoded box of child (contains box)
+	 */
+	Box3D setBox(const unsigned int record, const unsigned int i, const Box3D parent, const Box3D box);
+
+	/** @brief Reference of ith child of record.*/
+	unsigned int getRef(const unsigned int record, const unsigned int i) const;
+
+	/** @brief Decoded box of ith child of record whose decoded box is parent.*/
+	Box3D getBox(const unsigned int record, const unsigned int i, const Box3D parent) const;
+
+	/** @brief Number of records.*/
+	unsigned int size() const;
+
+	/** @brief Bytes used by records.*/
+	std::size_t getMemory() const;
+
+	/** @brief Reference of a leaf, count has to be 1..8, first less than 2^28.*/
+	static unsigned int leafRef(const unsigned int first, const unsigned int count);
+
+	/** @brief True if ref refers to a leaf.*/
+	static bool isLeaf(const unsigned int ref);
+
+	/** @brief First position of a leaf in index list.*/
+	static unsigned int getFirst(const unsigned int ref);
+
+	/** @brief Number of primitives of a leaf.*/
+	static unsigned int getCount(const unsigned int ref);
+private:
+	unsigned int bits;
+	unsigned int maxq;	//largest quantized value
+	unsigned int recordSize;	//bytes: 2*6 quantized values and 2 references
+	std::vector<unsigned char> data;
+
+	unsigned int getQ(const unsigned int record, const unsigned int pos) const;	//pos: child*6 + corner*3 + axis
+	void setQ(const unsigned int record, const unsigned int pos, const unsigned int q);
+	float decode(const float min, const float max, const unsigned int q) const;
+};
+
+/** @brief Checks primitives that BoundingHierarchy finds for a line.*/
+class HierarchyVisitor {
+public:
+	virtual ~HierarchyVisitor() {}
+
+	/**
+	 * @brief Checks primitive whose box is crossed by line.
+	 *
+	 * @param prim index of primitive (as given in BoundingHierarchy::build)
+	 * @param tmax end of range of line that is still checked - decreasing it (e.g. when a closer cross is found) skips the farther nodes
+	 * @return true if traversal can stop (e.g. any blocker is enough)
+	 */
+	virtual bool visit(const unsigned int prim, float & tmax) = 0;
+};
+
+/** @brief Checks primitives that BoundingHierarchy finds for a group of lines.*/
+class HierarchyGroupVisitor {
+public:
+	virtual ~HierarchyGroupVisitor() {}
+
+	/**
+	 * @brief Checks primitive against the lines of group that are not done.
+	 *
+	 * @param prim index of primitive (as given in BoundingHierarchy::build)
+	 * @param done ith element is true if ith line does not need to be checked any more (e.g. it is blocked) - visitor sets elements of lines it is done with
+	 * @return number of elements of done that visitor set true, so traversal knows when all lines are done without counting them
+	 */
+	virtual unsigned int visit(const unsigned int prim, std::vector<bool> & done) = 0;
+};
+
+/** @brief Selects the nodes that BoundingHierarchy walks in a region query (e.g. frustum culling) and checks the primitives found.*/
+class HierarchyRegionVisitor {
+public:
+	virtual ~HierarchyRegionVisitor() {}
+
+	/** @brief Position of box of a node compared to the region. Nodes under an INSIDE node are not checked.*/
+	virtual Frustum3D::Overlap overlap(const Box3D box) = 0;
+
+	/**
+	 * @brief Checks primitive whose node is not outside the region.
+	 *
+	 * @param prim index of primitive (as given in BoundingHierarchy::build)
+	 * @param inside true if a node above primitive is completely inside region: primitive is inside too
+	 */
+	virtual void visit(const unsigned int prim, const bool inside) = 0;
+};
+
+/**
+ * @brief Binary tree of boxes over a set of primitives.
+ *
+ * Primitives can be anything that has a bounding box (triangles, instances of meshes..) - hierarchy refers to them by their index.
+ * Each node contains the boxes of its children, so if a line doesn't cross a node, it doesn't cross any primitive under it.
+ * Building uses all cores: big nodes are split by several threads, subtrees are built as separate tasks.
+ * A lazy build only splits the top levels, the rest of the tree is split by traversals when they first reach a node.
+ */
+class BoundingHierarchy {
+public:
+	/** @brief Algorithms for building the tree.*/
+	enum BuildMethod {
+		BINNED_SAH,	/**< splits where surface area heuristic is the lowest (checking 16 positions per axis): slower build, faster walking*/
+		MORTON		/**< orders primitives along a Morton curve and splits where their codes differ: fastest build, slower walking*/
+	};
+
+	/** @brief Constructs an empty hierarchy.*/
+	BoundingHierarchy();
+
+	/** @brief Copies hierarchy with the unsplit nodes of a lazy build. Nodes must not be split by a traversal meanwhile.*/
+	BoundingHierarchy(const BoundingHierarchy & o);
+
+	/** @brief Copies hierarchy with the unsplit nodes of a lazy build. Nodes must not be split by a traversal meanwhile.*/
+	BoundingHierarchy & operator=(const BoundingHierarchy & o);
+
+	~BoundingHierarchy();
+
+	/**
+	 * @brief Builds hierarchy over primitives.
+	 *
+	 * @param boxes ith element is the bounding box of ith primitive.
+	 * @param method algorithm of building.
+	 * @param lazy if true, only the top levels are built and a copy of boxes is kept: the other nodes are split the first time a traversal reaches them.
+	 * Traversals from several threads can split nodes at the same time - a thread only waits if another one is splitting the same node.
+	 * Makes building of huge scenes almost instant, parts that no line reaches are never split.
+	 */
+	void build(const std::vector<Box3D> & boxes, const BuildMethod method = BINNED_SAH, const bool lazy = false);
+
+	/**
+	 * @brief Updates boxes of nodes after primitives moved, without changing the tree.
+	 * 
+	 * Much faster than build(): boxes of leaves are recalculated and propagated up to root. Moving primitives far from their original position makes the tree slower to walk: see getCost().
+	 * @param boxes ith element is the new bounding box of ith primitive - number of primitives has to be the same as in last build.
+	 */
+	void refit(const std::vector<Box3D> & boxes);
+
+	/**
+	 * @brief Replaces nodes with a compact format: boxes of children are quantized inside the box of their parent.
+	 *
+	 * Leaves and the children of a node are referenced from the record of the node, so only inner nodes are stored.
+	 * Hierarchy uses 3-4 times less memory with 8 bits, 2 times less with 16 bits. Quantized boxes are a bit bigger, so walking is a bit slower.
+	 * A lazy hierarchy is split completely first. Refit keeps the hierarchy compressed, build() makes a normal one.
+	 * Exact boxes are lost, so a compressed hierarchy can not be compressed again with other bits: it has to be built again first.
+	 * @param bits 8 or 16
+	 * @return false if hierarchy can not be compressed: a leaf has more than 8 primitives, there are at least 2^28 primitives or it is compressed with other bits.
+	 */
+	bool compress(const unsigned int bits);
+
+	/** @brief True if nodes are stored in compact format.*/
+	bool isCompressed() const;
+
+	/** @brief Bits of the quantized boxes of compact format, 0 if hierarchy is not compressed.*/
+	unsigned int getCompression() const;
+
+	/** @brief Bytes used by nodes and index list.*/
+	std::size_t getMemory() const;
+	
+	/**
+	 * @brief Estimated cost of walking the tree with a random line (surface area heuristic).
+	 * 
+	 * Sum of the costs of nodes: probability of crossing a node (its area compared to area of root) multiplied by cost of checking its box or primitives.
+	 */
+	float getCost() const;
+	
+	/** @brief Value of getCost() right after last build.*/
+	float getBuildCost() const;
+	
+	/** @brief Time of last build in milliseconds.*/
+	float getBuildTime() const;
+	
+	/**
+	 * @brief Makes the index list identity, so leaves refer to contiguous ranges of primitives.
+	 *
+	 * Caller has to move its primitives into the returned order: primitives of a leaf become neighbours in memory.
+	 * Order of leaves is the depth-first order of the tree, with Morton build it is the order along the Morton curve.
+	 * Other builds are not sorted along a space-filling curve: that would split the ranges of leaves, while depth-first order keeps them contiguous and close subtrees close in memory.
+	 * @return ith element is the index of the primitive that has to be moved to ith position.
+	 */
+	std::vector<unsigned int> reorder();
+
+	/** @brief True if hierarchy was built lazily: some nodes may not be split yet.*/
+	bool isLazy() const;
+
+	/** @brief True if hierarchy has no primitives.*/
+	bool isEmpty() const;
+
+	/** @brief Box of all primitives.*/
+	Box3D getBox() const;
+
+	/** @brief Number of nodes (that are split so far).*/
+	unsigned int size() const;
+
+	/**
+	 * @brief Finds primitives whose box is crossed by [tmin,tmax] range of line.
+	 *
+	 * Nodes closer to starting point of line are visited first, so closest cross is found early and farther nodes can be skipped.
+	 * @return true if visitor stopped the traversal.
+	 */
+	bool traverse(const Line3D line, const float tmin, float tmax, HierarchyVisitor & visitor) const;
+
+	/**
+	 * @brief Finds primitives whose box is crossed by [tmin,tmax] range of lines of a group.
+	 *
+	 * Hierarchy is walked only once: a node is visited if any of the lines that are not done crosses it.
+	 * @param done ith element is true if ith line does not need to be checked; visitor sets it.
+	 * @return number of lines that became done
+	 */
+	unsigned int traverse(const std::vector<Line3D> & lines, const float tmin, const float tmax, std::vector<bool> & done, HierarchyGroupVisitor & visitor) const;
+
+	/**
+	 * @brief Finds primitives in a region, e.g. the ones a camera can see.
+	 *
+	 * Nodes outside the region are skipped with all primitives under them, nodes inside it are not checked any more, only their primitives are listed.
+	 */
+	void traverse(HierarchyRegionVisitor & visitor) const;
+private:
+	std::vector<BoundingNode> nodes;	//nodes[0] is root; a lazy build allocates all nodes that can ever be used
+	std::vector<unsigned int> indices;	//indices of primitives, leaves store ranges of this list
+	float buildCost;
+	float buildTime;
+	LazyBuild * lazy;	//state of lazy build, 0 if hierarchy is complete
+	bool compressed;	//nodes are replaced by compact
+	unsigned int compactBits;	//quantization of compact
+	CompactNodes compact;
+	unsigned int compactRoot;	//reference of root in compact format
+	Box3D compactBox;	//box of root in compact format
+
+	friend class HierarchyBuilder;
+	void expand(const unsigned int node) const;	//splits node if it was left unsplit by lazy build
+	void expandAll();	//splits all nodes of lazy build, then it is a normal hierarchy
+	void encode(const std::vector<Box3D> & exact);	//quantizes boxes of compact, exact: exact box of each record
+	bool traverseCompact(const Line3D line, const float tmin, float tmax, HierarchyVisitor & visitor) const;
+	unsigned int traverseCompact(const std::vector<Line3D> & lines, const float tmin, const float tmax, std::vector<bool> & done, HierarchyGroupVisitor & visitor) const;
+	void traverseCompact(HierarchyRegionVisitor & visitor) const;
+	static Vect3D inverse(const Vect3D v);	//(1/v.x, 1/v.y, 1/v.z)
+};
+
+#endif
@@ -0,0 +1,145 @@
+#include "BudgetRenderer.h"
+#include "TaskGroup.h"
+
+#include <QRunnable>
+
+#include <algorithm>
+
+namespace {
+	const unsigned int FIRSTSAMPLES = 2;	//rays of each pixel in first round: variance needs 2
+	const unsigned int MAXSTEP = 64;	//most rays added to a pixel in a round, so rounds are short and errors are updated often
+	const float SHOULDER = 1;	//added to squared brightness: error is absolute for usual pixels, relative for overexposed ones (they are clamped to white anyway)
+	const float PRIOR = 0.001f;	//added to variance: a few equal rays may still miss an edge, so pixels without variance are refined too, only later
+
+	//orders indices of tiles by decreasing error
+	class LargerError {
+	public:
+		LargerError(const std::vector<float> & errors) : errors(errors) {}
+		bool operator()(const unsigned int a, const unsigned int b) const {return errors[a] > errors[b];}
+	private:
+		const std::vector<float> & errors;
+	};
+}
+
+//adds rays to the pixels of one tile
+class BudgetTask : public QRunnable {
+public:
+	BudgetTask(BudgetRenderer & renderer, BudgetRenderer::Tile & tile, const unsigned int samples) : renderer(renderer), tile(tile), samples(samples) {}
+	void run() {renderer.renderTile(tile, samples);}
+private:
+	BudgetRenderer & renderer;
+	BudgetRenderer::Tile & tile;
+	const unsigned int samples;
+};
+//--------------------------------------BudgetRenderer----------------------------------------------------------------
+BudgetRenderer::BudgetRenderer() : cancelled(0) {
+	tileSize = 16;
+	maxSamples = 1024;
+	cam = 0;
+	width = height = 0;
+	budget = 0;
+}
+void BudgetRenderer::setTileSize(const unsigned int size)		{tileSize = std::max(size, 1u);}
+void BudgetRenderer::setMaxSamples(const unsigned int samples)	{maxSamples = std::max(samples, 1u);}
+void BudgetRenderer::render(const RayTracerCam & cam, const qint64 msecs) {
+	this->cam = &cam;
+	budget = msecs;
+	cancelled.fetchAndStoreOrdered(0);
+	timer.start();
+	width = cam.getXres();
+	height = cam.getYres();
+	pixels.assign((size_t)width*height, Pixel());
+	tiles.clear();
+	for(unsigned int y=0; y<height; y+=tileSize) {
+		for(unsigned int x=0; x<width; x+=tileSize) {
+			Tile tile;
+			tile.x = x;
+			tile.y = y;
+			tile.width = std::min(tileSize, width - x);
+			tile.height = std::min(tileSize, height - y);
+			tile.samples = 0;
+			tile.error = 0;
+			tiles.push_back(tile);
+		}
+	}
+
+	std::vector<unsigned int> round(tiles.size());
+	for(unsigned int i=0; i<round.size(); i++) round[i] = i;
+	std::vector<float> errors(tiles.size());
+	TaskGroup group;
+	while(! round.empty()) {
+		for(unsigned int i=0; i<round.size(); i++) {
+			Tile & tile = tiles[round[i]];
+			const unsigned int samples = std::min(std::min(std::max(tile.samples, FIRSTSAMPLES), MAXSTEP), maxSamples - tile.samples);
+			group.start(new BudgetTask(*this, tile, samples));
+		}
+		group.wait();
+		if(isOver()) break;
+
+		//next round: the tiles that gain most (at least a task for each thread, so they are all busy)
+		for(unsigned int i=0; i<round.size(); i++) updateError(tiles[round[i]]);
+		round.clear();
+		for(unsigned int i=0; i<tiles.size(); i++) {
+			errors[i] = tiles[i].error;
+			if(tiles[i].error > 0 && tiles[i].samples < maxSamples) round.push_back(i);
+		}
+		std::sort(round.begin(), round.end(), LargerError(errors));
+		round.resize(std::min(round.size(), std::max(round.size()/4, (size_t)group.getThreads()*2)));
+	}
+}
+void BudgetRenderer::cancel()	{cancelled.fetchAndStoreOrdered(1);}
+Color BudgetRenderer::getColor(const unsigned int x, const unsigned int y) const {
+	const Pixel & pixel = pixels[(size_t)y*width + x];
+	if(! pixel.samples) return Color();
+	return Color(pixel.r / pixel.samples, pixel.g / pixel.samples, pixel.b / pixel.samples);
+}
+unsigned int BudgetRenderer::getWidth() const	{return width;}
+unsigned int BudgetRenderer::getHeight() const	{return height;}
+float BudgetRenderer::getSamplesPerPixel() const {
+	double sum = 0;
+	for(size_t i=0; i<pixels.size(); i++) sum += pixels[i].samples;
+	return pixels.empty() ? 0 : sum / pixels.size();
+}
+unsigned int BudgetRenderer::getMinSamples() const {
+	unsigned int result = pixels.empty() ? 0 : pixels[0].samples;
+	for(size_t i=0; i<pixels.size(); i++) result = std::min(result, pixels[i].samples);
+	return result;
+}
+//privates:
+void BudgetRenderer::renderTile(Tile & tile, const unsigned int samples) {
+	const int w = width;
+	const int h = height;
+	bool over = false;
+	for(unsigned int y=tile.y; y<tile.y+tile.height; y++) {
+		for(unsigned int x=tile.x; x<tile.x+tile.width; x++) {
+			Pixel & pixel = pixels[(size_t)y*width + x];
+			for(unsigned int i=0; i<samples; i++) {
+				if(pixel.samples && (over || (over = isOver()))) break;	//only pixels without a ray are still shot
+				const Color c = cam->calcSample((int)x - w/2, h/2 - (int)y, pixel.samples++);
+				const float lum = (c.getR() + c.getG() + c.getB()) / 3;
+				pixel.r += c.getR();
+				pixel.g += c.getG();
+				pixel.b += c.getB();
+				pixel.lum += lum;
+				pixel.lumSq += lum*lum;
+			}
+		}
+	}
+	if(! over) tile.samples += samples;
+}
+void BudgetRenderer::updateError(Tile & tile) const {
+	//variance of the mean of a pixel is variance of its rays / rays
+	float sum = 0;
+	for(unsigned int y=tile.y; y<tile.y+tile.height; y++) {
+		for(unsigned int x=tile.x; x<tile.x+tile.width; x++) {
+			const Pixel & pixel = pixels[(size_t)y*width + x];
+			if(pixel.samples < 2) continue;
+			const float n = pixel.samples;
+			const float mean = pixel.lum / n;
+			const float variance = std::max(0.0f, (pixel.lumSq - pixel.lum*mean) / (n - 1)) + PRIOR;
+			sum += variance / n / (mean*mean + SHOULDER);
+		}
+	}
+	tile.error = sum / (tile.width*tile.height);
+}
+bool BudgetRenderer::isOver()	{return timer.hasExpired(budget) || cancelled.fetchAndAddOrdered(0);}
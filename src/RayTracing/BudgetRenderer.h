@@ -0,0 +1,89 @@
+/**
+ * @file BudgetRenderer.h
+ * @brief rendering the best image that can be calculated by a deadline
+ */
+
+#ifndef BUDGETRENDERER_H
+#define BUDGETRENDERER_H
+
+#include "Camera.h"
+
+#include <QAtomicInt>
+#include <QElapsedTimer>
+
+#include <vector>
+
+/**
+ * @brief Renders an image with a RayTracerCam in a given time instead of with a given density.
+ *
+ * Pixels are refined by adding rays of RayTracerCam::calcSample() until the time is up. Work is given out in rounds of tiles:
+ * the first round gives 2 rays to every pixel, later rounds choose the tiles with the largest estimated error (variance of the mean of the brightness of their pixels)
+ * and double their rays, so noisy parts (edges, blurred parts, reflections) get most of the time and flat areas few rays.
+ * Every pixel gets at least one ray even if time is up before. Rays of a pixel depend only on their number, so an image with more time has the same rays and some more.
+ */
+class BudgetRenderer {
+public:
+	/** @brief Constructs a renderer with 16 pixel tiles and at most 1024 rays per pixel.*/
+	BudgetRenderer();
+
+	/** @brief Setter for width and height of tiles in pixels.*/
+	void setTileSize(const unsigned int size);
+
+	/** @brief Setter for number of rays of a pixel when it is not refined any more (even if there is time left).*/
+	void setMaxSamples(const unsigned int samples);
+
+	/**
+	 * @brief Renders the image of camera, returns when time is up or all pixels are refined.
+	 *
+	 * @param cam camera for raytracing
+	 * @param msecs time of rendering in ms
+	 */
+	void render(const RayTracerCam & cam, const qint64 msecs);
+
+	/** @brief Stops render() as soon as the pixels being rendered have a ray. Can be called from any thread.*/
+	void cancel();
+
+	/** @brief Color of x,y pixel of last render(), 0,0 is the top left corner.*/
+	Color getColor(const unsigned int x, const unsigned int y) const;
+
+	/** @brief Width of image of last render().*/
+	unsigned int getWidth() const;
+
+	/** @brief Height of image of last render().*/
+	unsigned int getHeight() const;
+
+	/** @brief Average number of rays per pixel achieved by last render().*/
+	float getSamplesPerPixel() const;
+
+	/** @brief Smallest number of rays of a pixel of last render().*/
+	unsigned int getMinSamples() const;
+private:
+	//sums of rays of a pixel
+	struct Pixel {
+		float r, g, b;
+		float lum, lumSq;	//brightness for estimating variance
+		unsigned int samples;
+	};
+	struct Tile {
+		unsigned int x, y, width, height;
+		unsigned int samples;	//rays of each pixel after finished rounds
+		float error;
+	};
+
+	unsigned int tileSize;
+	unsigned int maxSamples;
+	const RayTracerCam * cam;
+	unsigned int width, height;
+	std::vector<Pixel> pixels;
+	std::vector<Tile> tiles;
+	QElapsedTimer timer;
+	qint64 budget;
+	QAtomicInt cancelled;
+
+	friend class BudgetTask;
+	void renderTile(Tile & tile, const unsigned int samples);	//adds samples rays to each pixel of tile
+	void updateError(Tile & tile) const;
+	bool isOver();	//time is up or cancelled
+};
+
+#endif
@@ -1,27 +1,24 @@
 #include "Camera.h"
 
-#include <iostream>
+#include <algorithm>
+#include <cmath>
+#include <limits>
 //--------------------------------------GeoRot3D----------------------------------------------------------------
-GeoRot3D::GeoRot3D() : x0(1,0,0), y0(0,1,0), z0(0,0,1) {}
-void GeoRot3D::rotLon(const Rot2D r) {lon+=r;}
-void GeoRot3D::rotLat(const Rot2D r) {lat+=r;}
-void GeoRot3D::rotTwi(const Rot2D r) {twi+=r;}
-Vect3D GeoRot3D::getX() const {
-	//first I rotate around y0 with longitude
-	const Vect3D x1 = Axis3D(y0).rot(x0,lon);
-	const Vect3D z = getZ();	//then I find out axis of twist
-	return Axis3D(z).rot(x1,twi);
-}
-Vect3D GeoRot3D::getY() const {
-	const Vect3D z = getZ();
-	const Vect3D x = getX();
-	return Vect3D(z,x);
-}
-Vect3D GeoRot3D::getZ() const {
-	//this is the simpliest, it does not depend on twist
-	const Vect3D z1 = Axis3D(y0).rot(z0,lon);	//we first rotate with longitude
-	const Vect3D x1 = Axis3D(y0).rot(x0,lon);	//then we need to find out the axis of latitude..
-	return Axis3D(x1).rot(z1,lat);
+GeoRot3D::GeoRot3D() : x0(1,0,0), y0(0,1,0), z0(0,0,1) {update();}
+void GeoRot3D::rotLon(const Rot2D r) {lon+=r; update();}
+void GeoRot3D::rotLat(const Rot2D r) {lat+=r; update();}
+void GeoRot3D::rotTwi(const Rot2D r) {twi+=r; update();}
+Vect3D GeoRot3D::getX() const		{return x;}
+Vect3D GeoRot3D::getY() const		{return y;}
+Vect3D GeoRot3D::getZ() const		{return z;}
+Quat3D GeoRot3D::getQuat() const	{return quat;}
+//privates:
+void GeoRot3D::update() {
+	//latitude is around x0 rotated by longitude, twist around z0 rotated by both: rotating around the starting axes in reverse order gives the same
+	quat = Quat3D(y0, lon) * Quat3D(x0, lat) * Quat3D(z0, twi);
+	x = quat.rot(x0);
+	y = quat.rot(y0);
+	z = quat.rot(z0);
 }
 //--------------------------------------Movable3DTool----------------------------------------------------------------
 Movable3DTool::Movable3DTool() {}
@@ -60,80 +57,432 @@ int AbstractCam::getXres() const						{return xres;}
 int AbstractCam::getYres() const						{return yres;}
 float AbstractCam::getAvgRes() const					{return (float)(xres+yres)/2.0;}
 //--------------------------------------VectorCam----------------------------------------------------------------
-VectorCam::VectorCam() {calcPlanes();}
-void VectorCam::setPos(const Vect3D pos) {
-	Movable3DTool::setPos(pos);
-	calcPlanes();
-}
-void VectorCam::setHVDir(const Vect3D hdir, const Vect3D vdir, const Vect3D dir) {
-	Movable3DTool::setHVDir(hdir,vdir,dir);
-	calcPlanes();
-}
-void VectorCam::setHVDir(const GeoRot3D rot) {
-	Movable3DTool::setHVDir(rot);
-	calcPlanes();
-}
-void VectorCam::stepPos(const float thdir, const float tvdir,const float tdir) {
-	Movable3DTool::stepPos(thdir,tvdir,tdir);
-	calcPlanes();
-}
+//projects the triangles that space finds in the frustum
+class ProjectVisitor : public SpaceRegionVisitor {
+public:
+	ProjectVisitor(const VectorCam & cam, DetailedSpace2D & result) : cam(cam), result(result) {last = 0;}
+	void visit(const DetailedInstance3D & inst, const unsigned int tri, const bool inside) {
+		if(&inst != last) {
+			last = &inst;
+			toWorld = inst.getToWorld();
+		}
+		const DetailedMesh3D & mesh = *inst.getMesh();
+		cam.project(toWorld.point(mesh.getVertex(tri,0)), toWorld.point(mesh.getVertex(tri,1)), toWorld.point(mesh.getVertex(tri,2)), mesh.getMaterial(tri).getActive(), inside, result);
+	}
+	void visitShape(const DetailedInstance3D & inst, const bool inside) {
+		//analytic shapes are drawn with a few triangles, tessellated once by the shape
+		const DetailedMesh3D & preview = inst.getShape()->getPreview();
+		const Transform3D toWorld = inst.getToWorld();
+		for(unsigned int i=0; i<preview.size(); i++)
+			cam.project(toWorld.point(preview.getVertex(i,0)), toWorld.point(preview.getVertex(i,1)), toWorld.point(preview.getVertex(i,2)), preview.getMaterial(i).getActive(), inside, result);
+	}
+private:
+	const VectorCam & cam;
+	DetailedSpace2D & result;
+	const DetailedInstance3D * last;	//triangles of an instance come one after the other => transformation is copied once
+	Transform3D toWorld;
+};
+
+const float VectorCam::NEAR = 0.1f;
+VectorCam::VectorCam() {}
 DetailedSpace2D VectorCam::project() const {
 	DetailedSpace2D result;
-	for(DetailedSpace3D::const_iterator i = getSpace()->begin(); i!=getSpace()->end(); i++)
-		if(isVisible(*i)) result.push_back(project(*i));
+	project(result);
+	return result;
+}
+void VectorCam::project(DetailedSpace2D & result) const {
+	result.clear();
+	ProjectVisitor visitor(*this, result);
+	getSpace()->traverse(getFrustum(), visitor);
+}
+Frustum3D VectorCam::getFrustum() const {
+	//half size of screen at distance 1
+	const float hw = getXres() / 2.0f * getAov() / getAvgRes();
+	const float hh = getYres() / 2.0f * getAov() / getAvgRes();
+	Frustum3D result;
+	result.add(Plane3D(getPos() + getDir()*NEAR, getDir()));
+	result.add(Plane3D(getPos(), getHdir() + getDir()*hw));	//left
+	result.add(Plane3D(getPos(), getDir()*hw - getHdir()));	//right
+	result.add(Plane3D(getPos(), getVdir() + getDir()*hh));	//bottom
+	result.add(Plane3D(getPos(), getDir()*hh - getVdir()));	//top
 	return result;
 }
 //privates:
 Vect2D VectorCam::project(const Vect3D & vect) const {
-	//projection of 1 vector
-	//assuming that the vector is before the screen plane
-	const Vect3D proj = Line3D(getPos(),vect).cross(screen);
-	const Vect2D result(vplain.distsign(proj)/getAov(), hplain.distsign(proj)/getAov());
-	return result * getAvgRes();
-}
-bool VectorCam::isVisible(const DetailedTri3D & tri) const {
-	//returns true if all poles of the triangle is before the screen plane
-	if(screen.distsign(tri.getA()) <= 0) return false;
-	if(screen.distsign(tri.getB()) <= 0) return false;
-	if(screen.distsign(tri.getC()) <= 0) return false;
-	return true;
+	//hdir, vdir and dir are orthogonal unit vectors: point is projected onto the plane 1 unit in front of camera
+	const Vect3D d = vect - getPos();
+	const float scale = getAvgRes() / (getAov() * (d*getDir()));
+	return Vect2D(d*getHdir() * scale, d*getVdir() * scale);
 }
-DetailedTri2D VectorCam::project(const DetailedTri3D & tri) const {
-	//assuming that the triangle is visible
-	DetailedTri2D result( project(tri.getA()),
-				project(tri.getB()),
-				project(tri.getC()) );
-	result.setColor(tri.getActive());
-	return result;
+float VectorCam::depth(const Vect3D & vect) const {return (vect - getPos()) * getDir();}
+void VectorCam::project(const Vect3D & a, const Vect3D & b, const Vect3D & c, const Color & color, const bool inside, DetailedSpace2D & result) const {
+	//flat shading: light from camera, surfaces facing camera are the brightest
+	const Vect3D normal(b-a, c-a);
+	const float len2 = normal.len2() * getDir().len2();
+	const float facing = len2 > 0 ? std::fabs(normal*getDir()) / std::sqrt(len2) : 1;
+	const float shade = 0.25f + 0.75f*facing;
+	const Color shaded(color.getR()*shade, color.getG()*shade, color.getB()*shade);
+
+	const Vect3D v[3] = {a, b, c};
+	const float z[3] = {depth(a), depth(b), depth(c)};
+	if(inside || (z[0] >= NEAR && z[1] >= NEAR && z[2] >= NEAR)) {
+		add(a, b, c, shaded, result);
+		return;
+	}
+
+	//clipping by near plane: part in front of it is a triangle or a quad
+	Vect3D poly[4];
+	unsigned int count = 0;
+	for(unsigned int i=0; i<3; i++) {
+		const unsigned int j = (i+1)%3;
+		if(z[i] >= NEAR) poly[count++] = v[i];
+		if((z[i] >= NEAR) != (z[j] >= NEAR)) poly[count++] = v[i] + (v[j]-v[i]) * ((NEAR - z[i]) / (z[j] - z[i]));
+	}
+	for(unsigned int i=2; i<count; i++) add(poly[0], poly[i-1], poly[i], shaded, result);
 }
-void VectorCam::calcPlanes() {
-	const Vect3D p = getPos() + getDir();	//focuspoint of projection is not on screenplane this way
-	hplain = Plane3D(p, getVdir());
-	vplain = Plane3D(p, getHdir());
-	screen = Plane3D(p, getDir());
+void VectorCam::add(const Vect3D & a, const Vect3D & b, const Vect3D & c, const Color & color, DetailedSpace2D & result) const {
+	DetailedTri2D tri(project(a), project(b), project(c));
+
+	//triangles of partly visible nodes may still be off screen
+	const float hw = getXres() / 2.0f;
+	const float hh = getYres() / 2.0f;
+	const Vect2D p[3] = {tri.getA(), tri.getB(), tri.getC()};
+	if(p[0].getX() < -hw && p[1].getX() < -hw && p[2].getX() < -hw) return;
+	if(p[0].getX() > hw && p[1].getX() > hw && p[2].getX() > hw) return;
+	if(p[0].getY() < -hh && p[1].getY() < -hh && p[2].getY() < -hh) return;
+	if(p[0].getY() > hh && p[1].getY() > hh && p[2].getY() > hh) return;
+
+	tri.setDepth(depth(a), depth(b), depth(c));
+	tri.setColor(color);
+	result.push_back(tri);
+}
+//--------------------------------------PrimaryHit----------------------------------------------------------------
+PrimaryHit::PrimaryHit() {
+	depth = std::numeric_limits<float>::infinity();
 }
+PrimaryHit::PrimaryHit(const SpaceCross cross, const Vect3D pos, const Vect3D normal, const float depth, const Color color) {
+	this->cross = cross;
+	this->pos = pos;
+	this->normal = normal;
+	this->depth = depth;
+	this->color = color;
+}
+SpaceCross PrimaryHit::getCross() const		{return cross;}
+Vect3D PrimaryHit::getPos() const			{return pos;}
+Vect3D PrimaryHit::getNormal() const		{return normal;}
+float PrimaryHit::getDepth() const			{return depth;}
+Color PrimaryHit::getColor() const			{return color;}
 //--------------------------------------RayTracerCam----------------------------------------------------------------
+namespace {
+	const int MAXCOC = 16;	//largest radius of blur of DOF preview in pixels
+
+	//i-th element of Halton sequence of base: digits of i mirrored behind the point, in [0,1)
+	float radicalInverse(unsigned int i, const unsigned int base) {
+		float result = 0;
+		float digit = 1.0f / base;
+		for(; i; i /= base, digit /= base) result += digit * (i % base);
+		return result;
+	}
+}
 RayTracerCam::RayTracerCam() : AbstractCam() {
 	setFocusDist(1);
 	setDof(1);
 	setDensity(1);
+	projection = PERSPECTIVE;
+	cacheEnabled = false;
+	dofPreview = false;
+	reprojection = false;
+	moved = false;
+}
+void RayTracerCam::setSpace(const DetailedSpace3D * const space) {
+	AbstractCam::setSpace(space);
+	clearPrimaryCache();
+}
+void RayTracerCam::setAov(const float aov) {
+	AbstractCam::setAov(aov);
+	poseChanged();
+}
+void RayTracerCam::setRes(const float x, const float y) {
+	const bool changed = (int)x != getXres() || (int)y != getYres();
+	AbstractCam::setRes(x,y);
+	if(changed) clearPrimaryCache();
+}
+void RayTracerCam::setPos(const Vect3D pos) {
+	AbstractCam::setPos(pos);
+	poseChanged();
+}
+void RayTracerCam::setHVDir(const Vect3D hdir, const Vect3D vdir, const Vect3D dir) {
+	AbstractCam::setHVDir(hdir,vdir,dir);
+	poseChanged();
+}
+void RayTracerCam::setHVDir(const GeoRot3D rot) {
+	AbstractCam::setHVDir(rot);
+	poseChanged();
+}
+void RayTracerCam::stepPos(const float thdir, const float tvdir, const float tdir) {
+	AbstractCam::stepPos(thdir,tvdir,tdir);
+	poseChanged();
 }
 void RayTracerCam::setFocusDist(float fdist)		{this->fdist = fdist;}
 void RayTracerCam::setDof(float dof)				{this->dof = dof;}
 void RayTracerCam::setDensity(float density)		{this->density = density;}
-Color RayTracerCam::calcColor(const int x, const int y) const {
+float RayTracerCam::getFocusDist() const			{return fdist;}
+float RayTracerCam::getDof() const					{return dof;}
+float RayTracerCam::getDensity() const				{return density;}
+void RayTracerCam::setProjection(const Projection projection) {
+	this->projection = projection;
+	clearPrimaryCache();
+}
+RayTracerCam::Projection RayTracerCam::getProjection() const	{return projection;}
+void RayTracerCam::setPrimaryCache(const bool enabled) {
+	cacheEnabled = enabled;
+	clearPrimaryCache();
+}
+void RayTracerCam::clearPrimaryCache() {
+	const unsigned int size = cacheEnabled ? getXres()*getYres() : 0;
+	primary.assign(size, PrimaryHit());
+	cached.assign(size, 0);
+	cachedCount.fetchAndStoreOrdered(0);
+	moved = false;
+}
+void RayTracerCam::setReprojection(const bool enabled) {
+	reprojection = enabled;
+	if(! enabled && moved) clearPrimaryCache();
+}
+void RayTracerCam::updatePrimaryCache() {
+	if(! moved) return;
+	moved = false;
+
+	//hits are splatted into the new pose with a depth test
+	const std::vector<PrimaryHit> old(primary);
+	const std::vector<unsigned char> oldCached(cached);
+	primary.assign(old.size(), PrimaryHit());
+	cached.assign(old.size(), 0);
 	const Vect3D pos = getPos();
 	const Vect3D dir = getDir();
 	const Vect3D hdir = getHdir();
 	const Vect3D vdir = getVdir();
 	const float pdist = getAov() / getAvgRes();
-	
-	const Color result =
-		ViewRayGroup(pos,
-				pos + (dir + hdir*x*pdist + vdir*y*pdist)*fdist,
-				hdir, vdir, dof, dof/density).shotAt(*getSpace());
+	const int xmin = -getXres()/2, xmax = getXres() - getXres()/2;
+	const int ymax = getYres()/2, ymin = getYres()/2 - getYres();
+	for(unsigned int i=0; i<old.size(); i++) {
+		if(! oldCached[i]) continue;
+		const bool hit = old[i].getCross().isHit();
+		const Vect3D rel = hit ? old[i].getPos() - pos : old[i].getPos();	//rays that hit nothing keep their direction
+		const float depth = (rel*dir) / (dir*dir);
+		if(depth <= 0) continue;	//behind camera
+
+		//inverse of the ray of calcPrimary(): rel = (dir + hdir*x*pdist + vdir*y*pdist)*depth
+		const float fx = (rel*hdir) / (hdir*hdir) / (depth*pdist);
+		const float fy = (rel*vdir) / (vdir*vdir) / (depth*pdist);
+		const int x = (int)std::floor(fx + 0.5f);
+		const int y = (int)std::floor(fy + 0.5f);
+		if(x < xmin || x >= xmax || y <= ymin || y > ymax) continue;
+		const unsigned int j = index(x,y);
+		const float newDepth = hit ? depth : old[i].getDepth();	//infinite if nothing is hit
+		if(cached[j] && primary[j].getDepth() <= newDepth) continue;
+		primary[j] = PrimaryHit(old[i].getCross(), old[i].getPos(), old[i].getNormal(), newDepth, old[i].getColor());
+		cached[j] = 1;
+	}
+
+	//a pixel next to a much closer one may be a hole in a surface that came closer, or a part that was hidden before
+	const int xres = getXres(), yres = getYres();
+	std::vector<unsigned int> edges;
+	for(int row=0; row<yres; row++)
+		for(int col=0; col<xres; col++) {
+			const unsigned int i = row*xres + col;
+			if(! cached[i]) continue;
+			const float depth = primary[i].getDepth();
+			const int ns[4][2] = {{col-1,row}, {col+1,row}, {col,row-1}, {col,row+1}};
+			for(unsigned int n=0; n<4; n++) {
+				if(ns[n][0] < 0 || ns[n][0] >= xres || ns[n][1] < 0 || ns[n][1] >= yres) continue;
+				const unsigned int j = ns[n][1]*xres + ns[n][0];
+				if(cached[j] && primary[j].getDepth() < depth*0.9f) {
+					edges.push_back(i);
+					break;
+				}
+			}
+		}
+	for(unsigned int e=0; e<edges.size(); e++) cached[edges[e]] = 0;
+
+	int count = 0;
+	for(unsigned int i=0; i<cached.size(); i++) count += cached[i];
+	cachedCount.fetchAndStoreOrdered(count);
+}
+bool RayTracerCam::isPrimaryCached() const {
+	return cacheEnabled && ! moved && cachedCount.fetchAndAddOrdered(0) == (int)primary.size();
+}
+const PrimaryHit * RayTracerCam::getPrimaryHit(const int x, const int y) const {
+	if(! cacheEnabled || moved) return 0;
+	const unsigned int i = index(x,y);
+	return cached[i] ? &primary[i] : 0;
+}
+bool RayTracerCam::isPinhole() const {
+	//ViewRayGroup shoots only the central ray: lens is a point or rays are 1 radius apart
+	return dof <= 0 || density == 1;
+}
+void RayTracerCam::setDofPreview(const bool preview)	{dofPreview = preview;}
+Color RayTracerCam::calcColor(const int x, const int y) const {
+	Vect3D normal;
+	float depth;
+	Color albedo;
+	return calcColor(x,y, normal, depth, albedo);
+}
+Color RayTracerCam::calcColor(const int x, const int y, Vect3D & normal, float & depth, Color & albedo) const {
+	if(projection != PERSPECTIVE) return calcPanorama(x + getXres()/2 + 0.5f, getYres()/2 - y + 0.5f, normal, depth, albedo);	//center of pixel
+	if(cacheEnabled && ! moved) {
+		const unsigned int i = index(x,y);
+		const bool preview = dofPreview && ! isPinhole() && isPrimaryCached();
+		if(! cached[i]) {
+			primary[i] = calcPrimary(x,y);
+			cached[i] = 1;
+			cachedCount.fetchAndAddOrdered(1);
+		}
+		if(isPinhole() || preview) {
+			const PrimaryHit & hit = primary[i];
+			normal = hit.getNormal();
+			depth = hit.getDepth();
+			albedo = hit.getCross().isHit() ? hit.getCross().getMaterial().getActive() : Color();
+			return preview ? calcDofPreview(x,y) : hit.getColor();
+		}
+	}
+
+	return rayGroup(x,y).shotAt(*getSpace(), normal, depth, albedo);
+}
+Color RayTracerCam::calcSample(const int x, const int y, const unsigned int sample) const {
+	//sample 0 is the center of the pixel and the lens
+	const float dx = sample ? radicalInverse(sample, 2) - 0.5f : 0;
+	const float dy = sample ? radicalInverse(sample, 3) - 0.5f : 0;
+	if(projection != PERSPECTIVE) {
+		Vect3D normal;
+		float depth;
+		Color albedo;
+		return calcPanorama(x + getXres()/2 + 0.5f + dx, getYres()/2 - y + 0.5f - dy, normal, depth, albedo);
+	}
+	const float r = dof * std::sqrt(radicalInverse(sample, 5));	//uniform on the area of the lens
+	const float angle = 2*M_PI * radicalInverse(sample, 7);
+
+	const Vect3D pos = getPos();
+	const float pdist = getAov() / getAvgRes();
+	const Vect3D focus = pos + (getDir() + getHdir()*((x + dx)*pdist) + getVdir()*((y + dy)*pdist))*fdist;
+	return ViewRay(pos + getHdir()*(r*std::cos(angle)) + getVdir()*(r*std::sin(angle)), focus).shotAt(*getSpace());
+}
+Color RayTracerCam::sumRays(const int x, const int y, const unsigned int part, const unsigned int parts, unsigned int & count) const {
+	if(projection != PERSPECTIVE) {
+		count = part ? 0 : 1;	//one ray in first part
+		return part ? Color() : calcColor(x,y);
+	}
+	return rayGroup(x,y).sumPart(*getSpace(), part, parts, count);
+}
+unsigned int RayTracerCam::getRaysPerPixel() const	{return projection == PERSPECTIVE ? rayGroup(0,0).getRayCount() : 1;}
+//privates:
+void RayTracerCam::poseChanged() {
+	if(reprojection && cacheEnabled) moved = true;
+	else clearPrimaryCache();
+}
+ViewRayGroup RayTracerCam::rayGroup(const int x, const int y) const {
+	const Vect3D pos = getPos();
+	const Vect3D hdir = getHdir();
+	const Vect3D vdir = getVdir();
+	const float pdist = getAov() / getAvgRes();
+	return ViewRayGroup(pos, pos + (getDir() + hdir*x*pdist + vdir*y*pdist)*fdist, hdir, vdir, dof, dof/density);
+}
+bool RayTracerCam::panoramaDir(const float col, const float row, Vect3D & result) const {
+	const Vect3D forward = getDir() / std::sqrt(getDir()*getDir());
+	const Vect3D right = getHdir() / std::sqrt(getHdir()*getHdir());
+	const Vect3D up = getVdir() / std::sqrt(getVdir()*getVdir());
+	if(projection == EQUIRECTANGULAR) {
+		const float lon = (col / getXres() - 0.5f) * 2*M_PI;
+		const float lat = (0.5f - row / getYres()) * M_PI;
+		result = (forward*std::cos(lon) + right*std::sin(lon))*std::cos(lat) + up*std::sin(lat);
+		return true;
+	}
+
+	const int size = std::min(getXres()/3, getYres()/2);	//of a face
+	if(size <= 0 || col >= 3*size || row >= 2*size) return false;
+	const int faceCol = (int)col / size;
+	const int faceRow = (int)row / size;
+	const float u = (col - faceCol*size) / size * 2 - 1;	//-1..1 to the right on face
+	const float v = (row - faceRow*size) / size * 2 - 1;	//-1..1 downwards on face
+	Vect3D d;	//x right, y up, z backwards
+	switch(faceRow*3 + faceCol) {	//faces of OpenGL cube maps
+		case 0:	d = Vect3D(1, -v, -u);	break;
+		case 1:	d = Vect3D(-1, -v, u);	break;
+		case 2:	d = Vect3D(u, 1, v);	break;
+		case 3:	d = Vect3D(u, -1, -v);	break;
+		case 4:	d = Vect3D(u, -v, 1);	break;
+		default:	d = Vect3D(-u, -v, -1);
+	}
+	result = right*d.getX() + up*d.getY() - forward*d.getZ();
+	return true;
+}
+Color RayTracerCam::calcPanorama(const float col, const float row, Vect3D & normal, float & depth, Color & albedo) const {
+	normal = Vect3D();
+	depth = std::numeric_limits<float>::infinity();
+	albedo = Color();
+	Vect3D dir;
+	if(! panoramaDir(col, row, dir)) return Color();
+
+	const Vect3D pos = getPos();
+	const ViewRay ray(pos, pos + dir);
+	const Color result = ray.shotAt(*getSpace());
+	const SpaceCross hit = ray.getHit();
+	if(hit.isHit()) {
+		normal = hit.getNormal();
+		depth = std::sqrt(ray.getV()*ray.getV()) * hit.getT();
+		albedo = hit.getMaterial().getActive();
+	}
 	return result;
 }
+unsigned int RayTracerCam::index(const int x, const int y) const {
+	//inverse of the pixel coordinates of calcColor()
+	const int col = x + getXres()/2;
+	const int row = getYres()/2 - y;
+	return row*getXres() + col;
+}
+PrimaryHit RayTracerCam::calcPrimary(const int x, const int y) const {
+	const Vect3D pos = getPos();
+	const Vect3D dir = getDir();
+	const float pdist = getAov() / getAvgRes();
+
+	const ViewRay ray(pos, pos + dir + getHdir()*x*pdist + getVdir()*y*pdist);
+	const Color color = ray.shotAt(*getSpace());
+	const SpaceCross cross = ray.getHit();
+	if(! cross.isHit()) return PrimaryHit(cross, ray.getV(), Vect3D(), std::numeric_limits<float>::infinity(), color);	//direction instead of position
+
+	const Vect3D hit = ray.getHitPos();
+	const float depth = ((hit-pos) * dir) / (dir*dir);	//same unit as focus distance
+	return PrimaryHit(cross, hit, cross.getNormal(), depth, color);
+}
+float RayTracerCam::calcCoc(const float depth) const {
+	//a lens point dof away from center sees depth shifted by dof*(1 - depth/fdist) compared to the central ray
+	const float pdist = getAov() / getAvgRes();
+	const float coc = depth < std::numeric_limits<float>::infinity() ?
+		dof * std::fabs(fdist - depth) / (fdist * depth * pdist) :
+		dof / (fdist * pdist);	//limit at infinite depth
+	return std::max(0.5f, std::min((float)MAXCOC, coc));
+}
+Color RayTracerCam::calcDofPreview(const int x, const int y) const {
+	//gathering: a neighbour is added if its blur reaches this pixel
+	//smaller blurs are brighter (same light on smaller area)
+	const PrimaryHit & center = primary[index(x,y)];
+	const float centerCoc = calcCoc(center.getDepth());
+	const int xmin = -getXres()/2, xmax = getXres() - getXres()/2;
+	const int ymax = getYres()/2, ymin = getYres()/2 - getYres();
+	Color sum;
+	float weight = 0;
+	for(int ny = std::max(ymin+1, y-MAXCOC); ny <= std::min(ymax, y+MAXCOC); ny++)
+		for(int nx = std::max(xmin, x-MAXCOC); nx < std::min(xmax, x+MAXCOC+1); nx++) {
+			const PrimaryHit & hit = primary[index(nx,ny)];
+			const float coc = calcCoc(hit.getDepth());
+			const float dist2 = (nx-x)*(nx-x) + (ny-y)*(ny-y);
+			if(dist2 > coc*coc) continue;
+			if(hit.getDepth() > center.getDepth() && dist2 > centerCoc*centerCoc) continue;	//background doesn't blur over a sharper foreground
+			sum += hit.getColor() / (coc*coc);
+			weight += 1 / (coc*coc);
+		}
+	return sum / weight;
+}
 //--------------------------------------Lamp----------------------------------------------------------------
 Lamp::Lamp() {}
 void Lamp::setRes(const float hangle, const float vangle, const float rangle) {
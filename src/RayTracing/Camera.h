@@ -7,11 +7,14 @@
 #include "Space2D.h"
 #include "RayTracing.h"
 
+#include <QAtomicInt>
+
 #include <vector>
 
 /** @brief Manages three 2D rotations in 3D as using them as latitude, longitude and twist.
  * 
- * Provides 3 vectors that are ortogonal to each other: x,y,z - defining a 3 dimensional coordinate system. Longtitude rotation happens around vertical axis (y0). Latitude rotation happens around horizontal normal vector of longitude rotation (x0 rotated around y0 by longitude). Twist is around z.*/
+ * Provides 3 vectors that are ortogonal to each other: x,y,z - defining a 3 dimensional coordinate system. Longtitude rotation happens around vertical axis (y0). Latitude rotation happens around horizontal normal vector of longitude rotation (x0 rotated around y0 by longitude). Twist is around z.
+ * The 3 angles are composed into one quaternion when one of them changes, and x,y,z are kept: getters only return them.*/
 class GeoRot3D {
 public:
 	/** @brief Constructs a GeoRot3D with no rotation.
@@ -37,9 +40,15 @@ public:
 	
 	/** @brief Direction of rotation.*/
 	Vect3D getZ() const;
+	
+	/** @brief The whole rotation: x0,y0,z0 are rotated into x,y,z.*/
+	Quat3D getQuat() const;
 private:
 	const Vect3D x0,y0,z0;	//starting values of horizontal and vertical normal vectors and direction. y0: axis of longitude
 	Rot2D lon,lat,twi;	//longitude, latitude, twist
+	Quat3D quat;	//longitude * latitude * twist, each around its starting axis
+	Vect3D x,y,z;	//x0,y0,z0 rotated by quat
+	void update();	//calculates quat and x,y,z from the angles
 };
 
 /** @brief defines position & direction and methods to rotate direction and to step position forward/backward, left/right, up/down in 3D
@@ -128,52 +137,113 @@ private:
 };
 
 
-/** @brief Camera that uses graphical projection.*/
+/** @brief Camera that uses graphical projection.
+ * 
+ * Only triangles inside the view are projected: hierarchies of space are walked with the frustum of the camera, so cost depends on the visible geometry, not on the size of space.
+ * Triangles crossing the near plane are clipped.*/
 class VectorCam : public AbstractCam {
 public:
 	/** @brief Constructs a VectCam with no space definied, 1.0 angle of view and 0,0 resolution.*/
 	VectorCam();
+
+	/** @brief The projection itself*/
+	DetailedSpace2D project() const;
 	
-	/** @brief Setter for position of VectorCam*/
-	void setPos(const Vect3D pos);
+	/**
+	 * @brief The projection itself, into a buffer that can be reused for each frame.
+	 * 
+	 * Space has to be built (see DetailedSpace3D::build()), its hierarchies are used for culling.
+	 * @param result cleared and filled with visible triangles; its memory is kept, so the next frame doesn't allocate
+	 */
+	void project(DetailedSpace2D & result) const;
 	
-	/** @brief Setter for direction, horizontal and vertical normal vectors
-	 *
-	 * @param hdir Horizontal normal vector of direction.
-	 * @param vdir Vertical normal vector of direction.
-	 * @param dir Direction of VectorCam.*/
-	void setHVDir(const Vect3D hdir, const Vect3D vdir, const Vect3D dir);
+	/** @brief Part of space that camera sees: between near plane and the 4 planes through camera and the borders of screen.*/
+	Frustum3D getFrustum() const;
+private:
+	static const float NEAR;	//distance of near plane from camera
+	friend class ProjectVisitor;
+	Vect2D project(const Vect3D & vect) const;	//projection of 1 point. Assuming that the point is not behind near plane!
+	float depth(const Vect3D & vect) const;	//distance from camera along direction
+	void project(const Vect3D & a, const Vect3D & b, const Vect3D & c, const Color & color, const bool inside, DetailedSpace2D & result) const;	//shades, clips and projects triangle; inside: no clipping is needed
+	void add(const Vect3D & a, const Vect3D & b, const Vect3D & c, const Color & color, DetailedSpace2D & result) const;	//projects a triangle that is in front of near plane, unless it is off screen
+};
+
+/** @brief What the ray through the center of a pixel from the center of the lens hits (G-buffer element).
+ * 
+ * This ray doesn't depend on focus distance, depth of field or density: it is the ray of a pinhole camera.*/
+class PrimaryHit {
+public:
+	/** @brief Constructs a hit of nothing: infinite depth and black color.*/
+	PrimaryHit();
 	
-	/** @brief Setter for direction, horizontal and vertical normal vectors
+	/** @brief Constructs a hit from given values.
 	 * 
-	 * @param rot Rotation that holds direction and normal vectors of direction*/
-	void setHVDir(const GeoRot3D rot);
+	 * @param cross crossed triangle or shape
+	 * @param pos cross point in space, direction of ray if nothing is hit
+	 * @param normal normal vector of crossed surface
+	 * @param depth distance of cross point from camera along direction of camera
+	 * @param color result of the ray*/
+	PrimaryHit(const SpaceCross cross, const Vect3D pos, const Vect3D normal, const float depth, const Color color);
 	
-	/** @brief Changes position of camera using given values.
-	 * 
-	 * @param thdir moves camera horizontally with length: hdir*thdir
-	 * @param tvdir moves camera vertically with length: vdir*tvdir
-	 * @param tdir moves camera forward with length: dir*tdir*/
-	void stepPos(const float thdir, const float tvdir, const float tdir);
-
-	/** @brief The projection itself*/
-	DetailedSpace2D project() const;
+	/** @brief crossed triangle or shape, getCross().isHit() is false if ray hits nothing*/
+	SpaceCross getCross() const;
+	
+	/** @brief cross point in space, direction of ray if nothing is hit*/
+	Vect3D getPos() const;
+	
+	/** @brief normal vector of crossed surface in space*/
+	Vect3D getNormal() const;
+	
+	/** @brief distance of cross point from camera along direction of camera, infinite if nothing is hit*/
+	float getDepth() const;
+	
+	/** @brief color calculated by the ray (with reflections and transparency)*/
+	Color getColor() const;
 private:
-	Plane3D hplain,vplain,screen;	//horizontal plane, vertical plane, screen plane
-	Vect2D project(const Vect3D & vect) const;	//projection of 1 point. Assuming that the point is before the screen plane!
-	bool isVisible(const DetailedTri3D & tri) const;	//returns true if there is any pole of given triangle that is NOT before the splane
- 	DetailedTri2D project(const DetailedTri3D & tri) const;	//returns a 2 dimensional triangle that is projection of given Tri3D. Assuming that all points are projectable.
-	void calcPlanes();	//calculates splain,vplain,hplain
+	SpaceCross cross;
+	Vect3D pos, normal;
+	float depth;
+	Color color;
 };
 
 /** @brief Camera that renders using RayGroups.
  * 
- * Shots a raygroup for each pixel of the result.*/
+ * Shots a raygroup for each pixel of the result.
+ * Can keep the primary hit of each pixel (see PrimaryHit): changing focus distance, depth of field or density then doesn't trace them again.
+ * With reprojection the cache survives moves of camera as well: hits are moved to the pixels where the new pose sees them, only the rest is traced.*/
 class RayTracerCam : public AbstractCam {
 public:
+	/** @brief Mapping of directions around camera to pixels of image.*/
+	enum Projection {
+		PERSPECTIVE,	/**< flat image through a lens: angle of view, focus distance, depth of field and density are used (default)*/
+		EQUIRECTANGULAR,	/**< panorama of the whole sphere: longitude along x (direction of camera in the middle, to the right of it on the right), latitude along y, best at 2:1 resolution*/
+		CUBEMAP	/**< six faces of a cube in a 3x2 grid of square faces: +x -x +y in the top row, -y +z -z in the bottom one, where x is right, y is up and z is backwards (-z is the direction of camera, as in OpenGL), best at 3:2 resolution*/
+	};
+
 	/** @brief Constructs an empty camera that can be set with setters.*/
 	RayTracerCam();
 	
+	/** @brief Setter for space, clears cached primary hits.*/
+	void setSpace(const DetailedSpace3D * const space);
+	
+	/** @brief Setter for angle of view, clears cached primary hits (or marks them for reprojection).*/
+	void setAov(const float aov);
+	
+	/** @brief Setter for resolution, clears cached primary hits.*/
+	void setRes(const float x, const float y);
+	
+	/** @brief Setter for position, clears cached primary hits (or marks them for reprojection).*/
+	void setPos(const Vect3D pos);
+	
+	/** @brief Setter for direction, clears cached primary hits (or marks them for reprojection).*/
+	void setHVDir(const Vect3D hdir, const Vect3D vdir, const Vect3D dir);
+	
+	/** @brief Setter for direction, clears cached primary hits (or marks them for reprojection).*/
+	void setHVDir(const GeoRot3D rot);
+	
+	/** @brief Moves camera, clears cached primary hits (or marks them for reprojection).*/
+	void stepPos(const float thdir, const float tvdir, const float tdir);
+	
 	/** @brief sets focus distance.
 	 * 
 	 * Focus distance is the distance where imiage is sharp. Before and after this point image is blured.*/
@@ -187,14 +257,114 @@ public:
 	/** @brief density of rays per pixel.*/
 	void setDensity(float density);
 	
+	/** @brief Focus distance.*/
+	float getFocusDist() const;
+	
+	/** @brief Depth of field.*/
+	float getDof() const;
+	
+	/** @brief Density of rays per pixel.*/
+	float getDensity() const;
+	
+	/**
+	 * @brief Setter for projection, clears cached primary hits.
+	 * 
+	 * Panoramas shoot one ray from the position of camera per pixel (and per sample of calcSample()), without depth of field and primary cache.
+	 * All faces of a cube map are one image, so any renderer renders them as one job with one space and one thread pool.*/
+	void setProjection(const Projection projection);
+	
+	/** @brief Projection of image.*/
+	Projection getProjection() const;
+	
+	/** @brief Enables or disables cache of primary hits (disabled by default).
+	 * 
+	 * Cache uses about 80 bytes per pixel. Hits are stored by calcColor(), so the first render fills the cache.*/
+	void setPrimaryCache(const bool enabled);
+	
+	/** @brief Forgets cached primary hits. Has to be called when space changes: camera can not see that.*/
+	void clearPrimaryCache();
+	
+	/**
+	 * @brief Sets if moving the camera keeps cached primary hits (disabled by default).
+	 * 
+	 * When enabled, changes of position, direction or angle of view only mark the cache as moved: it is not used until updatePrimaryCache() is called.
+	 */
+	void setReprojection(const bool enabled);
+	
+	/**
+	 * @brief Moves cached primary hits into the current pose of camera. Has to be called before rendering if camera was moved with reprojection enabled.
+	 * 
+	 * Each hit is put to the pixel that sees its position now, the closer one wins if more hits fall into a pixel.
+	 * Pixels that got no hit (they came into view) and pixels next to much closer ones (edges of objects, where hidden parts may become visible) stay empty and are traced by calcColor().
+	 * Colors are kept: reflections are a bit off until the pixel is traced again.
+	 */
+	void updatePrimaryCache();
+	
+	/** @brief True if primary hit of each pixel is cached.*/
+	bool isPrimaryCached() const;
+	
+	/** @brief Cached primary hit of x,y pixel (same coordinates as calcColor()), 0 if it is not cached.*/
+	const PrimaryHit * getPrimaryHit(const int x, const int y) const;
+	
+	/** @brief True if each pixel is calculated by only the ray from the center of the lens: no depth of field or density 1.*/
+	bool isPinhole() const;
+	
+	/** @brief Sets if depth of field is estimated from cached primary hits instead of tracing rays.
+	 * 
+	 * Colors of pixels are blurred by their depth: very fast, but blurred objects don't show what is behind them. Used only when isPrimaryCached().*/
+	void setDofPreview(const bool preview);
+	
 	/** @brief Calculates color of x,y pixel.
 	 * 
-	 * 0,0 is direction of camera.*/
+	 * 0,0 is direction of camera. Pinhole cameras use cached primary hits if there are.*/
 	Color calcColor(const int x, const int y) const;
+	
+	/**
+	 * @brief Calculates color of x,y pixel and auxiliary data for Denoiser.
+	 * 
+	 * @param normal normal vector of hit surfaces (average of rays of pixel)
+	 * @param depth distance of hits, infinite if nothing is hit
+	 * @param albedo active color of hit surfaces*/
+	Color calcColor(const int x, const int y, Vect3D & normal, float & depth, Color & albedo) const;
+	
+	/**
+	 * @brief Calculates color of one ray of x,y pixel (same coordinates as calcColor()), for renderers that decide the number of rays of each pixel.
+	 * 
+	 * Ray goes through the sample-th point of a Halton sequence inside the pixel and starts from an other one on the lens (circle of dof radius).
+	 * Average of the first n samples converges to the pixel with antialiasing and depth of field as n grows: density and primary cache are not used.*/
+	Color calcSample(const int x, const int y, const unsigned int sample) const;
+	
+	/**
+	 * @brief Sum of colors of every parts-th ray of x,y pixel starting from the part-th one, so more threads can calculate a pixel.
+	 * 
+	 * Sum of all parts divided by getRaysPerPixel() is the color of calcColor() without primary cache.
+	 * @param count number of rays summed
+	 */
+	Color sumRays(const int x, const int y, const unsigned int part, const unsigned int parts, unsigned int & count) const;
+	
+	/** @brief Number of rays of a pixel shot by calcColor() (without primary cache): depends on depth of field and density.*/
+	unsigned int getRaysPerPixel() const;
 private:
 	float fdist;
 	float dof;	//depth of field
 	float density;	//density of rays per each pixels
+	Projection projection;
+	bool cacheEnabled;
+	bool dofPreview;
+	bool reprojection;
+	bool moved;	//pose changed since cache was filled or reprojected
+	mutable std::vector<PrimaryHit> primary;	//G-buffer: each pixel is written only by the thread rendering it
+	mutable std::vector<unsigned char> cached;	//1 if pixel of primary is set
+	mutable QAtomicInt cachedCount;
+	
+	ViewRayGroup rayGroup(const int x, const int y) const;	//rays of x,y pixel
+	bool panoramaDir(const float col, const float row, Vect3D & result) const;	//direction of a point of image (0,0 is its top left corner) of a panorama, false between faces of cube map
+	Color calcPanorama(const float col, const float row, Vect3D & normal, float & depth, Color & albedo) const;
+	unsigned int index(const int x, const int y) const;	//position of pixel in primary
+	void poseChanged();	//clears cache or marks it for reprojection
+	PrimaryHit calcPrimary(const int x, const int y) const;	//shoots ray from center of lens
+	float calcCoc(const float depth) const;	//radius of blur in pixels at depth (circle of confusion)
+	Color calcDofPreview(const int x, const int y) const;	//blurs cached colors by their depth
 };
 
 /** @brief Spread group of fotonrays in order to estimate lighing.
@@ -0,0 +1,75 @@
+#include "CameraPath.h"
+
+#include <QFile>
+
+#include <cmath>
+#include <cstdio>
+
+//--------------------------------------CameraPath----------------------------------------------------------------
+void CameraPath::addKey(const float frame, const Vect3D pos, const float lon, const float lat, const float twi, const float focus, const float dof) {
+	Key key;
+	key.frame = frame;
+	const float v[CHANNELS] = {pos.getX(), pos.getY(), pos.getZ(), lon, lat, twi, focus, dof};
+	for(unsigned int i=0; i<CHANNELS; i++) key.v[i] = v[i];
+
+	unsigned int i = 0;
+	while(i < keys.size() && keys[i].frame < frame) i++;
+	if(i < keys.size() && keys[i].frame == frame) keys[i] = key;
+	else keys.insert(keys.begin() + i, key);
+}
+bool CameraPath::load(const QString & fileName) {
+	QFile file(fileName);
+	if(! file.open(QIODevice::ReadOnly)) return false;
+	char line[256];
+	while(file.readLine(line, sizeof(line)) > 0) {
+		const char * s = line;
+		while(*s == ' ' || *s == '\t') s++;
+		if(! *s || *s == '\n' || *s == '\r' || *s == '#') continue;
+		float f, x, y, z, lon, lat, twi, focus, dof;
+		if(std::sscanf(s, "%f %f %f %f %f %f %f %f %f", &f, &x, &y, &z, &lon, &lat, &twi, &focus, &dof) != 9) return false;
+		addKey(f, Vect3D(x,y,z), lon, lat, twi, focus, dof);
+	}
+	return true;
+}
+unsigned int CameraPath::getFrameCount() const {
+	if(keys.empty() || keys.back().frame < 0) return 0;
+	return (unsigned int)std::floor(keys.back().frame) + 1;
+}
+void CameraPath::setCamera(RayTracerCam & cam, const float frame) const {
+	if(keys.empty()) return;
+	float v[CHANNELS];
+	unsigned int k = 0;	//frame is in [k,k+1]
+	while(k+2 < keys.size() && keys[k+1].frame <= frame) k++;
+	if(keys.size() == 1 || frame <= keys.front().frame || frame >= keys.back().frame) {
+		const Key & key = frame <= keys.front().frame ? keys.front() : keys.back();
+		for(unsigned int i=0; i<CHANNELS; i++) v[i] = key.v[i];
+	} else {
+		//cubic Hermite curve between key k and k+1, tangents point from the previous key to the next one
+		const Key & a = keys[k];
+		const Key & b = keys[k+1];
+		const Key & before = keys[k ? k-1 : k];
+		const Key & after = keys[k+2 < keys.size() ? k+2 : k+1];
+		const float length = b.frame - a.frame;
+		const float t = (frame - a.frame) / length;
+		const float t2 = t*t;
+		const float t3 = t2*t;
+		const float h00 = 2*t3 - 3*t2 + 1;
+		const float h10 = t3 - 2*t2 + t;
+		const float h01 = -2*t3 + 3*t2;
+		const float h11 = t3 - t2;
+		for(unsigned int i=0; i<CHANNELS; i++) {
+			const float ta = (b.v[i] - before.v[i]) / (b.frame - before.frame) * length;
+			const float tb = (after.v[i] - a.v[i]) / (after.frame - a.frame) * length;
+			v[i] = h00*a.v[i] + h10*ta + h01*b.v[i] + h11*tb;
+		}
+	}
+
+	GeoRot3D rot;
+	rot.rotLon(Rot2D(v[3]));
+	rot.rotLat(Rot2D(v[4]));
+	rot.rotTwi(Rot2D(v[5]));
+	cam.setPos(Vect3D(v[0], v[1], v[2]));
+	cam.setHVDir(rot);
+	cam.setFocusDist(v[6]);
+	cam.setDof(v[7]);
+}
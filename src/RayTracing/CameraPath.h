@@ -0,0 +1,48 @@
+/**
+ * @file CameraPath.h
+ * @brief keyframed camera movement for animations
+ */
+
+#ifndef CAMERAPATH_H
+#define CAMERAPATH_H
+
+#include "Camera.h"
+
+#include <QString>
+
+#include <vector>
+
+/**
+ * @brief Position, direction, focus and depth of field of a camera at given frames, smoothly interpolated between them.
+ *
+ * Each value is interpolated by a Catmull-Rom spline through the keys, so the camera doesn't stop or jerk at keys.
+ * Direction is given by GeoRot3D angles (longitude, latitude, twist with the units of Rot2D: M_PI is 360°).
+ */
+class CameraPath {
+public:
+	/** @brief Adds a key, keys can be added in any order. A key at the frame of an other one replaces it.*/
+	void addKey(const float frame, const Vect3D pos, const float lon, const float lat, const float twi, const float focus, const float dof);
+
+	/**
+	 * @brief Reads keys from a text file: one key in each line, "frame x y z lon lat twi focus dof".
+	 *
+	 * Empty lines and lines starting with # are skipped.
+	 * @return false if file can not be read or a line is not a key
+	 */
+	bool load(const QString & fileName);
+
+	/** @brief Number of frames: last key is the last frame, 0 if there are no keys.*/
+	unsigned int getFrameCount() const;
+
+	/** @brief Sets position, direction, focus and depth of field of cam to the ones at frame.*/
+	void setCamera(RayTracerCam & cam, const float frame) const;
+private:
+	static const unsigned int CHANNELS = 8;	//x, y, z, lon, lat, twi, focus, dof
+	struct Key {
+		float frame;
+		float v[CHANNELS];
+	};
+	std::vector<Key> keys;	//ordered by frame
+};
+
+#endif
@@ -0,0 +1,191 @@
+#include "Denoiser.h"
+#include "TaskGroup.h"
+
+#include <QRunnable>
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
+
+namespace {
+	const float KERNEL[5] = {1.0f/16, 1.0f/4, 3.0f/8, 1.0f/4, 1.0f/16};	//B3 spline: weights of neighbours -2..2
+	const unsigned int ROWSPERTASK = 16;	//rows filtered by one task
+	const int CHUNK = 64;	//pixels of a row whose sums are kept on the stack
+
+	/*
+	 * e^-e for e >= 0, relative error below 6e-6, 0 from 64 on. std::exp is a library call that stops the vectorisation of the inner loop of filter.
+	 * e^-e = 2^n * e^u where n is the integer closest to -e*log2(e) and |u| <= ln2/2 is approximated by its Taylor series.
+	 * There is no branch on floats and no float to int conversion (compilers do not if-convert those as they may trap): e is compared and clamped on its bits
+	 * (order of non-negative floats is the order of their bits) and n is rounded by adding 1.5*2^23, which leaves it in the low bits of the sum.
+	 * Weights of far neighbours are exactly 0, as tiny ones would make the sums denormal, which is many times slower.
+	 */
+	inline float expNegative(const float e) {
+		const int LIMIT = 0x42800000;	//bits of 64
+		int bits;
+		std::memcpy(&bits, &e, sizeof(bits));
+		const bool far = bits >= LIMIT;
+		bits = std::min(bits, LIMIT);
+		float clamped;
+		std::memcpy(&clamped, &bits, sizeof(clamped));
+		const float t = clamped * -1.44269504f;	//e^-e = 2^t
+		const float rounded = t + 12582912.0f;
+		const float u = (t - (rounded - 12582912.0f)) * 0.693147181f;
+		const float p = 1 + u*(1 + u*(1.0f/2 + u*(1.0f/6 + u*(1.0f/24 + u*(1.0f/120)))));
+		std::memcpy(&bits, &rounded, sizeof(bits));
+		bits = far ? 0 : (bits - 0x4b400000 + 127) << 23;	//n is the difference of the bits of rounded and 1.5*2^23, it goes to the exponent field of 2^n
+		float scale;
+		std::memcpy(&scale, &bits, sizeof(scale));
+		return p * scale;
+	}
+}
+
+//filters a band of rows of one iteration
+class DenoiseTask : public QRunnable {
+public:
+	DenoiseTask(const Denoiser & denoiser, const FrameBuffer & in, FrameBuffer & out, const unsigned int step, const float sigmaColor, const unsigned int firstRow, const unsigned int endRow)
+		: denoiser(denoiser), in(in), out(out), step(step), sigmaColor(sigmaColor), firstRow(firstRow), endRow(endRow) {}
+	void run() {denoiser.filterRows(in, out, step, sigmaColor, firstRow, endRow);}
+private:
+	const Denoiser & denoiser;
+	const FrameBuffer & in;
+	FrameBuffer & out;
+	const unsigned int step;
+	const float sigmaColor;
+	const unsigned int firstRow, endRow;
+};
+//--------------------------------------FrameBuffer----------------------------------------------------------------
+FrameBuffer::FrameBuffer() {
+	width = 0;
+	height = 0;
+}
+void FrameBuffer::resize(const unsigned int width, const unsigned int height) {
+	this->width = width;
+	this->height = height;
+	const unsigned int size = width*height;
+	r.assign(size, 0);
+	g.assign(size, 0);
+	b.assign(size, 0);
+	nx.assign(size, 0);
+	ny.assign(size, 0);
+	nz.assign(size, 0);
+	depth.assign(size, std::numeric_limits<float>::max());
+	ar.assign(size, 0);
+	ag.assign(size, 0);
+	ab.assign(size, 0);
+}
+unsigned int FrameBuffer::getWidth() const		{return width;}
+unsigned int FrameBuffer::getHeight() const		{return height;}
+void FrameBuffer::setColor(const unsigned int x, const unsigned int y, const Color color) {
+	const unsigned int i = y*width + x;
+	r[i] = color.getR();
+	g[i] = color.getG();
+	b[i] = color.getB();
+}
+Color FrameBuffer::getColor(const unsigned int x, const unsigned int y) const {
+	const unsigned int i = y*width + x;
+	return Color(r[i], g[i], b[i]);
+}
+void FrameBuffer::setAux(const unsigned int x, const unsigned int y, const Vect3D normal, const float depth, const Color albedo) {
+	const unsigned int i = y*width + x;
+	const float len = std::sqrt(normal*normal);
+	const float inv = len > 0 ? 1 / len : 0;	//no hit: null vector
+	nx[i] = normal.getX() * inv;
+	ny[i] = normal.getY() * inv;
+	nz[i] = normal.getZ() * inv;
+	this->depth[i] = std::min(depth, std::numeric_limits<float>::max());	//infinite depth would make nan differences
+	ar[i] = albedo.getR();
+	ag[i] = albedo.getG();
+	ab[i] = albedo.getB();
+}
+//--------------------------------------Denoiser----------------------------------------------------------------
+Denoiser::Denoiser() {
+	iterations = 5;
+	setSigmas(0.5f, 0.1f, 0.05f, 0.1f);
+}
+void Denoiser::setIterations(const unsigned int iterations)	{this->iterations = iterations;}
+void Denoiser::setSigmas(const float color, const float normal, const float depth, const float albedo) {
+	sigmaColor = color;
+	sigmaNormal = normal;
+	sigmaDepth = depth;
+	sigmaAlbedo = albedo;
+}
+void Denoiser::filter(FrameBuffer & buffer) const {
+	if(! buffer.width || ! buffer.height) return;
+	FrameBuffer temp(buffer);	//iterations ping-pong between the 2 buffers
+	FrameBuffer * in = &buffer;
+	FrameBuffer * out = &temp;
+	TaskGroup group;
+	for(unsigned int i=0; i<iterations; i++) {
+		const unsigned int step = 1u << i;
+		const float sigma = sigmaColor / step;	//later iterations average farther pixels: only very similar colors
+		for(unsigned int row=0; row<buffer.height; row+=ROWSPERTASK)
+			group.start(new DenoiseTask(*this, *in, *out, step, sigma, row, std::min(row+ROWSPERTASK, buffer.height)));
+		group.wait();
+		std::swap(in, out);
+	}
+	if(in != &buffer) {
+		buffer.r.swap(in->r);
+		buffer.g.swap(in->g);
+		buffer.b.swap(in->b);
+	}
+}
+//privates:
+void Denoiser::filterRows(const FrameBuffer & in, FrameBuffer & out, const unsigned int step, const float sigmaColor, const unsigned int firstRow, const unsigned int endRow) const {
+	const int width = in.width;
+	const int height = in.height;
+	const float colorFactor = 1 / (sigmaColor*sigmaColor);
+	const float normalFactor = 1 / sigmaNormal;
+	const float depthFactor = 1 / sigmaDepth;
+	const float albedoFactor = 1 / (sigmaAlbedo*sigmaAlbedo);
+	for(unsigned int y=firstRow; y<endRow; y++) {
+		const int p = y*width;	//first pixel of row
+		//sums of a chunk are local arrays: the compiler knows that they are not the arrays of in, so it needs no alias checks to vectorise
+		for(int x0=0; x0<width; x0+=CHUNK) {
+			const int x1 = std::min(x0 + CHUNK, width);
+			float sumR[CHUNK], sumG[CHUNK], sumB[CHUNK], sumW[CHUNK];
+			std::fill(sumR, sumR + CHUNK, 0.0f);
+			std::fill(sumG, sumG + CHUNK, 0.0f);
+			std::fill(sumB, sumB + CHUNK, 0.0f);
+			std::fill(sumW, sumW + CHUNK, 0.0f);
+
+			//each neighbour offset is applied to the whole chunk at once: inner loop is a plain walk along the arrays
+			for(int ky=-2; ky<=2; ky++) {
+				const int row = (int)y + ky*(int)step;
+				if(row < 0 || row >= height) continue;
+				for(int kx=-2; kx<=2; kx++) {
+					const int ox = kx*(int)step;
+					const int xmin = std::max(x0, -ox);
+					const int xmax = std::min(x1, width - ox);
+					const int q = row*width + ox;	//neighbour of pixel x is q+x
+					const float h = KERNEL[ky+2] * KERNEL[kx+2];
+					for(int x=xmin; x<xmax; x++) {
+						const float dr = in.r[p+x] - in.r[q+x];
+						const float dg = in.g[p+x] - in.g[q+x];
+						const float db = in.b[p+x] - in.b[q+x];
+						const float np2 = in.nx[p+x]*in.nx[p+x] + in.ny[p+x]*in.ny[p+x] + in.nz[p+x]*in.nz[p+x];
+						const float nq2 = in.nx[q+x]*in.nx[q+x] + in.ny[q+x]*in.ny[q+x] + in.nz[q+x]*in.nz[q+x];
+						const float dn = std::max(0.0f, (np2 + nq2)/2 - (in.nx[p+x]*in.nx[q+x] + in.ny[p+x]*in.ny[q+x] + in.nz[p+x]*in.nz[q+x]));	//1 - cosine for unit normals, 0 for 2 pixels that hit nothing
+						const float zp = in.depth[p+x], zq = in.depth[q+x];
+						const float dz = std::fabs(zp - zq) / std::max(std::max(zp, zq), 1e-6f);	//relative: far surfaces are smoothed as much as close ones
+						const float dar = in.ar[p+x] - in.ar[q+x];
+						const float dag = in.ag[p+x] - in.ag[q+x];
+						const float dab = in.ab[p+x] - in.ab[q+x];
+						const float e = (dr*dr + dg*dg + db*db)*colorFactor + dn*normalFactor + dz*depthFactor + (dar*dar + dag*dag + dab*dab)*albedoFactor;
+						const float w = h * expNegative(e);
+						sumR[x-x0] += w * in.r[q+x];
+						sumG[x-x0] += w * in.g[q+x];
+						sumB[x-x0] += w * in.b[q+x];
+						sumW[x-x0] += w;
+					}
+				}
+			}
+			for(int x=x0; x<x1; x++) {
+				const float inv = 1 / sumW[x-x0];	//pixel itself has weight, sum is never 0
+				out.r[p+x] = sumR[x-x0] * inv;
+				out.g[p+x] = sumG[x-x0] * inv;
+				out.b[p+x] = sumB[x-x0] * inv;
+			}
+		}
+	}
+}
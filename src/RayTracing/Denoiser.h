@@ -0,0 +1,96 @@
+/**
+ * @file Denoiser.h
+ * @brief float frame buffer and edge-aware filtering of rendered images
+ *
+ * Rendering with few rays per pixel leaves noise (grainy depth of field). Denoiser smooths it while keeping edges that are visible in the auxiliary buffers: normal, depth and albedo of the primary hits.
+ */
+
+#ifndef DENOISER_H
+#define DENOISER_H
+
+#include "DetailedSpaces.h"
+
+#include <vector>
+
+/**
+ * @brief Image with float colors and auxiliary buffers of the primary hits.
+ *
+ * Each component is stored in its own array (structure of arrays), so filters can process rows of several pixels at once.
+ * Pixels are addressed like QImage: x is column from left, y is row from top.
+ */
+class FrameBuffer {
+public:
+	/** @brief Constructs an empty buffer.*/
+	FrameBuffer();
+
+	/** @brief Sets size, all pixels become black with no hit.*/
+	void resize(const unsigned int width, const unsigned int height);
+
+	/** @brief Number of columns.*/
+	unsigned int getWidth() const;
+
+	/** @brief Number of rows.*/
+	unsigned int getHeight() const;
+
+	/** @brief Setter for color of a pixel.*/
+	void setColor(const unsigned int x, const unsigned int y, const Color color);
+
+	/** @brief Color of a pixel.*/
+	Color getColor(const unsigned int x, const unsigned int y) const;
+
+	/**
+	 * @brief Sets auxiliary data of a pixel: what the ray through its center hits.
+	 *
+	 * @param normal normal vector of hit surface, does not need to be unit length
+	 * @param depth distance of hit, infinite if nothing is hit
+	 * @param albedo active color of hit surface
+	 */
+	void setAux(const unsigned int x, const unsigned int y, const Vect3D normal, const float depth, const Color albedo);
+private:
+	unsigned int width, height;
+	std::vector<float> r, g, b;	//color
+	std::vector<float> nx, ny, nz;	//unit normal vector
+	std::vector<float> depth;
+	std::vector<float> ar, ag, ab;	//albedo
+
+	friend class Denoiser;
+};
+
+/**
+ * @brief Edge-avoiding a-trous wavelet filter.
+ *
+ * Each iteration averages a pixel with 5x5 neighbours that are 2^i pixels apart, so 5 iterations cover 125x125 pixels with 125 samples per pixel.
+ * Neighbours are weighted by how similar they are to the pixel: color, normal, depth and albedo. Edges of objects, sharp shadows and borders of textures are kept, noise inside surfaces is smoothed.
+ * Rows are filtered by all cores. Inner loops go along rows of separate float arrays, so compilers can vectorise them.
+ * Lens rays of RayTracerCam are a regular grid, so its renders have structured error rather than noise: on test scenes filtered images were not closer to a reference than
+ * unfiltered ones with more rays, so the rendering widget doesn't offer it.
+ */
+class Denoiser {
+public:
+	/** @brief Constructs a denoiser with 5 iterations and default sensitivity.*/
+	Denoiser();
+
+	/** @brief Setter for number of iterations: more iterations smooth larger areas.*/
+	void setIterations(const unsigned int iterations);
+
+	/**
+	 * @brief Sets sensitivity of edge stopping functions: a neighbour is ignored if it differs much more than sigma.
+	 *
+	 * @param color difference of colors (halved by each iteration, so noise is smoothed first, details are kept later)
+	 * @param normal 1 - cosine of angle of normals
+	 * @param depth difference of depths compared to depth of pixel
+	 * @param albedo difference of albedos
+	 */
+	void setSigmas(const float color, const float normal, const float depth, const float albedo);
+
+	/** @brief Filters colors of buffer in place.*/
+	void filter(FrameBuffer & buffer) const;
+private:
+	unsigned int iterations;
+	float sigmaColor, sigmaNormal, sigmaDepth, sigmaAlbedo;
+
+	friend class DenoiseTask;
+	void filterRows(const FrameBuffer & in, FrameBuffer & out, const unsigned int step, const float sigmaColor, const unsigned int firstRow, const unsigned int endRow) const;
+};
+
+#endif
@@ -1,8 +1,253 @@
 #include "DetailedSpaces.h"
+#include "Log.h"
+
+#include <QElapsedTimer>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QRunnable>
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+/** @brief builds a new hierarchy for a mesh in background*/
+class MeshRebuild : public QRunnable {
+public:
+	MeshRebuild(const DetailedMesh3D * mesh) : mesh(mesh), boxes(mesh->getBoxes()), method(mesh->getBuildMethod()) {
+		finished = false;
+		setAutoDelete(false);	//space takes the result and deletes it
+	}
+	void run() {
+		BoundingHierarchy result;
+		result.build(boxes, method);
+		QMutexLocker locker(&lock);
+		hierarchy = result;
+		finished = true;
+	}
+	bool isFinished() {
+		QMutexLocker locker(&lock);
+		return finished;
+	}
+	const DetailedMesh3D * const mesh;
+	const std::vector<Box3D> boxes;	//boxes of triangles when rebuild started
+	const BoundingHierarchy::BuildMethod method;
+	BoundingHierarchy hierarchy;
+private:
+	QMutex lock;
+	bool finished;
+};
+
+namespace {
+	const unsigned int NOTRI = std::numeric_limits<unsigned int>::max();	//index of no triangle
+	const unsigned int NOVERTEX = std::numeric_limits<unsigned int>::max();	//vertex without new index yet
+	const int REBUILDPRIORITY = -1;	//background rebuilds run when rendering leaves a thread of the pool free
+
+	//closest triangle of a mesh crossed by a line (in coordinate system of mesh)
+	class ClosestTriVisitor : public HierarchyVisitor {
+	public:
+		ClosestTriVisitor(const DetailedMesh3D & mesh, const Line3D line, const float tmin, const unsigned int skip) : mesh(mesh), line(line), tmin(tmin), skip(skip) {
+			closest = NOTRI;
+			t = 0;
+		}
+		bool visit(const unsigned int prim, float & tmax) {
+			if(prim == skip) return false;
+			const float actt = mesh.distsign(prim, line);
+			if(! (actt >= tmin && actt <= tmax)) return false;	//nan is not in range either
+			closest = prim;
+			t = actt;
+			tmax = actt;	//farther nodes are skipped
+			return false;
+		}
+		unsigned int closest;
+		float t;
+	private:
+		const DetailedMesh3D & mesh;
+		const Line3D line;
+		const float tmin;
+		const unsigned int skip;
+	};
+
+	//any triangle of a mesh crossed by a line (in coordinate system of mesh)
+	class AnyTriVisitor : public HierarchyVisitor {
+	public:
+		AnyTriVisitor(const DetailedMesh3D & mesh, const Line3D line, const float tmin, const unsigned int skip1, const unsigned int skip2) : mesh(mesh), line(line), tmin(tmin), skip1(skip1), skip2(skip2) {}
+		bool visit(const unsigned int prim, float & tmax) {
+			if(prim == skip1 || prim == skip2) return false;
+			const float t = mesh.distsign(prim, line);
+			return t >= tmin && t <= tmax;	//first one is enough
+		}
+	private:
+		const DetailedMesh3D & mesh;
+		const Line3D line;
+		const float tmin;
+		const unsigned int skip1;
+		const unsigned int skip2;
+	};
+
+	//any triangle of a mesh crossed by lines of a group (in coordinate system of mesh)
+	class AnyTriGroupVisitor : public HierarchyGroupVisitor {
+	public:
+		AnyTriGroupVisitor(const DetailedMesh3D & mesh, const std::vector<Line3D> & lines, const float tmin, const float tmax, const std::vector<unsigned int> & skips) : mesh(mesh), lines(lines), tmin(tmin), tmax(tmax), skips(skips) {}
+		unsigned int visit(const unsigned int prim, std::vector<bool> & done) {
+			unsigned int finished = 0;
+			for(unsigned int l=0; l<lines.size(); l++) {
+				if(done[l]) continue;
+				if(prim == skips[2*l] || prim == skips[2*l+1]) continue;
+				const float t = mesh.distsign(prim, lines[l]);
+				if(t >= tmin && t <= tmax) {
+					done[l] = true;
+					finished++;
+				}
+			}
+			return finished;
+		}
+	private:
+		const DetailedMesh3D & mesh;
+		const std::vector<Line3D> & lines;
+		const float tmin, tmax;
+		const std::vector<unsigned int> & skips;	//2 triangles for each line
+	};
+
+	//closest triangle of instances crossed by a line (in coordinate system of space)
+	class ClosestInstVisitor : public HierarchyVisitor {
+	public:
+		ClosestInstVisitor(const std::vector<const DetailedInstance3D*> & insts, const Line3D line, const float tmin, const SpaceCross skip) : insts(insts), line(line), tmin(tmin), skip(skip) {}
+		bool visit(const unsigned int prim, float & tmax) {
+			const DetailedInstance3D * inst = insts[prim];
+			const Line3D oline = inst->getToObject().line(line);	//t is the same on both lines
+			const DetailedShape3D * shape = inst->getShape();
+			if(shape) {
+				const float t = shape->cross(oline, tmin, tmax, skip.getInst() == inst);
+				if(! (t >= tmin)) return false;	//nan: no cross in range
+				closest = SpaceCross(inst, t, shape->getNormal(oline.getP() + oline.getV()*t));
+				tmax = t;
+				return false;
+			}
+			const DetailedMesh3D & mesh = *inst->getMesh();
+			const unsigned int oskip = skip.getInst() == inst ? skip.getTri() : NOTRI;
+
+			ClosestTriVisitor visitor(mesh, oline, tmin, oskip);
+			mesh.getHierarchy().traverse(oline, tmin, tmax, visitor);
+			if(visitor.closest == NOTRI) return false;
+			closest = SpaceCross(inst, visitor.closest, visitor.t);
+			tmax = visitor.t;
+			return false;
+		}
+		SpaceCross closest;
+	private:
+		const std::vector<const DetailedInstance3D*> & insts;
+		const Line3D line;
+		const float tmin;
+		const SpaceCross skip;
+	};
+
+	//any triangle of instances crossed by a line (in coordinate system of space)
+	class AnyInstVisitor : public HierarchyVisitor {
+	public:
+		AnyInstVisitor(const std::vector<const DetailedInstance3D*> & insts, const Line3D line, const float tmin, const SpaceCross skip1, const SpaceCross skip2) : insts(insts), line(line), tmin(tmin), skip1(skip1), skip2(skip2) {}
+		bool visit(const unsigned int prim, float & tmax) {
+			const DetailedInstance3D * inst = insts[prim];
+			const Line3D oline = inst->getToObject().line(line);
+			const DetailedShape3D * shape = inst->getShape();
+			if(shape) return shape->cross(oline, tmin, tmax, skip1.getInst() == inst, skip2.getInst() == inst) >= tmin;
+			const DetailedMesh3D & mesh = *inst->getMesh();
+			const unsigned int oskip1 = skip1.getInst() == inst ? skip1.getTri() : NOTRI;
+			const unsigned int oskip2 = skip2.getInst() == inst ? skip2.getTri() : NOTRI;
+
+			AnyTriVisitor visitor(mesh, oline, tmin, oskip1, oskip2);
+			return mesh.getHierarchy().traverse(oline, tmin, tmax, visitor);
+		}
+	private:
+		const std::vector<const DetailedInstance3D*> & insts;
+		const Line3D line;
+		const float tmin;
+		const SpaceCross skip1, skip2;
+	};
+
+	//any triangle of instances crossed by lines of a group (in coordinate system of space)
+	class AnyInstGroupVisitor : public HierarchyGroupVisitor {
+	public:
+		AnyInstGroupVisitor(const std::vector<const DetailedInstance3D*> & insts, const std::vector<Line3D> & lines, const float tmin, const float tmax, const std::vector<SpaceCross> & skips1, const std::vector<SpaceCross> & skips2) : insts(insts), lines(lines), tmin(tmin), tmax(tmax), skips1(skips1), skips2(skips2) {}
+		unsigned int visit(const unsigned int prim, std::vector<bool> & done) {
+			const DetailedInstance3D * inst = insts[prim];
+			const Transform3D toObject = inst->getToObject();
+			const DetailedShape3D * shape = inst->getShape();
+			if(shape) {
+				unsigned int finished = 0;
+				for(unsigned int l=0; l<lines.size(); l++)
+					if(! done[l] && shape->cross(toObject.line(lines[l]), tmin, tmax, skips1[l].getInst() == inst, skips2[l].getInst() == inst) >= tmin) {
+						done[l] = true;
+						finished++;
+					}
+				return finished;
+			}
+			const DetailedMesh3D & mesh = *inst->getMesh();
+
+			//lines are transformed once for the instance, then the mesh is walked once for all of them
+			std::vector<Line3D> olines(lines.size());
+			std::vector<unsigned int> oskips(2*lines.size(), NOTRI);
+			for(unsigned int l=0; l<lines.size(); l++) {
+				if(done[l]) continue;
+				olines[l] = toObject.line(lines[l]);
+				if(skips1[l].getInst() == inst) oskips[2*l] = skips1[l].getTri();
+				if(skips2[l].getInst() == inst) oskips[2*l+1] = skips2[l].getTri();
+			}
+			AnyTriGroupVisitor visitor(mesh, olines, tmin, tmax, oskips);
+			return mesh.getHierarchy().traverse(olines, tmin, tmax, done, visitor);
+		}
+	private:
+		const std::vector<const DetailedInstance3D*> & insts;
+		const std::vector<Line3D> & lines;
+		const float tmin, tmax;
+		const std::vector<SpaceCross> & skips1;
+		const std::vector<SpaceCross> & skips2;
+	};
+
+	//triangles of an instance in a region (region is in coordinate system of space)
+	class TriRegionVisitor : public HierarchyRegionVisitor {
+	public:
+		TriRegionVisitor(const DetailedInstance3D & inst, const Frustum3D & frustum, SpaceRegionVisitor & visitor) : inst(inst), toWorld(inst.getToWorld()), frustum(frustum), visitor(visitor) {}
+		Frustum3D::Overlap overlap(const Box3D box) {return frustum.overlap(toWorld.box(box));}	//box in space contains the transformed box => result is still conservative
+		void visit(const unsigned int prim, const bool inside) {visitor.visit(inst, prim, inside);}
+	private:
+		const DetailedInstance3D & inst;
+		const Transform3D toWorld;
+		const Frustum3D & frustum;
+		SpaceRegionVisitor & visitor;
+	};
+
+	//instances in a region
+	class InstRegionVisitor : public HierarchyRegionVisitor {
+	public:
+		InstRegionVisitor(const std::vector<const DetailedInstance3D*> & insts, const Frustum3D & frustum, SpaceRegionVisitor & visitor) : insts(insts), frustum(frustum), visitor(visitor) {}
+		Frustum3D::Overlap overlap(const Box3D box) {return frustum.overlap(box);}
+		void visit(const unsigned int prim, const bool inside) {
+			const DetailedInstance3D & inst = *insts[prim];
+			if(inst.getShape()) {
+				visitor.visitShape(inst, inside);
+				return;
+			}
+			const DetailedMesh3D & mesh = *inst.getMesh();
+			if(inside) {
+				for(unsigned int i=0; i<mesh.size(); i++) visitor.visit(inst, i, true);	//no need to walk the mesh
+				return;
+			}
+			TriRegionVisitor triVisitor(inst, frustum, visitor);
+			mesh.getHierarchy().traverse(triVisitor);
+		}
+	private:
+		const std::vector<const DetailedInstance3D*> & insts;
+		const Frustum3D & frustum;
+		SpaceRegionVisitor & visitor;
+	};
+}
 //--------------------------------------CrossableTri3D----------------------------------------------------------------
 CrossableTri3D::CrossableTri3D() {}
-CrossableTri3D::CrossableTri3D(const Vect3D a, const Vect3D b, const Vect3D c) {
-	set(a,b,c);
+CrossableTri3D::CrossableTri3D(const Vect3D a, const Vect3D b, const Vect3D c) {set(a,b,c);}
+void CrossableTri3D::set(const Vect3D a, const Vect3D b, const Vect3D c) {
+	this->a = a;
+	this->b = b;
+	this->c = c;
 	s = Plane3D(a,b,c);	//s points up if verticies are in ACW
 
 	//there are 2 rules for planes of sides:
@@ -17,11 +262,6 @@ CrossableTri3D::CrossableTri3D(const Vect3D a, const Vect3D b, const Vect3D c) {
 	ca = Plane3D(c,a, d);
 	ab = Plane3D(a,b, d);
 }
-void CrossableTri3D::set(const Vect3D a, const Vect3D b, const Vect3D c) {
-	this->a = a;
-	this->b = b;
-	this->c = c;
-}
 Plane3D CrossableTri3D::surface() const {return s;}
 bool CrossableTri3D::isCrossed(const Line3D line) const {
 	if(line.isParallel(s)) return false;
@@ -38,8 +278,39 @@ bool CrossableTri3D::isCrossed(const HalfLine3D hline) const {
 }
 
 bool CrossableTri3D::isCrossed(const Sect3D sect) const {
-	if(! sect.isCrossing(s)) return false;
-	return isCrossed((Line3D)sect);	//TODO: there is a faster way: if we open both functions here then we can reuse t
+	//Sect3D::isCrossing and isCrossed(Line3D) opened here: t is calculated only once
+	//used by visibility checks (ShadowRay) for each triangle => worth it
+	const Vect3D n = s.getN();
+	const Vect3D v = sect.getV();
+	const float vn = v*n;
+	if(! vn) return false;	//parallel
+
+	const float t = ((s.getP()-sect.getP()) * n) / vn;
+	if(t < 0 || t > 1) return false;	//crosspoint is out of section
+
+	const Vect3D p = sect.getP() + v*t;
+	if(bc.distsign(p) < 0 || ca.distsign(p) < 0 || ab.distsign(p) < 0) return false;
+	return true;
+}
+
+float CrossableTri3D::distsign(const Line3D line) const {
+	const float nan = std::numeric_limits<float>::quiet_NaN();
+	const Vect3D n = s.getN();
+	const Vect3D v = line.getV();
+	const float vn = v*n;
+	if(! vn) return nan;	//parallel
+
+	const float t = ((s.getP()-line.getP()) * n) / vn;
+	const Vect3D p = line.getP() + v*t;
+	if(bc.distsign(p) < 0 || ca.distsign(p) < 0 || ab.distsign(p) < 0) return nan;
+	return t;
+}
+Box3D CrossableTri3D::getBox() const {
+	Box3D result;
+	result.extend(a);
+	result.extend(b);
+	result.extend(c);
+	return result;
 }
 
 Vect3D CrossableTri3D::getA() const {return a;}
@@ -49,7 +320,7 @@ Vect3D CrossableTri3D::getC() const {return c;}
 Color::Color()		{set(0,0,0);}
 Color::Color(const float r, const float g, const float b)		{set(r,g,b);}
 void Color::set(const float r, const float g, const float b)	{this->r=r;this->g=g;this->b=b;}
-bool Color::operator==(const Color o) const	{return r==o.r && b==o.g && g==o.b;}
+bool Color::operator==(const Color o) const	{return r==o.r && g==o.g && b==o.b;}
 bool Color::operator!=(const Color o) const	{return ! operator==(o);}
 Color Color::operator+(const Color o) const	{return Color(r+o.r, g+o.g, b+o.b);}
 Color Color::operator*(const Color o) const	{return Color(r*o.r, g*o.g, b*o.b);}
@@ -58,6 +329,19 @@ void Color::operator+=(const Color o)			{r+=o.r; g+=o.g; b+=o.b;}
 float Color::getR() const	{return r;}
 float Color::getG() const	{return g;}
 float Color::getB() const	{return b;}
+//--------------------------------------Material----------------------------------------------------------------
+Material::Material()									{refr = 1;}
+void Material::setActive(const Color active)			{this->active = active;}
+void Material::setRefl(const Color refl)				{this->refl = refl;}
+void Material::setTransp(const Color transp)			{this->transp = transp;}
+void Material::setRefr(const float refr)				{this->refr = refr;}
+Color Material::getActive() const						{return active;}
+Color Material::getRefl() const							{return refl;}
+Color Material::getTransp() const						{return transp;}
+float Material::getRefr() const							{return refr;}
+bool Material::operator==(const Material o) const {
+	return active == o.active && refl == o.refl && transp == o.transp && refr == o.refr;
+}
 //--------------------------------------Foton----------------------------------------------------------------
 Foton::Foton() {}
 Foton::Foton(const Vect3D pos, const Color color) {
@@ -67,7 +351,7 @@ Foton::Foton(const Vect3D pos, const Color color) {
 Vect3D Foton::getPos() const		{return pos;}
 Color Foton::getColor() const		{return color;}
 //--------------------------------------DetailedTri3D----------------------------------------------------------------
-DetailedTri3D::DetailedTri3D(const Vect3D a, const Vect3D b, const Vect3D c) : CrossableTri3D(a,b,c)		{}
+DetailedTri3D::DetailedTri3D(const Vect3D a, const Vect3D b, const Vect3D c) : CrossableTri3D(a,b,c)		{refr = 1;}
 void DetailedTri3D::setActive(const Color active)		{this->active = active;}
 void DetailedTri3D::setRefl(const Color refl)			{this->refl = refl;}
 void DetailedTri3D::setTransp(const Color transp)		{this->transp = transp;}
@@ -76,6 +360,14 @@ Color DetailedTri3D::getActive() const					{return active;}
 Color DetailedTri3D::getRefl() const					{return refl;}
 Color DetailedTri3D::getTransp() const					{return transp;}
 float DetailedTri3D::getRefr() const					{return refr;}
+Material DetailedTri3D::getMaterial() const {
+	Material result;
+	result.setActive(active);
+	result.setRefl(refl);
+	result.setTransp(transp);
+	result.setRefr(refr);
+	return result;
+}
 void DetailedTri3D::addFoton(const Foton foton) const	{fotons.push_back(foton);}
 Color DetailedTri3D::getBrightess(const Vect3D pos, const float r) const {
 	Color result;
@@ -85,12 +377,507 @@ Color DetailedTri3D::getBrightess(const Vect3D pos, const float r) const {
 	}
 	return result;
 }
+//--------------------------------------DetailedMesh3D----------------------------------------------------------------
+DetailedMesh3D::DetailedMesh3D() {
+	method = BoundingHierarchy::BINNED_SAH;
+	lazy = false;
+	built = false;
+	moved = false;
+}
+void DetailedMesh3D::reserve(const unsigned int vertices, const unsigned int tris, const unsigned int materials) {
+	this->vertices.reserve(vertices);
+	this->tris.reserve(3*tris);
+	materialIds.reserve(tris);
+	this->materials.reserve(materials);
+}
+unsigned int DetailedMesh3D::addVertex(const Vect3D v) {
+	vertices.push_back(v);
+	return vertices.size()-1;
+}
+unsigned int DetailedMesh3D::addMaterial(const Material material) {
+	materials.push_back(material);
+	return materials.size()-1;
+}
+void DetailedMesh3D::addTri(const unsigned int a, const unsigned int b, const unsigned int c, const unsigned int material) {
+	tris.push_back(a);
+	tris.push_back(b);
+	tris.push_back(c);
+	materialIds.push_back(material);
+	built = false;
+}
+void DetailedMesh3D::push_back(const DetailedTri3D tri) {
+	const Material material = tri.getMaterial();
+	if(materials.empty() || ! (materials.back() == material)) addMaterial(material);
+	const unsigned int a = addVertex(tri.getA());
+	const unsigned int b = addVertex(tri.getB());
+	const unsigned int c = addVertex(tri.getC());
+	addTri(a,b,c, materials.size()-1);
+}
+unsigned int DetailedMesh3D::size() const											{return materialIds.size();}
+unsigned int DetailedMesh3D::getVertexCount() const								{return vertices.size();}
+Vect3D DetailedMesh3D::getVertex(const unsigned int i) const						{return vertices[i];}
+Vect3D DetailedMesh3D::getVertex(const unsigned int i, const unsigned int k) const	{return vertices[tris[3*i+k]];}
+const Material & DetailedMesh3D::getMaterial(const unsigned int i) const			{return materials[materialIds[i]];}
+Vect3D DetailedMesh3D::getNormal(const unsigned int i) const {
+	const Vect3D a = getVertex(i,0);
+	return Vect3D(getVertex(i,1)-a, getVertex(i,2)-a);	//same as Plane3D(a,b,c)
+}
+float DetailedMesh3D::distsign(const unsigned int i, const Line3D line) const {
+	//Moller-Trumbore: cross point in barycentric coordinates, nothing is stored per triangle
+	const float nan = std::numeric_limits<float>::quiet_NaN();
+	const Vect3D a = getVertex(i,0);
+	const Vect3D ab = getVertex(i,1) - a;
+	const Vect3D ac = getVertex(i,2) - a;
+	const Vect3D v = line.getV();
+	const Vect3D pv = Vect3D(v, ac);
+	const float det = ab*pv;
+	if(! det) return nan;	//parallel
+
+	const Vect3D ap = line.getP() - a;
+	const float u = (ap*pv) / det;
+	if(u < 0 || u > 1) return nan;
+
+	const Vect3D q = Vect3D(ap, ab);
+	const float w = (v*q) / det;
+	if(w < 0 || u+w > 1) return nan;
+
+	return (ac*q) / det;
+}
+void DetailedMesh3D::moveVertex(const unsigned int i, const Vect3D pos) {
+	vertices[i] = pos;
+	moved = true;
+}
+void DetailedMesh3D::build(const BoundingHierarchy::BuildMethod method, const bool lazy) {
+	if(! built || method != this->method || (lazy && ! this->lazy)) hierarchy.build(getBoxes(), method, lazy);
+	else if(moved) hierarchy.refit(getBoxes());
+	this->method = method;
+	this->lazy = lazy;
+	built = true;
+	moved = false;
+}
+void DetailedMesh3D::reorder() {
+	if(! built) build(method, lazy);
+	const std::vector<unsigned int> order = hierarchy.reorder();
+	const std::vector<unsigned int> oldTris(tris);
+	const std::vector<unsigned int> oldIds(materialIds);
+	for(unsigned int i=0; i<order.size(); i++) {
+		for(unsigned int k=0; k<3; k++) tris[3*i+k] = oldTris[3*order[i]+k];
+		materialIds[i] = oldIds[order[i]];
+	}
+
+	//vertices are renumbered in the order of their first use, so neighbouring triangles read neighbouring vertices
+	std::vector<Vect3D> oldVertices;
+	oldVertices.swap(vertices);
+	vertices.reserve(oldVertices.size());
+	std::vector<unsigned int> newIndex(oldVertices.size(), NOVERTEX);
+	for(unsigned int i=0; i<tris.size(); i++) {
+		unsigned int & v = newIndex[tris[i]];
+		if(v == NOVERTEX) {
+			v = vertices.size();
+			vertices.push_back(oldVertices[tris[i]]);
+		}
+		tris[i] = v;
+	}
+	for(unsigned int i=0; i<oldVertices.size(); i++) if(newIndex[i] == NOVERTEX) vertices.push_back(oldVertices[i]);	//unused ones at the end
+}
+bool DetailedMesh3D::compress(const unsigned int bits)	{return hierarchy.compress(bits);}
+void DetailedMesh3D::invalidate()	{built = false;}
+BoundingHierarchy::BuildMethod DetailedMesh3D::getBuildMethod() const	{return method;}
+const BoundingHierarchy & DetailedMesh3D::getHierarchy() const	{return hierarchy;}
+void DetailedMesh3D::setHierarchy(const BoundingHierarchy & hierarchy) {
+	this->hierarchy = hierarchy;
+	moved = true;
+}
+std::vector<Box3D> DetailedMesh3D::getBoxes() const {
+	std::vector<Box3D> result(size());
+	for(unsigned int i=0; i<size(); i++)
+		for(unsigned int k=0; k<3; k++) result[i].extend(getVertex(i,k));
+	return result;
+}
+float DetailedMesh3D::getDegradation() const {
+	const float buildCost = hierarchy.getBuildCost();
+	return buildCost ? hierarchy.getCost() / buildCost : 1;
+}
+Box3D DetailedMesh3D::getBox() const							{return hierarchy.getBox();}
+std::size_t DetailedMesh3D::getMemory() const {
+	const std::size_t geometry = vertices.capacity()*sizeof(Vect3D) + tris.capacity()*sizeof(unsigned int) + materialIds.capacity()*sizeof(unsigned int) + materials.capacity()*sizeof(Material);
+	return geometry + hierarchy.getMemory();
+}
+//--------------------------------------DetailedShape3D----------------------------------------------------------------
+DetailedShape3D::DetailedShape3D(const Vect3D center, const float r) {
+	type = SPHERE;
+	this->center = center;
+	this->r = r;
+	updatePreview();
+}
+DetailedShape3D::DetailedShape3D(const Plane3D plane) {
+	type = PLANE;
+	this->plane = plane;
+	r = 0;
+	updatePreview();
+}
+DetailedShape3D::DetailedShape3D(const Box3D box) {
+	type = BOX;
+	this->box = box;
+	r = 0;
+	updatePreview();
+}
+void DetailedShape3D::setMaterial(const Material material) {
+	this->material = material;
+	updatePreview();
+}
+const Material & DetailedShape3D::getMaterial() const		{return material;}
+DetailedShape3D::Type DetailedShape3D::getType() const		{return type;}
+bool DetailedShape3D::isBounded() const						{return type != PLANE;}
+Box3D DetailedShape3D::getBox() const {
+	if(type == SPHERE) return Box3D(center - Vect3D(r,r,r), center + Vect3D(r,r,r));
+	return box;
+}
+float DetailedShape3D::cross(const Line3D line, const float tmin, const float tmax, const bool skipMin, const bool skipMax) const {
+	const float nan = std::numeric_limits<float>::quiet_NaN();
+	const Vect3D p = line.getP();
+	const Vect3D v = line.getV();
+	float t1, t2;	//line enters and leaves shape
+	if(type == PLANE) {
+		const Vect3D n = plane.getN();
+		const float vn = v*n;
+		if(! vn || skipMin || skipMax) return nan;	//parallel or plane is the skipped surface
+		const float t = ((plane.getP()-p) * n) / vn;
+		return t >= tmin && t <= tmax ? t : nan;
+	} else if(type == SPHERE) {
+		//|p + v*t - center| = r => a*t^2 + 2*b*t + c = 0
+		const Vect3D d = p - center;
+		const float a = v*v;
+		const float b = d*v;
+		const float c = d*d - r*r;
+		const float disc = b*b - a*c;
+		if(disc < 0 || ! a) return nan;
+		const float sq = std::sqrt(disc);
+		t1 = (-b - sq) / a;
+		t2 = (-b + sq) / a;
+	} else {
+		//slabs: range of t between the 2 planes of each axis, cross is where all 3 ranges overlap
+		const float inf = std::numeric_limits<float>::infinity();
+		const float ps[3] = {p.getX(), p.getY(), p.getZ()};
+		const float vs[3] = {v.getX(), v.getY(), v.getZ()};
+		const Vect3D min = box.getMin(), max = box.getMax();
+		const float mins[3] = {min.getX(), min.getY(), min.getZ()};
+		const float maxs[3] = {max.getX(), max.getY(), max.getZ()};
+		t1 = -inf;
+		t2 = inf;
+		for(unsigned int k=0; k<3; k++) {
+			if(! vs[k]) {
+				if(ps[k] < mins[k] || ps[k] > maxs[k]) return nan;	//parallel with slab and out of it
+				continue;
+			}
+			float near = (mins[k]-ps[k]) / vs[k];
+			float far = (maxs[k]-ps[k]) / vs[k];
+			if(near > far) std::swap(near, far);
+			t1 = std::max(t1, near);
+			t2 = std::min(t2, far);
+		}
+		if(t1 > t2) return nan;
+	}
+
+	//a skipped surface is the cross closest to the end of range where line touches it
+	bool use1 = true, use2 = true;
+	if(skipMin) {
+		if(std::fabs(t1-tmin) < std::fabs(t2-tmin)) use1 = false;
+		else use2 = false;
+	}
+	if(skipMax) {
+		if(std::fabs(t1-tmax) < std::fabs(t2-tmax)) use1 = false;
+		else use2 = false;
+	}
+	if(use1 && t1 >= tmin && t1 <= tmax) return t1;
+	if(use2 && t2 >= tmin && t2 <= tmax) return t2;
+	return nan;
+}
+Vect3D DetailedShape3D::getNormal(const Vect3D p) const {
+	if(type == SPHERE) return p - center;
+	if(type == PLANE) return plane.getN();
+
+	//box: normal of the face that p is closest to
+	const Vect3D min = box.getMin(), max = box.getMax();
+	const float dists[6] = {p.getX()-min.getX(), max.getX()-p.getX(), p.getY()-min.getY(), max.getY()-p.getY(), p.getZ()-min.getZ(), max.getZ()-p.getZ()};
+	const Vect3D normals[6] = {Vect3D(-1,0,0), Vect3D(1,0,0), Vect3D(0,-1,0), Vect3D(0,1,0), Vect3D(0,0,-1), Vect3D(0,0,1)};
+	unsigned int closest = 0;
+	for(unsigned int i=1; i<6; i++)
+		if(std::fabs(dists[i]) < std::fabs(dists[closest])) closest = i;
+	return normals[closest];
+}
+void DetailedShape3D::tessellate(DetailedMesh3D & mesh, const unsigned int segments, const float size) const {
+	const unsigned int material = mesh.addMaterial(this->material);
+	if(type == SPHERE) {
+		//rings from pole to pole, each vertex is connected to the next ring
+		const float pi = 3.14159265f;
+		const unsigned int rings = std::max(segments/2, 2u);
+		const unsigned int first = mesh.getVertexCount();
+		for(unsigned int i=0; i<=rings; i++) {
+			const float theta = pi * i / rings;
+			for(unsigned int j=0; j<segments; j++) {
+				const float phi = 2*pi * j / segments;
+				mesh.addVertex(center + Vect3D(std::sin(theta)*std::cos(phi), std::sin(theta)*std::sin(phi), std::cos(theta)) * r);
+			}
+		}
+		for(unsigned int i=0; i<rings; i++)
+			for(unsigned int j=0; j<segments; j++) {
+				const unsigned int a = first + i*segments + j;
+				const unsigned int b = first + i*segments + (j+1)%segments;
+				const unsigned int c = a + segments;
+				const unsigned int d = b + segments;
+				if(i > 0) mesh.addTri(a,c,b, material);	//no degenerate triangles at poles
+				if(i < rings-1) mesh.addTri(b,c,d, material);
+			}
+	} else if(type == PLANE) {
+		//square around point of plane: 2 directions of plane from normal vector
+		const Vect3D n = plane.getN();
+		const Vect3D helper = std::fabs(n.getX()) < std::fabs(n.getY()) ? Vect3D(1,0,0) : Vect3D(0,1,0);
+		Vect3D x = Vect3D(helper, n);
+		Vect3D y = Vect3D(n, x);
+		x = x * (size/2 / std::sqrt(x*x));
+		y = y * (size/2 / std::sqrt(y*y));
+		const Vect3D o = plane.getP();
+		const unsigned int a = mesh.addVertex(o-x-y);
+		const unsigned int b = mesh.addVertex(o+x-y);
+		const unsigned int c = mesh.addVertex(o+x+y);
+		const unsigned int d = mesh.addVertex(o-x+y);
+		mesh.addTri(a,b,c, material);
+		mesh.addTri(a,c,d, material);
+	} else {
+		//8 corners: bit 0,1,2 of index selects max on x,y,z
+		const Vect3D min = box.getMin(), max = box.getMax();
+		unsigned int corners[8];
+		for(unsigned int i=0; i<8; i++) corners[i] = mesh.addVertex(Vect3D(i&1 ? max.getX() : min.getX(), i&2 ? max.getY() : min.getY(), i&4 ? max.getZ() : min.getZ()));
+		//faces ACW from outside
+		const unsigned int faces[6][4] = {{0,4,6,2}, {1,3,7,5}, {0,1,5,4}, {2,6,7,3}, {0,2,3,1}, {4,5,7,6}};
+		for(unsigned int f=0; f<6; f++) {
+			mesh.addTri(corners[faces[f][0]], corners[faces[f][1]], corners[faces[f][2]], material);
+			mesh.addTri(corners[faces[f][0]], corners[faces[f][2]], corners[faces[f][3]], material);
+		}
+	}
+}
+const DetailedMesh3D & DetailedShape3D::getPreview() const	{return preview;}
+//privates:
+void DetailedShape3D::updatePreview() {
+	preview = DetailedMesh3D();
+	tessellate(preview);
+}
+//--------------------------------------DetailedInstance3D----------------------------------------------------------------
+DetailedInstance3D::DetailedInstance3D(const DetailedMesh3D * mesh, const Transform3D toWorld) {
+	this->mesh = mesh;
+	this->shape = 0;
+	this->toWorld = toWorld;
+}
+DetailedInstance3D::DetailedInstance3D(const DetailedShape3D * shape, const Transform3D toWorld) {
+	this->mesh = 0;
+	this->shape = shape;
+	this->toWorld = toWorld;
+}
+void DetailedInstance3D::setTransform(const Transform3D toWorld)	{this->toWorld = toWorld;}
+const DetailedMesh3D * DetailedInstance3D::getMesh() const			{return mesh;}
+const DetailedShape3D * DetailedInstance3D::getShape() const		{return shape;}
+bool DetailedInstance3D::isBounded() const							{return ! shape || shape->isBounded();}
+Transform3D DetailedInstance3D::getToWorld() const					{return toWorld;}
+Transform3D DetailedInstance3D::getToObject() const					{return toWorld.inverse();}
+Box3D DetailedInstance3D::getBox() const							{return toWorld.box(shape ? shape->getBox() : mesh->getBox());}
+//--------------------------------------SpaceCross----------------------------------------------------------------
+SpaceCross::SpaceCross() {
+	inst = 0;
+	tri = 0;
+	t = std::numeric_limits<float>::infinity();
+}
+SpaceCross::SpaceCross(const DetailedInstance3D * inst, const unsigned int tri, const float t) {
+	this->inst = inst;
+	this->tri = tri;
+	this->t = t;
+}
+SpaceCross::SpaceCross(const DetailedInstance3D * inst, const float t, const Vect3D normal) {
+	this->inst = inst;
+	this->tri = 0;
+	this->t = t;
+	this->normal = normal;
+}
+bool SpaceCross::operator==(const SpaceCross o) const		{return inst == o.inst && tri == o.tri;}
+const DetailedInstance3D * SpaceCross::getInst() const		{return inst;}
+bool SpaceCross::isHit() const								{return inst != 0;}
+unsigned int SpaceCross::getTri() const						{return tri;}
+const Material & SpaceCross::getMaterial() const {
+	const DetailedShape3D * shape = inst->getShape();
+	return shape ? shape->getMaterial() : inst->getMesh()->getMaterial(tri);
+}
+float SpaceCross::getT() const								{return t;}
+Vect3D SpaceCross::getNormal() const {
+	const Vect3D n = inst->getShape() ? normal : inst->getMesh()->getNormal(tri);
+	return inst->getToWorld().normal(n);
+}
+//--------------------------------------DetailedSpace3D----------------------------------------------------------------
+DetailedSpace3D::DetailedSpace3D() {
+	loose = 0;
+	bounded = 0;
+	rebuildThreshold = 1.5;
+	method = BoundingHierarchy::BINNED_SAH;
+	topMethod = method;
+	lazy = false;
+	compression = 0;
+	buildTime = 0;
+}
+DetailedSpace3D::~DetailedSpace3D() {
+	rebuildTasks.wait();
+	for(std::list<MeshRebuild*>::iterator i = rebuilds.begin(); i != rebuilds.end(); i++) delete *i;
+}
+void DetailedSpace3D::push_back(const DetailedTri3D tri) {
+	if(! loose) {
+		loose = addMesh(DetailedMesh3D());
+		addInstance(loose, Transform3D());
+	}
+	loose->push_back(tri);
+}
+DetailedMesh3D * DetailedSpace3D::addMesh(const DetailedMesh3D mesh) {
+	meshes.push_back(mesh);
+	return &meshes.back();
+}
+DetailedInstance3D * DetailedSpace3D::addInstance(const DetailedMesh3D * mesh, const Transform3D toWorld) {
+	instances.push_back(DetailedInstance3D(mesh, toWorld));
+	return &instances.back();
+}
+DetailedInstance3D * DetailedSpace3D::addShape(const DetailedShape3D shape, const Transform3D toWorld) {
+	shapes.push_back(shape);
+	instances.push_back(DetailedInstance3D(&shapes.back(), toWorld));
+	return &instances.back();
+}
+const std::list<DetailedInstance3D> & DetailedSpace3D::getInstances() const		{return instances;}
+void DetailedSpace3D::build() {
+	QElapsedTimer timer;
+	timer.start();
+	takeRebuilt();
+
+	//bottom level: only meshes that changed are built or refitted
+	for(std::list<DetailedMesh3D>::iterator i = meshes.begin(); i != meshes.end(); i++) {
+		i->build(method, lazy);
+		if(compression && i->getHierarchy().getCompression() != compression) i->compress(compression);
+		if(i->getDegradation() > rebuildThreshold && ! isRebuilding(&*i)) {
+			LOG_VERBOSE("background rebuild of a mesh with " << i->size() << " triangles, degradation: " << i->getDegradation());
+			rebuilds.push_back(new MeshRebuild(&*i));
+			rebuildTasks.start(rebuilds.back(), REBUILDPRIORITY);
+		}
+	}
+
+	//top level: boxes of instances are always recalculated as instances may have moved
+	std::vector<Box3D> boxes;
+	for(std::list<DetailedInstance3D>::const_iterator i = instances.begin(); i != instances.end(); i++)
+		if(i->isBounded()) boxes.push_back(i->getBox());
+	const bool added = instances.size() != indexed.size();
+	if(! added) hierarchy.refit(boxes);
+	if(added || topMethod != method || hierarchy.getCost() > hierarchy.getBuildCost()*rebuildThreshold) {
+		//there are much less instances than triangles => no need for background
+		indexed.clear();
+		for(std::list<DetailedInstance3D>::const_iterator i = instances.begin(); i != instances.end(); i++)
+			if(i->isBounded()) indexed.push_back(&*i);
+		bounded = indexed.size();
+		for(std::list<DetailedInstance3D>::const_iterator i = instances.begin(); i != instances.end(); i++)
+			if(! i->isBounded()) indexed.push_back(&*i);
+		hierarchy.build(boxes, method);
+		topMethod = method;
+	}
+	buildTime = timer.nsecsElapsed() / 1000000.0;
+}
+void DetailedSpace3D::finalize() {
+	build();
+	rebuildTasks.wait();	//results of background rebuilds refer to the old order of triangles
+	takeRebuilt();
+	for(std::list<DetailedMesh3D>::iterator i = meshes.begin(); i != meshes.end(); i++) {
+		i->build(method, lazy);
+		i->reorder();
+	}
+}
+void DetailedSpace3D::setRebuildThreshold(const float threshold)	{rebuildThreshold = threshold;}
+void DetailedSpace3D::setBuildMethod(const BoundingHierarchy::BuildMethod method)	{this->method = method;}
+void DetailedSpace3D::setLazyBuild(const bool lazy)					{this->lazy = lazy;}
+void DetailedSpace3D::setCompression(const unsigned int bits) {
+	if(bits == compression) return;
+	compression = bits;
+	//quantized boxes can not be restored or quantized again => compressed meshes are built from their triangles
+	for(std::list<DetailedMesh3D>::iterator i = meshes.begin(); i != meshes.end(); i++)
+		if(i->getHierarchy().isCompressed()) i->invalidate();
+}
+std::size_t DetailedSpace3D::getMemory() const {
+	std::size_t result = hierarchy.getMemory() + shapes.size()*sizeof(DetailedShape3D);
+	for(std::list<DetailedMesh3D>::const_iterator i = meshes.begin(); i != meshes.end(); i++) result += i->getMemory();
+	for(std::list<DetailedShape3D>::const_iterator i = shapes.begin(); i != shapes.end(); i++) result += i->getPreview().getMemory();
+	return result;
+}
+unsigned int DetailedSpace3D::getTriCount() const {
+	unsigned int result = 0;
+	for(std::list<DetailedMesh3D>::const_iterator i = meshes.begin(); i != meshes.end(); i++) result += i->size();
+	return result;
+}
+unsigned int DetailedSpace3D::getShapeCount() const					{return shapes.size();}
+float DetailedSpace3D::getBuildTime() const							{return buildTime;}
+float DetailedSpace3D::getCost() const {
+	float result = indexed.size() - bounded;	//infinite shapes are checked by each line
+	if(hierarchy.isEmpty()) return result;
+	const float rootArea = hierarchy.getBox().area();
+	result += hierarchy.getCost();
+	for(unsigned int i=0; i<bounded; i++) {
+		if(indexed[i]->getShape()) continue;	//checking a shape is part of the cost of its leaf
+		const float p = rootArea > 0 ? indexed[i]->getBox().area() / rootArea : 1;	//probability of crossing the instance
+		result += p * indexed[i]->getMesh()->getHierarchy().getCost();
+	}
+	return result;
+}
+SpaceCross DetailedSpace3D::cross(const Line3D line, const float tmin, const float tmax, const SpaceCross skip) const {
+	ClosestInstVisitor visitor(indexed, line, tmin, skip);
+	float t = tmax;
+	for(unsigned int i=bounded; i<indexed.size(); i++) visitor.visit(i, t);	//infinite ones first: a close floor skips most of the hierarchy
+	hierarchy.traverse(line, tmin, t, visitor);
+	return visitor.closest;
+}
+bool DetailedSpace3D::isCrossed(const Line3D line, const float tmin, const float tmax, const SpaceCross skip1, const SpaceCross skip2) const {
+	AnyInstVisitor visitor(indexed, line, tmin, skip1, skip2);
+	float t = tmax;
+	for(unsigned int i=bounded; i<indexed.size(); i++)
+		if(visitor.visit(i, t)) return true;
+	return hierarchy.traverse(line, tmin, tmax, visitor);
+}
+void DetailedSpace3D::isCrossed(const std::vector<Line3D> & lines, const float tmin, const float tmax, const std::vector<SpaceCross> & skips1, const std::vector<SpaceCross> & skips2, std::vector<bool> & crossed) const {
+	crossed.assign(lines.size(), false);
+	AnyInstGroupVisitor visitor(indexed, lines, tmin, tmax, skips1, skips2);
+	for(unsigned int i=bounded; i<indexed.size(); i++) visitor.visit(i, crossed);
+	hierarchy.traverse(lines, tmin, tmax, crossed, visitor);
+}
+void DetailedSpace3D::traverse(const Frustum3D & frustum, SpaceRegionVisitor & visitor) const {
+	for(unsigned int i=bounded; i<indexed.size(); i++) visitor.visitShape(*indexed[i], false);
+	InstRegionVisitor instVisitor(indexed, frustum, visitor);
+	hierarchy.traverse(instVisitor);
+}
+//privates:
+void DetailedSpace3D::takeRebuilt() {
+	std::list<MeshRebuild*>::iterator i = rebuilds.begin();
+	while(i != rebuilds.end()) {
+		MeshRebuild * rebuild = *i;
+		if(! rebuild->isFinished()) {i++; continue;}
+
+		//mesh is one of meshes of space: only the space itself can change it
+		DetailedMesh3D * mesh = const_cast<DetailedMesh3D*>(rebuild->mesh);
+		if(mesh->size() == rebuild->boxes.size()) mesh->setHierarchy(rebuild->hierarchy);	//if triangles were added, a full build happens anyway
+		delete rebuild;
+		i = rebuilds.erase(i);
+	}
+}
+bool DetailedSpace3D::isRebuilding(const DetailedMesh3D * mesh) const {
+	for(std::list<MeshRebuild*>::const_iterator i = rebuilds.begin(); i != rebuilds.end(); i++)
+		if((*i)->mesh == mesh) return true;
+	return false;
+}
 //--------------------------------------DetailedTri2D----------------------------------------------------------------
-DetailedTri2D::DetailedTri2D() {}
-DetailedTri2D::DetailedTri2D(const Vect2D a, const Vect2D b, const Vect2D c)	{set(a,b,c);}
+DetailedTri2D::DetailedTri2D()												{setDepth(1,1,1);}
+DetailedTri2D::DetailedTri2D(const Vect2D a, const Vect2D b, const Vect2D c)	{set(a,b,c); setDepth(1,1,1);}
 void DetailedTri2D::set(const Vect2D a, const Vect2D b, const Vect2D c)		{this->a = a; this->b = b; this->c = c;}
 void DetailedTri2D::setColor(const Color color)								{this->color = color;}
+void DetailedTri2D::setDepth(const float a, const float b, const float c)	{depth[0] = a; depth[1] = b; depth[2] = c;}
 Vect2D DetailedTri2D::getA() const		{return a;}
 Vect2D DetailedTri2D::getB() const		{return b;}
 Vect2D DetailedTri2D::getC() const		{return c;}
-Color DetailedTri2D::getColor() const	{return color;}
\ No newline at end of file
+Color DetailedTri2D::getColor() const	{return color;}
+float DetailedTri2D::getDepth(const unsigned int i) const	{return depth[i];}
\ No newline at end of file
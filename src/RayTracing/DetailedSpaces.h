@@ -9,7 +9,11 @@
 #define DETAILEDSPACES_H
 
 #include "Space3D.h"
+#include "BoundingHierarchy.h"
+#include "TaskGroup.h"
+
 #include <list>
+#include <vector>
 
 /**
  * @brief 3D triangle that has efficent functions for designating intersection of lines.
@@ -55,6 +59,19 @@ public:
 	 * @brief Returns if section is crossing triangle.
 	 */
 	bool isCrossed(const Sect3D sect) const;
+	
+	/**
+	 * @brief Distance between p of line and cross point of line and triangle where unit is length of v.
+	 * 
+	 * Function returns t parameter in p+v*t where line crosses triangle.
+	 * @warning If line doesn't cross triangle then function returns nan.
+	 */
+	float distsign(const Line3D line) const;
+	
+	/**
+	 * @brief Smallest axis aligned box that contains triangle.
+	 */
+	Box3D getBox() const;
 
 	/**
 	 * @brief First vertex of triangle.
@@ -156,6 +173,45 @@ private:
 	float r,g,b;
 };
 
+/** @brief Optical details of a surface: color, reflection, transparency and refraction.*/
+class Material {
+public:
+	/** @brief Black material that doesn't reflect and is not transparent.*/
+	Material();
+	
+	/** @brief Setter for active color*/
+	void setActive(const Color active);
+	
+	/** @brief Setter for reflection*/
+	void setRefl(const Color refl);
+	
+	/** @brief Setter for transparency*/
+	void setTransp(const Color transp);
+	
+	/** @brief Setter for refraction index, 1 (default) keeps direction of rays passing through surface*/
+	void setRefr(const float refr);
+	
+	/** @brief active color*/
+	Color getActive() const;
+	
+	/** @brief reflection*/
+	Color getRefl() const;
+	
+	/** @brief transparency*/
+	Color getTransp() const;
+	
+	/** @brief refraction index*/
+	float getRefr() const;
+	
+	/** @brief True if all details are the same.*/
+	bool operator==(const Material o) const;
+private:
+	Color active;
+	Color refl;
+	Color transp;
+	float refr;
+};
+
 /** @brief color and position
  *
  * DetailedTri3D contains fotons - these objects define how light each part of the triangle is.
@@ -210,6 +266,9 @@ public:
 	/** @brief refraction.	TODO document it*/
 	float getRefr() const;
 	
+	/** @brief optical details of triangle*/
+	Material getMaterial() const;
+	
 	/** @brief adds a foton to list of fotons*/
 	void addFoton(const Foton foton) const;
 	
@@ -230,9 +289,495 @@ private:
 };
 
 /**
- * @brief List that has DetailedTri3D elements.
+ * @brief Group of triangles that can be placed into space several times.
+ * 
+ * Triangles are stored in coordinate system of mesh (object space). Mesh has its own BoundingHierarchy that is shared by all of its instances => memory used by a scene is proportional to its unique geometry.
+ * Mesh is indexed: vertices are stored once and shared by triangles, a triangle is 3 indices of vertices and the index of its material.
+ * Nothing else is stored for a triangle: data for crossing is calculated from the vertices when the triangle is checked.
+ */
+class DetailedMesh3D {
+public:
+	/** @brief Constructs an empty mesh.*/
+	DetailedMesh3D();
+	
+	/** @brief Allocates memory for given number of vertices, triangles and materials (e.g. before loading a file).*/
+	void reserve(const unsigned int vertices, const unsigned int tris, const unsigned int materials = 1);
+	
+	/** @brief Adds a vertex, returns its index.*/
+	unsigned int addVertex(const Vect3D v);
+	
+	/** @brief Adds a material, returns its index.*/
+	unsigned int addMaterial(const Material material);
+	
+	/**
+	 * @brief Adds a triangle with given vertices and material.
+	 * 
+	 * @param a,b,c indices of vertices - positive side of triangle is where they are visible ACW
+	 * @param material index of material
+	 */
+	void addTri(const unsigned int a, const unsigned int b, const unsigned int c, const unsigned int material);
+	
+	/** @brief Adds triangle with its own 3 vertices. Material is shared with the previous triangle if it is the same.*/
+	void push_back(const DetailedTri3D tri);
+	
+	/** @brief Number of triangles.*/
+	unsigned int size() const;
+	
+	/** @brief Number of vertices.*/
+	unsigned int getVertexCount() const;
+	
+	/** @brief ith vertex*/
+	Vect3D getVertex(const unsigned int i) const;
+	
+	/** @brief kth vertex (0..2) of ith triangle*/
+	Vect3D getVertex(const unsigned int i, const unsigned int k) const;
+	
+	/** @brief Material of ith triangle*/
+	const Material & getMaterial(const unsigned int i) const;
+	
+	/** @brief Normal vector of ith triangle (not unit length), points to the side where vertices are ACW.*/
+	Vect3D getNormal(const unsigned int i) const;
+	
+	/**
+	 * @brief Parameter of line at its cross with ith triangle.
+	 * 
+	 * Function returns t parameter in p+v*t where line crosses triangle.
+	 * @warning If line doesn't cross triangle then function returns nan.
+	 */
+	float distsign(const unsigned int i, const Line3D line) const;
+	
+	/**
+	 * @brief Moves ith vertex, triangles sharing it move with it.
+	 * 
+	 * Hierarchy is not rebuilt, only refitted at next build().
+	 */
+	void moveVertex(const unsigned int i, const Vect3D pos);
+	
+	/**
+	 * @brief Builds hierarchy if triangles were added since last build, refits it if vertices were moved.
+	 * 
+	 * @param method algorithm of building - hierarchy is rebuilt if it was built with another one
+	 * @param lazy build only the top levels, see BoundingHierarchy::build() - hierarchy is rebuilt if lazy is switched on
+	 */
+	void build(const BoundingHierarchy::BuildMethod method = BoundingHierarchy::BINNED_SAH, const bool lazy = false);
+	
+	/**
+	 * @brief Orders triangles like the leaves of hierarchy, so triangles that are close in space are close in memory.
+	 * 
+	 * Builds hierarchy if needed. Leaves of hierarchy then refer to contiguous ranges of triangles. Material indices are moved with their triangles.
+	 * Vertices are renumbered in the order the triangles first use them, so close triangles read their vertices from close addresses too.
+	 * @warning Indices of triangles and vertices change.
+	 */
+	void reorder();
+	
+	/** @brief Stores hierarchy in compact format, see BoundingHierarchy::compress().*/
+	bool compress(const unsigned int bits);
+	
+	/** @brief Makes next build() build hierarchy again even if triangles did not change, e.g. to get back full precision nodes of a compressed hierarchy.*/
+	void invalidate();
+	
+	/** @brief Algorithm that hierarchy was built with.*/
+	BoundingHierarchy::BuildMethod getBuildMethod() const;
+	
+	/** @brief Hierarchy over triangles - indices of primitives are indices of triangles.*/
+	const BoundingHierarchy & getHierarchy() const;
+	
+	/**
+	 * @brief Replaces hierarchy with one that was built over the triangles of mesh (e.g. in background).
+	 * 
+	 * Vertices may have moved since hierarchy was built => it is refitted at next build().
+	 */
+	void setHierarchy(const BoundingHierarchy & hierarchy);
+	
+	/** @brief Boxes of triangles: ith element is box of ith triangle.*/
+	std::vector<Box3D> getBoxes() const;
+	
+	/** @brief How much slower hierarchy became since its build because of moved vertices: 1 right after build.*/
+	float getDegradation() const;
+	
+	/** @brief Box containing all triangles of mesh (in coordinate system of mesh).*/
+	Box3D getBox() const;
+	
+	/** @brief Bytes used by geometry and hierarchy.*/
+	std::size_t getMemory() const;
+private:
+	std::vector<Vect3D> vertices;
+	std::vector<unsigned int> tris;	//3 indices of vertices for each triangle
+	std::vector<unsigned int> materialIds;	//index of material for each triangle
+	std::vector<Material> materials;
+	BoundingHierarchy hierarchy;
+	BoundingHierarchy::BuildMethod method;
+	bool lazy;
+	bool built;	//false if triangles were added since last build
+	bool moved;	//true if vertices were moved since last build or refit
+};
+
+/**
+ * @brief Analytic primitive: sphere, infinite plane or axis aligned box.
+ * 
+ * Crosses and normals are calculated exactly from a few parameters, so a smooth object needs no triangles.
+ * Shapes are placed into space by instances like meshes: the transformation of the instance can move, rotate or scale them (a scaled sphere is an ellipsoid).
  */
-typedef std::list<DetailedTri3D> DetailedSpace3D;
+class DetailedShape3D {
+public:
+	/** @brief Kinds of shapes.*/
+	enum Type {
+		SPHERE,	/**< points closer to center than r*/
+		PLANE,	/**< infinite plane - has no bounding box*/
+		BOX		/**< axis aligned box*/
+	};
+	
+	/** @brief Constructs a sphere.*/
+	DetailedShape3D(const Vect3D center, const float r);
+	
+	/** @brief Constructs an infinite plane.*/
+	DetailedShape3D(const Plane3D plane);
+	
+	/** @brief Constructs an axis aligned box.*/
+	DetailedShape3D(const Box3D box);
+	
+	/** @brief Setter for material of surface.*/
+	void setMaterial(const Material material);
+	
+	/** @brief Material of surface.*/
+	const Material & getMaterial() const;
+	
+	/** @brief Kind of shape.*/
+	Type getType() const;
+	
+	/** @brief False if shape is infinite (plane).*/
+	bool isBounded() const;
+	
+	/** @brief Smallest axis aligned box containing shape - only for bounded shapes.*/
+	Box3D getBox() const;
+	
+	/**
+	 * @brief Closest cross of [tmin,tmax] range of line and surface of shape.
+	 * 
+	 * A line crosses a sphere or a box twice. A line that starts or ends on the surface would find that point again, so it can be skipped:
+	 * @param skipMin ignore the cross that is closest to tmin (line starts on surface)
+	 * @param skipMax ignore the cross that is closest to tmax (line ends on surface)
+	 * @return t parameter of the cross in p+v*t, nan if there is none
+	 */
+	float cross(const Line3D line, const float tmin, const float tmax, const bool skipMin = false, const bool skipMax = false) const;
+	
+	/** @brief Outwards normal vector (not unit length) at point p of surface.*/
+	Vect3D getNormal(const Vect3D p) const;
+	
+	/**
+	 * @brief Adds triangles approximating the surface to mesh (e.g. for previews).
+	 * 
+	 * @param mesh triangles are added to it with material of shape
+	 * @param segments a sphere is divided into this many parts around and segments/2 from pole to pole
+	 * @param size side of the square that stands for a plane
+	 */
+	void tessellate(DetailedMesh3D & mesh, const unsigned int segments = 16, const float size = 1000) const;
+	
+	/** @brief Triangles of tessellate() with default parameters, made when shape or its material is set - previews don't tessellate shapes at each frame.*/
+	const DetailedMesh3D & getPreview() const;
+private:
+	Type type;
+	Vect3D center;	//sphere
+	float r;
+	Plane3D plane;
+	Box3D box;
+	Material material;
+	DetailedMesh3D preview;
+	void updatePreview();	//tessellates shape again
+};
+
+/**
+ * @brief A mesh or a shape placed into space with a transformation.
+ * 
+ * Instance does not copy triangles of mesh: it only refers to the mesh, so many copies of one object are cheap.
+ */
+class DetailedInstance3D {
+public:
+	/**
+	 * @brief Constructs an instance of mesh.
+	 * 
+	 * @param mesh the mesh - it has to exist while instance is used
+	 * @param toWorld transforms coordinate system of mesh into coordinate system of space
+	 */
+	DetailedInstance3D(const DetailedMesh3D * mesh, const Transform3D toWorld);
+	
+	/**
+	 * @brief Constructs an instance of shape.
+	 * 
+	 * @param shape the shape - it has to exist while instance is used
+	 * @param toWorld transforms coordinate system of shape into coordinate system of space
+	 */
+	DetailedInstance3D(const DetailedShape3D * shape, const Transform3D toWorld);
+	
+	/** @brief Setter for transformation from coordinate system of mesh into coordinate system of space.*/
+	void setTransform(const Transform3D toWorld);
+	
+	/** @brief The mesh, 0 for an instance of a shape.*/
+	const DetailedMesh3D * getMesh() const;
+	
+	/** @brief The shape, 0 for an instance of a mesh.*/
+	const DetailedShape3D * getShape() const;
+	
+	/** @brief False if instance is infinite: it has no box and is checked by every line.*/
+	bool isBounded() const;
+	
+	/** @brief Transformation from coordinate system of mesh into coordinate system of space.*/
+	Transform3D getToWorld() const;
+	
+	/** @brief Transformation from coordinate system of space into coordinate system of mesh.*/
+	Transform3D getToObject() const;
+	
+	/** @brief Box containing instance in coordinate system of space - only for bounded instances.*/
+	Box3D getBox() const;
+private:
+	const DetailedMesh3D * mesh;
+	const DetailedShape3D * shape;
+	Transform3D toWorld;	//stores its inverse as well
+};
+
+/**
+ * @brief Cross point of a line and a triangle or shape of space.
+ * 
+ * A triangle of a mesh can be in space several times (once for each instance) => a cross is identified by the instance and the triangle.
+ */
+class SpaceCross {
+public:
+	/** @brief Constructs a cross with no triangle (line doesn't cross anything).*/
+	SpaceCross();
+	
+	/**
+	 * @brief Constructs a cross of a triangle.
+	 * 
+	 * @param inst instance containing crossed triangle
+	 * @param tri index of crossed triangle in mesh of inst
+	 * @param t parameter of line (p+v*t) at the cross
+	 */
+	SpaceCross(const DetailedInstance3D * inst, const unsigned int tri, const float t);
+	
+	/**
+	 * @brief Constructs a cross of a shape.
+	 * 
+	 * @param inst instance of crossed shape
+	 * @param t parameter of line (p+v*t) at the cross
+	 * @param normal normal vector of shape at the cross (in coordinate system of shape)
+	 */
+	SpaceCross(const DetailedInstance3D * inst, const float t, const Vect3D normal);
+	
+	/** @brief True if this and o are crosses of the same triangle (or shape) of the same instance.*/
+	bool operator==(const SpaceCross o) const;
+	
+	/** @brief Instance containing crossed triangle or shape, 0 if nothing is crossed.*/
+	const DetailedInstance3D * getInst() const;
+	
+	/** @brief True if a triangle or shape is crossed.*/
+	bool isHit() const;
+	
+	/** @brief Index of crossed triangle in mesh of instance, 0 for a shape.*/
+	unsigned int getTri() const;
+	
+	/** @brief Material of crossed surface - there has to be one.*/
+	const Material & getMaterial() const;
+	
+	/** @brief Parameter of line at the cross.*/
+	float getT() const;
+	
+	/** @brief Normal vector of crossed surface in coordinate system of space.*/
+	Vect3D getNormal() const;
+private:
+	const DetailedInstance3D * inst;
+	unsigned int tri;
+	float t;
+	Vect3D normal;	//shapes: normal at the cross in coordinate system of shape
+};
+
+/** @brief Checks triangles and shapes that DetailedSpace3D finds in a region.*/
+class SpaceRegionVisitor {
+public:
+	virtual ~SpaceRegionVisitor() {}
+	
+	/**
+	 * @brief Checks a triangle of a mesh whose box is not outside the region.
+	 * 
+	 * @param inst instance that places the mesh
+	 * @param tri index of triangle in mesh of instance
+	 * @param inside true if triangle is known to be completely inside region
+	 */
+	virtual void visit(const DetailedInstance3D & inst, const unsigned int tri, const bool inside) = 0;
+	
+	/**
+	 * @brief Checks a shape whose box is not outside the region - infinite shapes are always checked.
+	 * 
+	 * @param inst instance that places the shape
+	 * @param inside true if shape is known to be completely inside region
+	 */
+	virtual void visitShape(const DetailedInstance3D & inst, const bool inside) = 0;
+};
+
+class MeshRebuild;
+
+/**
+ * @brief Scene: meshes and their instances with a two-level acceleration structure.
+ * 
+ * Each mesh has a BoundingHierarchy over its triangles (bottom level), space has a BoundingHierarchy over boxes of instances (top level). Lines are transformed into coordinate system of mesh when checking an instance.
+ * Triangles added one by one go into a mesh of space that is placed without transformation. Analytic shapes are placed by instances as well, infinite ones are kept out of the top level hierarchy.
+ * Moving vertices or instances doesn't rebuild hierarchies, they are only refitted. A hierarchy is rebuilt only if it became much slower to walk - meshes are rebuilt in background while the refitted hierarchy is still used.
+ */
+class DetailedSpace3D {
+public:
+	/** @brief Constructs an empty space.*/
+	DetailedSpace3D();
+	
+	/** @brief Waits for background rebuilds to finish.*/
+	~DetailedSpace3D();
+	
+	/** @brief Adds a triangle (in coordinate system of space).*/
+	void push_back(const DetailedTri3D tri);
+	
+	/**
+	 * @brief Stores a copy of mesh in space.
+	 * 
+	 * @return the stored mesh that can be used for addInstance()
+	 */
+	DetailedMesh3D * addMesh(const DetailedMesh3D mesh);
+	
+	/**
+	 * @brief Places a mesh into space.
+	 * 
+	 * @param mesh mesh stored by addMesh()
+	 * @param toWorld transformation from coordinate system of mesh into coordinate system of space
+	 * @return the stored instance
+	 */
+	DetailedInstance3D * addInstance(const DetailedMesh3D * mesh, const Transform3D toWorld);
+	
+	/**
+	 * @brief Stores a copy of shape in space and places it.
+	 * 
+	 * Shapes are in the same top level hierarchy as instances of meshes, infinite ones are checked by each line.
+	 * @param shape the shape with its material
+	 * @param toWorld transformation from coordinate system of shape into coordinate system of space
+	 * @return the stored instance
+	 */
+	DetailedInstance3D * addShape(const DetailedShape3D shape, const Transform3D toWorld = Transform3D());
+	
+	/** @brief Instances of space.*/
+	const std::list<DetailedInstance3D> & getInstances() const;
+	
+	/**
+	 * @brief Updates acceleration structures. Has to be called after space is changed, before shooting rays.
+	 * 
+	 * Only changed parts are updated: new meshes are built, moved triangles and instances are refitted.
+	 * If a refitted mesh became slower than rebuild threshold, a rebuild is started in background and its result is used from a later call.
+	 */
+	void build();
+	
+	/**
+	 * @brief Builds space and lays out the triangles of each mesh in the order of its hierarchy (see DetailedMesh3D::reorder()).
+	 * 
+	 * Should be called once the scene is loaded: walking the hierarchies touches less memory.
+	 * @warning Indices of triangles in meshes change.
+	 */
+	void finalize();
+	
+	/**
+	 * @brief Sets when a refitted hierarchy is rebuilt.
+	 * 
+	 * @param threshold hierarchy is rebuilt when its getDegradation() is more than threshold. Default is 1.5.
+	 */
+	void setRebuildThreshold(const float threshold);
+	
+	/** @brief Sets algorithm of building hierarchies, used from next build(). Default is BoundingHierarchy::BINNED_SAH.*/
+	void setBuildMethod(const BoundingHierarchy::BuildMethod method);
+	
+	/**
+	 * @brief Sets if meshes are built lazily, used from next build(). Default is false.
+	 * 
+	 * Lazy build splits only the top levels of meshes: rendering can start almost immediately and the rest is split by the rays of rendering threads. Good for previews of huge scenes.
+	 */
+	void setLazyBuild(const bool lazy);
+	
+	/**
+	 * @brief Sets node format of mesh hierarchies, used from next build().
+	 * 
+	 * @param bits 0: full precision nodes (default), 8 or 16: boxes are quantized to this many bits, see BoundingHierarchy::compress(). Lazy meshes are split completely.
+	 * If bits change, meshes that are compressed with the old bits are built again.
+	 */
+	void setCompression(const unsigned int bits);
+	
+	/** @brief Bytes used by meshes, shapes and hierarchies of space.*/
+	std::size_t getMemory() const;
+	
+	/** @brief Number of triangles in meshes - a mesh placed several times is counted once.*/
+	unsigned int getTriCount() const;
+	
+	/** @brief Number of shapes.*/
+	unsigned int getShapeCount() const;
+	
+	/** @brief Time of last build() in milliseconds.*/
+	float getBuildTime() const;
+	
+	/**
+	 * @brief Estimated cost of finding the closest cross of a random line (surface area heuristic of both levels).
+	 * 
+	 * Cost of top level plus the cost of each mesh weighted by the probability of crossing its instance.
+	 */
+	float getCost() const;
+	
+	/**
+	 * @brief Closest cross of [tmin,tmax] range of line and triangles and shapes of space.
+	 * 
+	 * @param skip triangle that is ignored (e.g. surface that the line starts from) - a shape is only ignored at its cross closest to tmin
+	 * @return cross with the smallest t, a cross with no triangle if nothing is crossed
+	 */
+	SpaceCross cross(const Line3D line, const float tmin, const float tmax, const SpaceCross skip = SpaceCross()) const;
+	
+	/**
+	 * @brief True if any triangle or shape of space crosses [tmin,tmax] range of line.
+	 * 
+	 * Stops at the first triangle found, doesn't look for the closest.
+	 * @param skip1 triangle that is ignored (e.g. surface that the line starts from) - a shape is only ignored at its cross closest to tmin
+	 * @param skip2 triangle that is ignored (e.g. surface that the line ends on) - a shape is only ignored at its cross closest to tmax
+	 */
+	bool isCrossed(const Line3D line, const float tmin, const float tmax, const SpaceCross skip1 = SpaceCross(), const SpaceCross skip2 = SpaceCross()) const;
+	
+	/**
+	 * @brief Checks a group of lines together: ith element of crossed is set true if any triangle crosses [tmin,tmax] range of ith line.
+	 * 
+	 * Acceleration structures are walked once for the whole group.
+	 * @param skips1 ith element is a triangle that ith line ignores
+	 * @param skips2 ith element is a triangle that ith line ignores
+	 */
+	void isCrossed(const std::vector<Line3D> & lines, const float tmin, const float tmax, const std::vector<SpaceCross> & skips1, const std::vector<SpaceCross> & skips2, std::vector<bool> & crossed) const;
+	
+	/**
+	 * @brief Finds triangles and shapes in a region (e.g. frustum culling of a camera).
+	 * 
+	 * Both levels of hierarchies are walked: instances and nodes outside the region are skipped, so the cost depends on the number of triangles that are found, not on the size of space.
+	 * A triangle may be found even if it is outside (its node is partly inside), but each triangle inside the region is found.
+	 */
+	void traverse(const Frustum3D & frustum, SpaceRegionVisitor & visitor) const;
+private:
+	std::list<DetailedMesh3D> meshes;
+	std::list<DetailedShape3D> shapes;
+	std::list<DetailedInstance3D> instances;
+	std::vector<const DetailedInstance3D*> indexed;	//instances by their index in hierarchy, infinite ones at the end
+	unsigned int bounded;	//number of instances in hierarchy
+	BoundingHierarchy hierarchy;	//top level: boxes of instances
+	DetailedMesh3D * loose;	//mesh of triangles added one by one
+	
+	float rebuildThreshold;
+	BoundingHierarchy::BuildMethod method;
+	BoundingHierarchy::BuildMethod topMethod;	//method of current top level
+	bool lazy;
+	unsigned int compression;
+	float buildTime;
+	TaskGroup rebuildTasks;	//background rebuilds of meshes on the shared pool
+	std::list<MeshRebuild*> rebuilds;	//started background rebuilds
+	void takeRebuilt();	//swaps in hierarchies that finished in background
+	bool isRebuilding(const DetailedMesh3D * mesh) const;
+	
+	DetailedSpace3D(const DetailedSpace3D &);	//instances point to meshes of space => copying would make them point to meshes of the original
+	void operator=(const DetailedSpace3D &);
+};
 
 /**
  * @brief 2D triangle with color
@@ -259,6 +804,11 @@ public:
 	 */
 	void setColor(const Color color);
 	
+	/**
+	 * @brief Sets depths of vertices: distance from camera along direction of camera (used by depth test of Rasterizer).
+	 */
+	void setDepth(const float a, const float b, const float c);
+	
 	/**
 	 * @brief First vertex of triangle.
 	 */
@@ -278,14 +828,20 @@ public:
 	 * @brief Color of triangle.
 	 */
 	Color getColor() const;
+	
+	/**
+	 * @brief Depth of first, second, third vertex (i: 0,1,2), 1 if not set.
+	 */
+	float getDepth(const unsigned int i) const;
 private:
 	Color color;
 	Vect2D a,b,c;
+	float depth[3];
 };
 
 /**
- * @brief List that has DetailedTri2D elements.
+ * @brief List that has DetailedTri2D elements - clearing it keeps its memory, so it can be filled again for each frame.
  */
-typedef std::list<DetailedTri2D> DetailedSpace2D;
+typedef std::vector<DetailedTri2D> DetailedSpace2D;
 
 #endif
\ No newline at end of file
@@ -0,0 +1,128 @@
+#include "ImageWriter.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+
+namespace {
+	//true if file starts with header
+	bool checkHeader(QFile & file, const char * header) {
+		const qint64 size = std::strlen(header);
+		char read[64];
+		return file.read(read, size) == size && ! std::memcmp(read, header, size);
+	}
+}
+//--------------------------------------ImageWriter----------------------------------------------------------------
+ImageWriter * ImageWriter::create(const QString & fileName) {
+	if(fileName.endsWith(".pfm", Qt::CaseInsensitive)) return new PfmWriter();
+	return new Ppm16Writer();
+}
+//--------------------------------------PfmWriter----------------------------------------------------------------
+PfmWriter::PfmWriter() {
+	width = 0;
+	height = 0;
+	row = 0;
+	headerSize = 0;
+}
+bool PfmWriter::open(const QString & fileName, const unsigned int width, const unsigned int height) {
+	this->width = width;
+	this->height = height;
+	row = 0;
+	file.setFileName(fileName);
+	if(! file.open(QIODevice::WriteOnly | QIODevice::Truncate)) return false;
+
+	char header[64];
+	formatHeader(header);
+	headerSize = file.write(header);
+	return headerSize > 0 && file.resize(headerSize + (qint64)(width*3*sizeof(float))*height);
+}
+bool PfmWriter::resume(const QString & fileName, const unsigned int width, const unsigned int height, const unsigned int rows) {
+	this->width = width;
+	this->height = height;
+	row = rows;
+	file.setFileName(fileName);
+	if(! file.open(QIODevice::ReadWrite)) return false;
+
+	char header[64];
+	formatHeader(header);
+	headerSize = std::strlen(header);
+	return checkHeader(file, header) && file.size() == headerSize + (qint64)(width*3*sizeof(float))*height;
+}
+bool PfmWriter::writeRows(const float * rgb, const unsigned int rows) {
+	const qint64 rowSize = (qint64)width*3*sizeof(float);
+	for(unsigned int r=0; r<rows; r++, row++) {
+		if(row >= height) return false;
+		if(! file.seek(headerSize + (height-1-row)*rowSize)) return false;	//bottom row is first in file
+		if(file.write((const char*)(rgb + (qint64)r*width*3), rowSize) != rowSize) return false;
+	}
+	return true;
+}
+bool PfmWriter::flush()	{return file.flush();}
+bool PfmWriter::close() {
+	file.close();
+	return row == height && file.error() == QFile::NoError;
+}
+//privates:
+void PfmWriter::formatHeader(char * header) const {
+	//negative scale: floats are little endian
+	const unsigned int one = 1;
+	const bool little = *(const unsigned char*)&one == 1;
+	std::sprintf(header, "PF\n%u %u\n%s\n", width, height, little ? "-1.0" : "1.0");
+}
+//--------------------------------------Ppm16Writer----------------------------------------------------------------
+Ppm16Writer::Ppm16Writer() {
+	width = 0;
+	height = 0;
+	row = 0;
+	headerSize = 0;
+}
+bool Ppm16Writer::open(const QString & fileName, const unsigned int width, const unsigned int height) {
+	this->width = width;
+	this->height = height;
+	row = 0;
+	line.resize(width*3*2);
+	file.setFileName(fileName);
+	if(! file.open(QIODevice::WriteOnly | QIODevice::Truncate)) return false;
+
+	char header[64];
+	formatHeader(header);
+	headerSize = file.write(header);
+	return headerSize > 0;
+}
+bool Ppm16Writer::resume(const QString & fileName, const unsigned int width, const unsigned int height, const unsigned int rows) {
+	this->width = width;
+	this->height = height;
+	row = rows;
+	line.resize(width*3*2);
+	file.setFileName(fileName);
+	if(! file.open(QIODevice::ReadWrite)) return false;
+
+	char header[64];
+	formatHeader(header);
+	headerSize = std::strlen(header);
+	const qint64 written = headerSize + (qint64)rows*line.size();
+	if(! checkHeader(file, header) || file.size() < written) return false;
+	return file.resize(written) && file.seek(written);	//rows after the first ones may be incomplete
+}
+bool Ppm16Writer::writeRows(const float * rgb, const unsigned int rows) {
+	for(unsigned int r=0; r<rows; r++, row++) {
+		if(row >= height) return false;
+		const float * src = rgb + (qint64)r*width*3;
+		for(unsigned int i=0; i<width*3; i++) {
+			const unsigned int v = (unsigned int)(std::min(std::max(src[i], 0.0f), 1.0f) * 65535 + 0.5f);
+			line[2*i] = v >> 8;	//big endian
+			line[2*i+1] = v & 0xff;
+		}
+		if(file.write((const char*)&line[0], line.size()) != (qint64)line.size()) return false;
+	}
+	return true;
+}
+bool Ppm16Writer::flush()	{return file.flush();}
+bool Ppm16Writer::close() {
+	file.close();
+	return row == height && file.error() == QFile::NoError;
+}
+//privates:
+void Ppm16Writer::formatHeader(char * header) const {
+	std::sprintf(header, "P6\n%u %u\n65535\n", width, height);
+}
@@ -0,0 +1,101 @@
+/**
+ * @file ImageWriter.h
+ * @brief writing images to disk row by row
+ *
+ * Images that are too big for memory are written while they are rendered: only the rows being rendered are kept.
+ */
+
+#ifndef IMAGEWRITER_H
+#define IMAGEWRITER_H
+
+#include <QFile>
+#include <QString>
+
+#include <vector>
+
+/**
+ * @brief Writes an image file in rows from top to bottom.
+ *
+ * Pixels are given as float RGB triplets (3 floats per pixel), like the colors of the ray tracer: 1 is white, larger values are overexposed.
+ */
+class ImageWriter {
+public:
+	virtual ~ImageWriter() {}
+
+	/**
+	 * @brief Creates file and writes its header.
+	 *
+	 * @return false if file can not be written
+	 */
+	virtual bool open(const QString & fileName, const unsigned int width, const unsigned int height) = 0;
+
+	/**
+	 * @brief Opens a file written partly by an earlier writer, next row written is the one after its first rows.
+	 *
+	 * @return false if file is not an image of this size and format
+	 */
+	virtual bool resume(const QString & fileName, const unsigned int width, const unsigned int height, const unsigned int rows) = 0;
+
+	/**
+	 * @brief Writes next rows of image.
+	 *
+	 * @param rgb rows*width pixels, 3 floats each, rows are from top to bottom
+	 * @param rows number of rows
+	 * @return false if writing failed
+	 */
+	virtual bool writeRows(const float * rgb, const unsigned int rows) = 0;
+
+	/** @brief Passes written rows to the operating system, so they are kept even if the program is killed.*/
+	virtual bool flush() = 0;
+
+	/** @brief Finishes file, false if it is not complete.*/
+	virtual bool close() = 0;
+
+	/** @brief Writer for the format of file name: .pfm is PfmWriter, anything else is Ppm16Writer. Caller deletes it.*/
+	static ImageWriter * create(const QString & fileName);
+};
+
+/**
+ * @brief Portable float map (.pfm): 32 bit float RGB, values over 1 are kept.
+ *
+ * PFM stores rows from bottom to top, so each row is written to its final place: file is allocated when opened.
+ */
+class PfmWriter : public ImageWriter {
+public:
+	/** @brief Constructs a writer with no file.*/
+	PfmWriter();
+
+	bool open(const QString & fileName, const unsigned int width, const unsigned int height);
+	bool resume(const QString & fileName, const unsigned int width, const unsigned int height, const unsigned int rows);
+	bool writeRows(const float * rgb, const unsigned int rows);
+	bool flush();
+	bool close();
+private:
+	QFile file;
+	unsigned int width, height;
+	unsigned int row;	//next row to write
+	qint64 headerSize;
+	void formatHeader(char * header) const;
+};
+
+/** @brief Binary portable pixmap (.ppm) with 16 bits per channel: colors are clamped to [0,1] and stored with 65536 levels.*/
+class Ppm16Writer : public ImageWriter {
+public:
+	/** @brief Constructs a writer with no file.*/
+	Ppm16Writer();
+
+	bool open(const QString & fileName, const unsigned int width, const unsigned int height);
+	bool resume(const QString & fileName, const unsigned int width, const unsigned int height, const unsigned int rows);
+	bool writeRows(const float * rgb, const unsigned int rows);
+	bool flush();
+	bool close();
+private:
+	QFile file;
+	unsigned int width, height;
+	unsigned int row;	//next row to write
+	std::vector<unsigned char> line;	//one row converted to big endian 16 bit values
+	qint64 headerSize;
+	void formatHeader(char * header) const;
+};
+
+#endif
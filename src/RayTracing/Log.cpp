@@ -0,0 +1,131 @@
+#include "Log.h"
+
+#include <QAtomicInt>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QThread>
+#include <QThreadStorage>
+
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <list>
+
+namespace {
+	const int RINGSIZE = 256;	//messages in the ring of a thread
+	const unsigned long INTERVAL = 20;	//ms between 2 prints of the writer thread
+	const char * const LEVELS[] = {"[verbose] ", "[info] ", "[warning] ", "[critical] "};
+
+	class LogEntry {
+	public:
+		Log::Level level;
+		char text[LogLine::SIZE];
+	};
+
+	//messages of one thread: written only by that thread, read only by a thread holding the lock of LogWriter
+	class LogRing {
+	public:
+		LogRing() : head(0), tail(0), closed(0) {}
+		LogEntry entries[RINGSIZE];
+		QAtomicInt head;	//next entry to write
+		QAtomicInt tail;	//next entry to print
+		QAtomicInt closed;	//thread finished: ring is deleted once it is printed
+	};
+
+	//deleted by QThreadStorage when its thread finishes
+	class LogRingRef {
+	public:
+		LogRingRef(LogRing * ring) : ring(ring) {}
+		~LogRingRef() {ring->closed.fetchAndStoreOrdered(1);}
+		LogRing * ring;
+	};
+
+	//prints the rings of all threads in background
+	class LogWriter : public QThread {
+	public:
+		LogWriter() : started(0), stop(0), dropped(0) {}
+		~LogWriter() {
+			if(! started.fetchAndAddOrdered(0)) return;
+			stop.fetchAndStoreOrdered(1);
+			wait();
+			print();
+		}
+		LogRing * add() {
+			if(started.testAndSetOrdered(0, 1)) start();
+			LogRing * ring = new LogRing();
+			QMutexLocker locker(&lock);	//once for each thread, not for each message
+			rings.push_back(ring);
+			return ring;
+		}
+		void print() {
+			QMutexLocker locker(&lock);
+			for(std::list<LogRing*>::iterator i = rings.begin(); i != rings.end(); ) {
+				LogRing & ring = **i;
+				const bool closed = ring.closed.fetchAndAddOrdered(0);	//read before head: no message can come after it
+				const int head = ring.head.fetchAndAddOrdered(0);
+				int tail = ring.tail.fetchAndAddOrdered(0);
+				for(; tail != head; tail = (tail+1) % RINGSIZE) std::cout << LEVELS[ring.entries[tail].level] << ring.entries[tail].text << '\n';
+				ring.tail.fetchAndStoreOrdered(tail);	//entries can be reused by the thread
+				if(closed) {
+					delete *i;
+					i = rings.erase(i);
+				} else i++;
+			}
+			std::cout.flush();
+		}
+		QAtomicInt started;
+		QAtomicInt stop;
+		QAtomicInt dropped;
+	protected:
+		void run() {
+			while(! stop.fetchAndAddOrdered(0)) {
+				print();
+				msleep(INTERVAL);
+			}
+		}
+	private:
+		QMutex lock;
+		std::list<LogRing*> rings;
+	};
+
+	LogWriter writer;
+	QThreadStorage<LogRingRef*> threadRing;
+}
+//--------------------------------------Log----------------------------------------------------------------
+void Log::write(const Level level, const char * text) {
+	if(! threadRing.hasLocalData()) threadRing.setLocalData(new LogRingRef(writer.add()));
+	LogRing & ring = *threadRing.localData()->ring;
+
+	const int head = ring.head.fetchAndAddOrdered(0);
+	const int next = (head+1) % RINGSIZE;
+	if(next == ring.tail.fetchAndAddOrdered(0)) {
+		writer.dropped.fetchAndAddOrdered(1);	//full: waiting for the console is what the ring is for
+		return;
+	}
+	LogEntry & entry = ring.entries[head];
+	entry.level = level;
+	std::strncpy(entry.text, text, LogLine::SIZE-1);
+	entry.text[LogLine::SIZE-1] = 0;
+	ring.head.fetchAndStoreOrdered(next);	//entry is complete before it becomes visible
+}
+void Log::flush()					{writer.print();}
+unsigned int Log::getDropped()		{return writer.dropped.fetchAndAddOrdered(0);}
+//--------------------------------------LogLine----------------------------------------------------------------
+LogLine::LogLine(const Log::Level level) : level(level) {
+	text[0] = 0;
+	length = 0;
+}
+LogLine::~LogLine()		{Log::write(level, text);}
+LogLine & LogLine::operator<<(const char * text)	{append(text); return *this;}
+LogLine & LogLine::operator<<(const int v)			{char s[32]; std::sprintf(s, "%d", v); append(s); return *this;}
+LogLine & LogLine::operator<<(const unsigned int v)	{char s[32]; std::sprintf(s, "%u", v); append(s); return *this;}
+LogLine & LogLine::operator<<(const long v)			{char s[32]; std::sprintf(s, "%ld", v); append(s); return *this;}
+LogLine & LogLine::operator<<(const unsigned long v)	{char s[32]; std::sprintf(s, "%lu", v); append(s); return *this;}
+LogLine & LogLine::operator<<(const long long v)		{char s[32]; std::sprintf(s, "%lld", v); append(s); return *this;}
+LogLine & LogLine::operator<<(const unsigned long long v)	{char s[32]; std::sprintf(s, "%llu", v); append(s); return *this;}
+LogLine & LogLine::operator<<(const double v)		{char s[32]; std::sprintf(s, "%g", v); append(s); return *this;}
+//privates:
+void LogLine::append(const char * s) {
+	while(*s && length < SIZE-1) text[length++] = *s++;
+	text[length] = 0;
+}
@@ -0,0 +1,96 @@
+/**
+ * @file Log.h
+ * @brief leveled logging that never blocks the logging thread
+ *
+ * Messages are written with the LOG_VERBOSE, LOG_INFO, LOG_WARNING and LOG_CRITICAL macros, e.g. LOG_INFO("rendering time: " << ms << " ms").
+ * Levels under LOG_MINLEVEL are removed by the preprocessor: their arguments are not even evaluated. Default is 1: verbose messages are removed.
+ * Build with DEFINES += LOG_MINLEVEL=0 to get every message, LOG_MINLEVEL=4 to remove all of them.
+ */
+
+#ifndef LOG_H
+#define LOG_H
+
+#ifndef LOG_MINLEVEL
+#define LOG_MINLEVEL 1
+#endif
+
+/**
+ * @brief Asynchronous log: each thread writes into its own ring buffer, a background thread prints them.
+ *
+ * Writing a message copies it into the ring of the calling thread without any lock, so rendering threads never wait for the console.
+ * If a ring is full (console is much slower than the thread), new messages of that thread are dropped and counted.
+ */
+class Log {
+public:
+	/** @brief Importance of a message.*/
+	enum Level {
+		VERBOSE,	/**< details for debugging, removed by default*/
+		INFO,		/**< timings and statistics*/
+		WARNING,	/**< something unexpected that can be handled*/
+		CRITICAL	/**< something failed*/
+	};
+
+	/** @brief Copies text (truncated to a line of LogLine) into the ring buffer of calling thread.*/
+	static void write(const Level level, const char * text);
+
+	/** @brief Prints all messages written so far, waits for the console. Not meant for rendering threads.*/
+	static void flush();
+
+	/** @brief Number of messages dropped because a ring buffer was full.*/
+	static unsigned int getDropped();
+};
+
+/** @brief Formats one message into a fixed buffer without allocating memory, writes it to Log when destroyed.*/
+class LogLine {
+public:
+	/** @brief Longest message in characters, longer ones are truncated.*/
+	static const unsigned int SIZE = 128;
+
+	/** @brief Starts an empty message of given level.*/
+	LogLine(const Log::Level level);
+
+	/** @brief Writes message to Log.*/
+	~LogLine();
+
+	LogLine & operator<<(const char * text);
+	LogLine & operator<<(const int v);
+	LogLine & operator<<(const unsigned int v);
+	LogLine & operator<<(const long v);
+	LogLine & operator<<(const unsigned long v);
+	LogLine & operator<<(const long long v);
+	LogLine & operator<<(const unsigned long long v);
+	LogLine & operator<<(const double v);
+private:
+	const Log::Level level;
+	char text[SIZE];
+	unsigned int length;
+	void append(const char * s);
+};
+
+#define LOG_WRITE(level, message) do { LogLine logLine(level); logLine << message; } while(0)
+
+#if LOG_MINLEVEL <= 0
+#define LOG_VERBOSE(message) LOG_WRITE(Log::VERBOSE, message)
+#else
+#define LOG_VERBOSE(message) do {} while(0)
+#endif
+
+#if LOG_MINLEVEL <= 1
+#define LOG_INFO(message) LOG_WRITE(Log::INFO, message)
+#else
+#define LOG_INFO(message) do {} while(0)
+#endif
+
+#if LOG_MINLEVEL <= 2
+#define LOG_WARNING(message) LOG_WRITE(Log::WARNING, message)
+#else
+#define LOG_WARNING(message) do {} while(0)
+#endif
+
+#if LOG_MINLEVEL <= 3
+#define LOG_CRITICAL(message) LOG_WRITE(Log::CRITICAL, message)
+#else
+#define LOG_CRITICAL(message) do {} while(0)
+#endif
+
+#endif
@@ -0,0 +1,172 @@
+#include "Rasterizer.h"
+#include "TaskGroup.h"
+
+#include <QRunnable>
+
+#include <algorithm>
+#include <cmath>
+
+namespace {
+	const int TILE = 64;	//size of tiles in pixels
+	const unsigned int MINCHUNK = 4096;	//triangles set up by one task at least
+}
+
+//one stage of drawing: sets up a chunk of triangles or draws tiles
+class RasterTask : public QRunnable {
+public:
+	RasterTask(Rasterizer & rasterizer, const unsigned int chunk, const unsigned int first, const unsigned int end)
+		: rasterizer(rasterizer), setup(true), chunk(chunk), first(first), end(end) {}
+	RasterTask(Rasterizer & rasterizer) : rasterizer(rasterizer), setup(false), chunk(0), first(0), end(0) {}
+	void run() {
+		if(setup) rasterizer.setup(chunk, first, end);
+		else rasterizer.drawTiles();
+	}
+private:
+	Rasterizer & rasterizer;
+	const bool setup;
+	const unsigned int chunk, first, end;
+};
+//--------------------------------------Rasterizer----------------------------------------------------------------
+Rasterizer::Rasterizer() {
+	space = 0;
+	chunks = 0;
+	pixels = 0;
+	width = 0;
+	height = 0;
+	pixelsPerLine = 0;
+	tilesX = 0;
+	tilesY = 0;
+}
+void Rasterizer::setBackground(const Color color)	{background = color;}
+void Rasterizer::draw(const DetailedSpace2D & space, unsigned int * pixels, const unsigned int width, const unsigned int height, const unsigned int bytesPerLine) {
+	if(! width || ! height) return;	//no tiles: bins would be empty
+	this->pixels = pixels;
+	this->width = width;
+	this->height = height;
+	pixelsPerLine = bytesPerLine / sizeof(unsigned int);
+	tilesX = (width + TILE-1) / TILE;
+	tilesY = (height + TILE-1) / TILE;
+	depth.resize(width*height);
+
+	this->space = &space;
+	tris.resize(space.size());
+
+	TaskGroup group;
+	const unsigned int threads = group.getThreads();
+	chunks = std::max(1u, std::min(threads, (unsigned int)space.size() / MINCHUNK));
+	bins.resize(chunks * tilesX*tilesY);
+	for(unsigned int i=0; i<bins.size(); i++) bins[i].clear();	//keeps memory of bins for next frame
+
+	const unsigned int chunkSize = (space.size() + chunks-1) / chunks;
+	for(unsigned int c=0; c<chunks; c++)
+		group.start(new RasterTask(*this, c, c*chunkSize, std::min((c+1)*chunkSize, (unsigned int)space.size())));
+	group.wait();
+
+	nextTile.fetchAndStoreOrdered(0);
+	for(unsigned int t=0; t<threads; t++) group.start(new RasterTask(*this));
+	group.wait();
+}
+unsigned int Rasterizer::toRGB(const Color color) {
+	const unsigned int r = (unsigned int)(std::min(std::max(color.getR(), 0.0f), 1.0f) * 255);
+	const unsigned int g = (unsigned int)(std::min(std::max(color.getG(), 0.0f), 1.0f) * 255);
+	const unsigned int b = (unsigned int)(std::min(std::max(color.getB(), 0.0f), 1.0f) * 255);
+	return 0xff000000u | (r << 16) | (g << 8) | b;
+}
+//privates:
+void Rasterizer::setup(const unsigned int chunk, const unsigned int first, const unsigned int end) {
+	const float cx = width / 2.0f;
+	const float cy = height / 2.0f;
+	std::vector<unsigned int> * chunkBins = &bins[chunk * tilesX*tilesY];
+	for(unsigned int i=first; i<end; i++) {
+		const DetailedTri2D & tri = (*space)[i];
+		const Vect2D v[3] = {tri.getA(), tri.getB(), tri.getC()};
+		float x[3], y[3];
+		for(unsigned int k=0; k<3; k++) {
+			x[k] = cx + v[k].getX();	//image coordinates: y points downwards
+			y[k] = cy - v[k].getY();
+		}
+
+		const float minx = std::min(std::min(x[0], x[1]), x[2]);
+		const float maxx = std::max(std::max(x[0], x[1]), x[2]);
+		const float miny = std::min(std::min(y[0], y[1]), y[2]);
+		const float maxy = std::max(std::max(y[0], y[1]), y[2]);
+		if(! (maxx >= 0 && maxy >= 0 && minx < width && miny < height)) continue;	//outside of image (or nan)
+
+		SetupTri & s = tris[i];
+		s.minx = (int)std::max(0.0f, std::floor(minx));	//clamped before conversion: far vertices can be out of range of int
+		s.miny = (int)std::max(0.0f, std::floor(miny));
+		s.maxx = (int)std::min(width-1.0f, std::ceil(maxx));
+		s.maxy = (int)std::min(height-1.0f, std::ceil(maxy));
+
+		//edge opposite to vertex k: positive on the side of vertex k
+		for(unsigned int k=0; k<3; k++) {
+			const unsigned int p = (k+1)%3, q = (k+2)%3;
+			s.edge[k][0] = y[p] - y[q];
+			s.edge[k][1] = x[q] - x[p];
+			s.edge[k][2] = x[p]*y[q] - y[p]*x[q];
+		}
+		const float area = s.edge[0][0]*x[0] + s.edge[0][1]*y[0] + s.edge[0][2];
+		if(area == 0 || area != area) continue;	//degenerate: covers no pixel center
+		const float inv = 1 / area;	//negative area flips the edges: both windings are drawn
+		for(unsigned int j=0; j<3; j++) {
+			s.invDepth[j] = 0;
+			for(unsigned int k=0; k<3; k++) {
+				s.edge[k][j] *= inv;	//edge functions become barycentric coordinates
+				s.invDepth[j] += s.edge[k][j] / tri.getDepth(k);
+			}
+		}
+		s.color = toRGB(tri.getColor());
+
+		for(int ty = s.miny/TILE; ty <= s.maxy/TILE; ty++)
+			for(int tx = s.minx/TILE; tx <= s.maxx/TILE; tx++) chunkBins[ty*tilesX + tx].push_back(i);
+	}
+}
+void Rasterizer::drawTiles() {
+	const unsigned int tiles = tilesX*tilesY;
+	for(;;) {
+		const unsigned int tile = nextTile.fetchAndAddOrdered(1);
+		if(tile >= tiles) return;
+		drawTile(tile);
+	}
+}
+void Rasterizer::drawTile(const unsigned int tile) {
+	const int x0 = (tile % tilesX) * TILE;
+	const int y0 = (tile / tilesX) * TILE;
+	const int x1 = std::min(x0 + TILE, (int)width) - 1;
+	const int y1 = std::min(y0 + TILE, (int)height) - 1;
+
+	const unsigned int back = toRGB(background);
+	for(int y=y0; y<=y1; y++) {
+		std::fill(&depth[y*width + x0], &depth[y*width + x1] + 1, 0.0f);
+		std::fill(&pixels[y*pixelsPerLine + x0], &pixels[y*pixelsPerLine + x1] + 1, back);
+	}
+
+	//chunks are drawn in order: same result as a single thread
+	for(unsigned int c=0; c<chunks; c++) {
+		const std::vector<unsigned int> & bin = bins[c * tilesX*tilesY + tile];
+		for(unsigned int j=0; j<bin.size(); j++) {
+			const SetupTri & s = tris[bin[j]];
+			const int sx = std::max(x0, s.minx), ex = std::min(x1, s.maxx);
+			const int sy = std::max(y0, s.miny), ey = std::min(y1, s.maxy);
+			for(int y=sy; y<=ey; y++) {
+				const float px = sx + 0.5f, py = y + 0.5f;	//center of first pixel
+				float e0 = s.edge[0][0]*px + s.edge[0][1]*py + s.edge[0][2];
+				float e1 = s.edge[1][0]*px + s.edge[1][1]*py + s.edge[1][2];
+				float e2 = s.edge[2][0]*px + s.edge[2][1]*py + s.edge[2][2];
+				float z = s.invDepth[0]*px + s.invDepth[1]*py + s.invDepth[2];
+				float * d = &depth[y*width];
+				unsigned int * p = &pixels[y*pixelsPerLine];
+				for(int x=sx; x<=ex; x++) {
+					if(e0 >= 0 && e1 >= 0 && e2 >= 0 && z > d[x]) {
+						d[x] = z;
+						p[x] = s.color;
+					}
+					e0 += s.edge[0][0];
+					e1 += s.edge[1][0];
+					e2 += s.edge[2][0];
+					z += s.invDepth[0];
+				}
+			}
+		}
+	}
+}
@@ -0,0 +1,74 @@
+/**
+ * @file Rasterizer.h
+ * @brief software rasterizer for previews
+ *
+ * Draws projected triangles of a VectorCam into a 32 bit image with a depth buffer, so overlapping objects are shown correctly.
+ */
+
+#ifndef RASTERIZER_H
+#define RASTERIZER_H
+
+#include "DetailedSpaces.h"
+
+#include <QAtomicInt>
+
+#include <vector>
+
+/**
+ * @brief Multithreaded, tile based rasterizer with depth test and flat colors.
+ *
+ * Image is divided into square tiles. First triangles are set up and sorted into the tiles their bounding box touches (bins), by several threads.
+ * Then each thread takes tiles and draws the triangles of their bins: a tile is written by one thread only, so no locking is needed.
+ * Depth is interpolated as 1/depth, that is linear on screen, so the depth test is exact for any perspective.
+ * Buffers are kept between frames: drawing the same size again doesn't allocate memory.
+ */
+class Rasterizer {
+public:
+	/** @brief Constructs a rasterizer with black background.*/
+	Rasterizer();
+
+	/** @brief Setter for color of pixels that no triangle covers.*/
+	void setBackground(const Color color);
+
+	/**
+	 * @brief Draws triangles into an image.
+	 *
+	 * Coordinates of triangles are the ones of VectorCam::project: origo is the center of image, y points upwards. Depths of triangles have to be positive.
+	 * Nothing is drawn into an empty image (0 width or height).
+	 * @param space projected triangles, drawn with their colors
+	 * @param pixels first pixel of image: 0xffRRGGBB values (like QImage::Format_RGB32)
+	 * @param width number of columns
+	 * @param height number of rows
+	 * @param bytesPerLine distance of the first pixels of 2 rows in bytes
+	 */
+	void draw(const DetailedSpace2D & space, unsigned int * pixels, const unsigned int width, const unsigned int height, const unsigned int bytesPerLine);
+
+	/** @brief Converts a color to an 0xffRRGGBB value, components are clamped to white.*/
+	static unsigned int toRGB(const Color color);
+private:
+	//triangle prepared for drawing: edge functions and 1/depth are linear functions of the position of pixel: a*x + b*y + c
+	struct SetupTri {
+		float edge[3][3];	//a, b, c of each edge, positive inside triangle
+		float invDepth[3];	//a, b, c of 1/depth
+		int minx, miny, maxx, maxy;	//bounding box in pixels, inclusive
+		unsigned int color;
+	};
+
+	Color background;
+	const DetailedSpace2D * space;	//triangles being drawn
+	std::vector<SetupTri> tris;
+	std::vector<std::vector<unsigned int> > bins;	//chunk*tileCount + tile: indices of triangles of a chunk that touch tile
+	std::vector<float> depth;	//1/depth of each pixel, 0: nothing drawn
+	unsigned int chunks;	//number of parts triangles are set up in
+	unsigned int * pixels;
+	unsigned int width, height, pixelsPerLine;
+	unsigned int tilesX, tilesY;
+	QAtomicInt nextTile;	//tiles are taken by threads in this order
+
+	friend class RasterTask;
+	void setup(const unsigned int chunk, const unsigned int first, const unsigned int end);	//sets up triangles [first,end[ and puts them into bins of chunk
+	void drawTiles();	//takes tiles until all are drawn
+	void drawTile(const unsigned int tile);
+};
+
+#endif
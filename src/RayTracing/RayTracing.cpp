@@ -1,70 +1,63 @@
 #include "RayTracing.h"
 
+#include <cmath>
 #include <cstdlib>
+#include <limits>
 
 //--------------------------------------Ray----------------------------------------------------------------
-Ray::Ray(const Vect3D a, const Vect3D b, const DetailedTri3D* const startTri) : HalfLine3D(a,b) {
-	this->startTri = startTri;
-	closest = 0;
+Ray::Ray(const Vect3D a, const Vect3D b, const SpaceCross start) : HalfLine3D(a,b) {
+	this->start = start;
 }
-Vect3D Ray::reflV(const DetailedTri3D* const tri) const {
+Vect3D Ray::reflV() const {
 	//direction of reflection
-	//assuming that tri is exist
+	//assuming that closest is exist
 	const Vect3D v = getV();
-	const Plane3D surf = tri->surface();
-	const Vect3D n = surf.getN();
-	const float t = surf.distsign(surf.getP()+v);
+	const Vect3D n = closest.getNormal();	//in coordinate system of space
+	const float t = (v*n) / (n*n);	//distance of v from surface where unit is length of n
 	return v - n*t*2;
 }
-Vect3D Ray::refrV(const DetailedTri3D* const tri) const {
+Vect3D Ray::refrV() const {
 	return getV();	//TODO
 }
-void Ray::shotAt(const DetailedTri3D & acttri) const {
-	if(startTri == &acttri) return;
-	if(! acttri.isCrossed(*this)) return;
-
-	const Vect3D actCross = cross(acttri.surface());
-	const Vect3D p = getP();
-	if(closest && p.dist2(actCross)>p.dist2(closestCross)) return;
-
-	closest = &acttri;
-	closestCross = actCross;
+void Ray::findClosest(const DetailedSpace3D & space) const {
+	closest = space.cross(*this, 0, std::numeric_limits<float>::infinity(), start);
 }
-const DetailedTri3D * Ray::getClosest() const		{return closest;}
-Vect3D Ray::getClosestCross() const					{return closestCross;}
+SpaceCross Ray::getClosest() const					{return closest;}
+Vect3D Ray::getClosestCross() const					{return getP() + getV()*closest.getT();}
 //--------------------------------------ViewRay----------------------------------------------------------------
-ViewRay::ViewRay(const Vect3D a, const Vect3D b, const DetailedTri3D* const startTri, const unsigned int depth) : Ray(a,b,startTri) {
+ViewRay::ViewRay(const Vect3D a, const Vect3D b, const SpaceCross start, const unsigned int depth) : Ray(a,b,start) {
 	this->depth = depth;
 }
 Color ViewRay::shotAt(const DetailedSpace3D & space) const {
 	const Color BLACK = Color();	//TODO: global constant
 
-	for(DetailedSpace3D::const_iterator i = space.begin(); i!=space.end(); i++) Ray::shotAt(*i);
-	const DetailedTri3D * closest = getClosest();	//TODO: nicer
+	findClosest(space);
+	if(! getClosest().isHit()) return BLACK;	//no hit, return black
+	const Material & closest = getClosest().getMaterial();
 
-	if(! closest) return BLACK;	//no hit, return black
-
-	Color result = closest->getActive();
+	Color result = closest.getActive();
 	if(depth < 1) return result;	//no more recursion!
 	
-	const Color refl = closest->getRefl();
-	const Color transp = closest->getTransp();
+	const Color refl = closest.getRefl();
+	const Color transp = closest.getTransp();
 	//these values could be put directly into the next expressions -> but it is readable this way
 	//also compiler should recognize this optimizing option
 	
 	if(refl != BLACK) {
 		const Vect3D a = getClosestCross();
-		const Vect3D b = getClosestCross()+reflV(closest);
+		const Vect3D b = getClosestCross()+reflV();
 		//these values could be put directly as parameters down -> it is only readable this way
 		result += ViewRay(a,b, getClosest(), depth-1).shotAt(space) * refl;
 	}
 	if(transp != BLACK) {
 		const Vect3D a = getClosestCross();
-		const Vect3D b = getClosestCross()+refrV(closest);
+		const Vect3D b = getClosestCross()+refrV();
 		result += ViewRay(a,b, getClosest(), depth-1).shotAt(space) * transp;
 	}
 	return result;
 }
+SpaceCross ViewRay::getHit() const		{return getClosest();}
+Vect3D ViewRay::getHitPos() const		{return getClosestCross();}
 //--------------------------------------ViewRayGroup----------------------------------------------------------------
 ViewRayGroup::ViewRayGroup(const Vect3D pos, const Vect3D focus, const Vect3D hdir, const Vect3D vdir, const float r, const float raydist) {
 	this->pos = pos;
@@ -75,8 +68,16 @@ ViewRayGroup::ViewRayGroup(const Vect3D pos, const Vect3D focus, const Vect3D hd
 	this->raydist = raydist;
 }
 Color ViewRayGroup::shotAt(const DetailedSpace3D & space) const {
-	Color resultSum;
-	unsigned int count = 0;
+	Vect3D normal;
+	float depth;
+	Color albedo;
+	return shotAt(space, normal, depth, albedo);
+}
+Color ViewRayGroup::shotAt(const DetailedSpace3D & space, Vect3D & normal, float & depth, Color & albedo) const {
+	Color resultSum, albedoSum;
+	Vect3D normalSum;
+	float depthSum = 0;
+	unsigned int count = 0, hits = 0;
 	//float rndx,rndy;
 	for(float x=-r; x<r; x+=raydist)
 		for(float y=-r; y<r; y+=raydist)
@@ -85,37 +86,115 @@ Color ViewRayGroup::shotAt(const DetailedSpace3D & space) const {
 				//rndx = (float)(rand()%1000)*0.001*raydist;
 				//rndy = (float)(rand()%1000)*0.001*raydist;
 				//resultSum += ViewRay(pos + hdir*(x*rndx) + vdir*(y*rndy), focus).shotAt(space);
-				resultSum += ViewRay(pos + hdir*x + vdir*y, focus).shotAt(space);
+				const ViewRay ray(pos + hdir*x + vdir*y, focus);
+				resultSum += ray.shotAt(space);
+				const SpaceCross hit = ray.getHit();
+				if(hit.isHit()) {
+					hits++;
+					const Vect3D n = hit.getNormal();
+					normalSum += n / std::sqrt(n*n);
+					depthSum += std::sqrt(ray.getV()*ray.getV()) * hit.getT();
+					albedoSum += hit.getMaterial().getActive();
+				}
 			}
+	if(! count) {
+		//no depth of field: lens is a point
+		const ViewRay ray(pos, focus);
+		const Color result = ray.shotAt(space);
+		const SpaceCross hit = ray.getHit();
+		normal = hit.isHit() ? hit.getNormal() : Vect3D();
+		depth = hit.isHit() ? std::sqrt(ray.getV()*ray.getV()) * hit.getT() : std::numeric_limits<float>::infinity();
+		albedo = hit.isHit() ? hit.getMaterial().getActive() : Color();
+		return result;
+	}
+	normal = normalSum / count;
+	depth = hits ? depthSum / hits : std::numeric_limits<float>::infinity();
+	albedo = albedoSum / count;
 	return resultSum / count;
 }
+Color ViewRayGroup::sumPart(const DetailedSpace3D & space, const unsigned int part, const unsigned int parts, unsigned int & count) const {
+	//rays are numbered in the order of shotAt()
+	Color resultSum;
+	unsigned int index = 0;
+	count = 0;
+	for(float x=-r; x<r; x+=raydist)
+		for(float y=-r; y<r; y+=raydist)
+			if(x*x + y*y < r*r && index++ % parts == part) {
+				count++;
+				resultSum += ViewRay(pos + hdir*x + vdir*y, focus).shotAt(space);
+			}
+	if(! index && part == 0) {
+		//no depth of field: lens is a point
+		count = 1;
+		return ViewRay(pos, focus).shotAt(space);
+	}
+	return resultSum;
+}
+unsigned int ViewRayGroup::getRayCount() const {
+	unsigned int count = 0;
+	for(float x=-r; x<r; x+=raydist)
+		for(float y=-r; y<r; y+=raydist)
+			if(x*x + y*y < r*r) count++;
+	return count ? count : 1;
+}
+//--------------------------------------ShadowRay----------------------------------------------------------------
+ShadowRay::ShadowRay(const Vect3D a, const Vect3D b, const SpaceCross start, const SpaceCross end) : Sect3D(a,b) {
+	this->start = start;
+	this->end = end;
+}
+bool ShadowRay::isBlocked(const DetailedSpace3D & space) const {
+	return space.isCrossed(*this, 0, 1, start, end);	//first blocker is enough, no need to find the closest
+}
+SpaceCross ShadowRay::getStart() const	{return start;}
+SpaceCross ShadowRay::getEnd() const	{return end;}
+//--------------------------------------ShadowRayGroup----------------------------------------------------------------
+ShadowRayGroup::ShadowRayGroup() {}
+void ShadowRayGroup::add(const ShadowRay ray)	{rays.push_back(ray);}
+unsigned int ShadowRayGroup::size() const		{return rays.size();}
+std::vector<bool> ShadowRayGroup::shotAt(const DetailedSpace3D & space) const {
+	std::vector<Line3D> lines(rays.begin(), rays.end());
+	std::vector<SpaceCross> starts, ends;
+	for(unsigned int r=0; r<rays.size(); r++) {
+		starts.push_back(rays[r].getStart());
+		ends.push_back(rays[r].getEnd());
+	}
+	std::vector<bool> blocked;
+	space.isCrossed(lines, 0, 1, starts, ends, blocked);	//sections: [0,1] range of lines
+	return blocked;
+}
+float ShadowRayGroup::visibility(const DetailedSpace3D & space) const {
+	if(rays.empty()) return 1;
+	const std::vector<bool> blocked = shotAt(space);
+	unsigned int open = 0;
+	for(unsigned int r=0; r<blocked.size(); r++) if(! blocked[r]) open++;
+	return (float)open / rays.size();
+}
 //--------------------------------------FotonRay----------------------------------------------------------------
-FotonRay::FotonRay(const Vect3D a, const Vect3D b, const Color color, const DetailedTri3D* const startTri, const unsigned int depth) : Ray(a,b,startTri) {
+FotonRay::FotonRay(const Vect3D a, const Vect3D b, const Color color, const SpaceCross start, const unsigned int depth) : Ray(a,b,start) {
 	this->color = color;
 	this->depth = depth;
 }
 void FotonRay::shotAt(const DetailedSpace3D & space) const {
-	for(DetailedSpace3D::const_iterator i = space.begin(); i!=space.end(); i++) Ray::shotAt(*i);
-	const DetailedTri3D * closest = getClosest();
-
-	if(! closest) return;	//no hit
+	findClosest(space);
+	if(! getClosest().isHit()) return;	//no hit
 	if(depth < 1) return;	//no more recursion! TODO: check... number of recursion
+	const Material & closest = getClosest().getMaterial();
 	
 	const Color BLACK = Color();
-	const Color refl = closest->getRefl();
-	const Color transp = closest->getTransp();
+	const Color refl = closest.getRefl();
+	const Color transp = closest.getTransp();
 	//these values could be put directly into the next expressions -> but it is readable this way
 	//also compiler should recognize this optimizing option
 	
 	if(refl != BLACK) { 
 		const Vect3D a = getClosestCross();
-		const Vect3D b = getClosestCross()+reflV(closest);
+		const Vect3D b = getClosestCross()+reflV();
 		//these values could be put directly as parameters down -> it is only readable this way
-		FotonRay(a,b, color*refl, closest, depth-1).shotAt(space);
+		FotonRay(a,b, color*refl, getClosest(), depth-1).shotAt(space);
 	}
 	if(transp != BLACK) {
 		const Vect3D a = getClosestCross();
-		const Vect3D b = getClosestCross()+refrV(closest);
-		FotonRay(a,b, color*transp, closest, depth-1).shotAt(space);
+		const Vect3D b = getClosestCross()+refrV();
+		FotonRay(a,b, color*transp, getClosest(), depth-1).shotAt(space);
 	}
 }
\ No newline at end of file
@@ -5,6 +5,8 @@
 
 #include <DetailedSpaces.h>
 
+#include <vector>
+
 /** @brief HalfLine3D with methods to calculate the closest crossed triangle in space.
  * 
  * This type is not able to do recursion, but provides methods to calculate direction of reflecting and refracting rays.*/
@@ -16,30 +18,28 @@ protected:
 	 * Two points can define a unique Ray. If points are the same then direction of Ray is a null vector.
 	 * @param a is the starting point
 	 * @param b is a point on Ray, defining direction
-	 * @param startTri triangle that has to be ignored when finding closest triangle
+	 * @param start triangle that has to be ignored when finding closest triangle
 	 */
-	Ray(const Vect3D a, const Vect3D b, const DetailedTri3D* const startTri = 0);
+	Ray(const Vect3D a, const Vect3D b, const SpaceCross start = SpaceCross());
 	
-	/** @brief optical reflection of ray when hiting given tri*/
-	Vect3D reflV(const DetailedTri3D* const tri) const;
+	/** @brief optical reflection of ray when hiting closest triangle*/
+	Vect3D reflV() const;
 	
-	/** @brief optical refraction of ray when hiting given tri*/
-	Vect3D refrV(const DetailedTri3D* const tri) const;
+	/** @brief optical refraction of ray when hiting closest triangle*/
+	Vect3D refrV() const;
 	
-	/** @brief changes stored values if given triangle is closer then closest and not starttri*/
-	void shotAt(const DetailedTri3D & acttri) const;
+	/** @brief finds closest triangle of space that is crossed by ray and is not start*/
+	void findClosest(const DetailedSpace3D & space) const;
 	
-	/** @brief closest crossed triangle*/
-	const DetailedTri3D * getClosest() const;
+	/** @brief closest crossed triangle, a cross with no triangle if ray doesn't cross anything*/
+	SpaceCross getClosest() const;
 	
 	/** @brief position of closest cross*/
 	Vect3D getClosestCross() const;
 
 private:
-	const DetailedTri3D* startTri;
-	const DetailedTri3D mutable * closest;	//found closest
-	mutable Vect3D closestCross;		//position of cross
-	
+	SpaceCross start;
+	mutable SpaceCross closest;	//found closest
 };
 
 /** @brief Ray that is shot from viewpoint through a pixel of the screen and 'recurses' itself in given depth
@@ -53,12 +53,18 @@ public:
 	 * 
 	 * @param a starting point of ray
 	 * @param b defines direction of ray
-	 * @param startTri triangle that the ray will ignore
+	 * @param start triangle that the ray will ignore
 	 * @param depth depth of recursion*/
-	ViewRay(const Vect3D a, const Vect3D b, const DetailedTri3D* const startTri = 0, const unsigned int depth = 8);
+	ViewRay(const Vect3D a, const Vect3D b, const SpaceCross start = SpaceCross(), const unsigned int depth = 8);
 	
 	/** @brief shots the ray and returns the result of the recursion*/
 	Color shotAt(const DetailedSpace3D & space) const;
+	
+	/** @brief closest cross found by shotAt(), a cross with no triangle if ray didn't hit anything*/
+	SpaceCross getHit() const;
+	
+	/** @brief position of closest cross found by shotAt()*/
+	Vect3D getHitPos() const;
 private:
 	unsigned int depth;		//recursion depth
 };
@@ -83,6 +89,26 @@ public:
 	
 	/** @brief Shots all rays and returns the average of their result.*/
 	Color shotAt(const DetailedSpace3D & space) const;
+	
+	/**
+	 * @brief Shots all rays and returns the average of their result and of what they hit first (auxiliary data for Denoiser).
+	 * 
+	 * @param normal average of unit normal vectors of hit surfaces
+	 * @param depth average distance of hits from starting points of rays, infinite if no ray hits anything
+	 * @param albedo average of active colors of hit surfaces (black where nothing is hit)
+	 */
+	Color shotAt(const DetailedSpace3D & space, Vect3D & normal, float & depth, Color & albedo) const;
+	
+	/**
+	 * @brief Shots every parts-th ray starting from the part-th one and returns the sum of their result, so rays of a group can be shot by more threads.
+	 * 
+	 * Sum of the results of all parts divided by getRayCount() is the result of shotAt().
+	 * @param count number of rays shot
+	 */
+	Color sumPart(const DetailedSpace3D & space, const unsigned int part, const unsigned int parts, unsigned int & count) const;
+	
+	/** @brief Number of rays shot by shotAt().*/
+	unsigned int getRayCount() const;
 private:
 	Vect3D pos,focus;	//position and focuspoint of RayGroup
 	Vect3D hdir,vdir;	//horizontal and vertical normal vectors
@@ -90,6 +116,55 @@ private:
 	float raydist;	//distance of startingpoint of rays
 };
 
+/** @brief Section between two points that only answers if anything blocks it.
+ * 
+ * Used for shadow and visibility checks. Unlike Ray it does not look for the closest triangle: it stops at the first triangle that crosses the section, and it does not calculate the cross point.*/
+class ShadowRay : public Sect3D {
+public:
+	/** @brief creates a ShadowRay from a to b
+	 * 
+	 * @param a starting point of section (e.g. point on a surface)
+	 * @param b ending point of section (e.g. position of a light)
+	 * @param start triangle that the ray will ignore (surface where a is)
+	 * @param end triangle that the ray will ignore (surface where b is)*/
+	ShadowRay(const Vect3D a, const Vect3D b, const SpaceCross start = SpaceCross(), const SpaceCross end = SpaceCross());
+	
+	/** @brief true if any triangle of space blocks the section, false if a and b see each other*/
+	bool isBlocked(const DetailedSpace3D & space) const;
+	
+	/** @brief triangle that the ray ignores at its starting point*/
+	SpaceCross getStart() const;
+	
+	/** @brief triangle that the ray ignores at its ending point*/
+	SpaceCross getEnd() const;
+private:
+	SpaceCross start;
+	SpaceCross end;
+};
+
+/** @brief Group of ShadowRays that are checked together - e.g. samples of an area light.
+ * 
+ * Acceleration structures of space are walked only once: each node is checked against the rays that are not blocked yet. Walking stops when all rays are blocked.*/
+class ShadowRayGroup {
+public:
+	/** @brief creates an empty group*/
+	ShadowRayGroup();
+	
+	/** @brief adds ray to group*/
+	void add(const ShadowRay ray);
+	
+	/** @brief number of rays in group*/
+	unsigned int size() const;
+	
+	/** @brief checks all rays; ith element of result is true if ith ray is blocked*/
+	std::vector<bool> shotAt(const DetailedSpace3D & space) const;
+	
+	/** @brief ratio of rays that are not blocked: 1 if all points see each other, 0 if all rays are blocked*/
+	float visibility(const DetailedSpace3D & space) const;
+private:
+	std::vector<ShadowRay> rays;
+};
+
 /** @brief Ray that is shot from a lighting point through a point of space containing a color parameter
  * 
  * Marks each triangle that it hits - this way it follows way of a foton.
@@ -101,9 +176,9 @@ public:
 	 * @param a starting point of ray
 	 * @param b defines direction of ray
 	 * @param color color of ray
-	 * @param startTri defines the triangle that the ray should ignore
+	 * @param start defines the triangle that the ray should ignore
 	 * @param depth depth of recursion*/
-	FotonRay(const Vect3D a, const Vect3D b, const Color color, const DetailedTri3D* const startTri = 0, const unsigned int depth = 8);
+	FotonRay(const Vect3D a, const Vect3D b, const Color color, const SpaceCross start = SpaceCross(), const unsigned int depth = 8);
 	
 	/** Shots the ray and marks each triangles in space that it touches.
 	 * 
@@ -0,0 +1,78 @@
+#include "RegionRenderer.h"
+#include "TaskGroup.h"
+
+#include <QRunnable>
+
+#include <algorithm>
+
+namespace {
+	const unsigned int ROWSPERTHREAD = 4;	//with less rows, a thread could be left without work while others finish their last rows
+}
+
+//renders one part of the rays of one row
+class RegionTask : public QRunnable {
+public:
+	RegionTask(RegionRenderer & renderer, const unsigned int row, const unsigned int part) : renderer(renderer), row(row), part(part) {}
+	void run() {renderer.renderRow(row, part);}
+private:
+	RegionRenderer & renderer;
+	const unsigned int row, part;
+};
+//--------------------------------------RegionRenderer----------------------------------------------------------------
+RegionRenderer::RegionRenderer() : tasks(0), finishedTasks(0) {
+	cam = 0;
+	left = top = width = height = 0;
+	parts = 1;
+	rays = 1;
+}
+void RegionRenderer::render(const RayTracerCam & cam, const unsigned int x, const unsigned int y, const unsigned int width, const unsigned int height) {
+	this->cam = &cam;
+	left = std::min(x, (unsigned int)cam.getXres());
+	top = std::min(y, (unsigned int)cam.getYres());
+	this->width = std::min(width, cam.getXres() - left);
+	this->height = std::min(height, cam.getYres() - top);
+	rays = cam.getRaysPerPixel();
+	TaskGroup group;
+	const unsigned int threads = group.getThreads();
+	parts = this->height < threads*ROWSPERTHREAD ? std::min(threads, rays) : 1;
+	finishedTasks.fetchAndStoreOrdered(0);
+	tasks.fetchAndStoreOrdered(this->height*parts);
+
+	sums.resize(parts);
+	for(unsigned int i=0; i<parts; i++) sums[i].assign((size_t)this->width*this->height*3, 0.0f);
+	for(unsigned int row=0; row<this->height; row++)
+		for(unsigned int part=0; part<parts; part++) group.start(new RegionTask(*this, row, part));
+	group.wait();
+
+	//parts are added into the first one
+	std::vector<float> & result = sums[0];
+	for(unsigned int i=1; i<parts; i++)
+		for(size_t j=0; j<result.size(); j++) result[j] += sums[i][j];
+	sums.resize(1);
+}
+Color RegionRenderer::getColor(const unsigned int x, const unsigned int y) const {
+	const float * rgb = &sums[0][((size_t)y*width + x)*3];
+	return Color(rgb[0], rgb[1], rgb[2]) / rays;
+}
+unsigned int RegionRenderer::getWidth() const			{return width;}
+unsigned int RegionRenderer::getHeight() const			{return height;}
+unsigned int RegionRenderer::getParts() const			{return parts;}
+float RegionRenderer::getProgress() const {
+	const int total = tasks.fetchAndAddOrdered(0);
+	return total ? (float)finishedTasks.fetchAndAddOrdered(0) / total : 0;
+}
+//privates:
+void RegionRenderer::renderRow(const unsigned int row, const unsigned int part) {
+	const int w = cam->getXres();
+	const int h = cam->getYres();
+	const int y = top + row;
+	float * out = &sums[part][(size_t)row*width*3];
+	for(unsigned int x=left; x<left+width; x++) {
+		unsigned int count;
+		const Color c = cam->sumRays((int)x - w/2, h/2 - y, part, parts, count);
+		*out++ = c.getR();
+		*out++ = c.getG();
+		*out++ = c.getB();
+	}
+	finishedTasks.fetchAndAddOrdered(1);
+}
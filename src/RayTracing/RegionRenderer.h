@@ -0,0 +1,63 @@
+/**
+ * @file RegionRenderer.h
+ * @brief rendering a rectangle of an image with all threads, however small it is
+ */
+
+#ifndef REGIONRENDERER_H
+#define REGIONRENDERER_H
+
+#include "Camera.h"
+
+#include <QAtomicInt>
+
+#include <vector>
+
+/**
+ * @brief Renders only a rectangle (crop window) of the image of a RayTracerCam.
+ *
+ * Rows of the rectangle are rendered by the shared thread pool (TaskGroup). If there are too few rows to keep all threads busy, rays of each pixel are split as well:
+ * each thread sums an other part of the rays (RayTracerCam::sumRays()) into its own buffer, and the buffers are added at the end.
+ * Either way pixels have the color of RayTracerCam::calcColor() without primary cache.
+ */
+class RegionRenderer {
+public:
+	/** @brief Constructs a renderer.*/
+	RegionRenderer();
+
+	/**
+	 * @brief Renders the rectangle of the image of camera, returns when it is done.
+	 *
+	 * @param cam camera for raytracing
+	 * @param x,y top left corner of rectangle, 0,0 is the top left corner of image
+	 * @param width,height size of rectangle, it is cut at the edges of image
+	 */
+	void render(const RayTracerCam & cam, const unsigned int x, const unsigned int y, const unsigned int width, const unsigned int height);
+
+	/** @brief Color of x,y pixel of rectangle of last render(), 0,0 is its top left corner.*/
+	Color getColor(const unsigned int x, const unsigned int y) const;
+
+	/** @brief Width of rectangle of last render().*/
+	unsigned int getWidth() const;
+
+	/** @brief Height of rectangle of last render().*/
+	unsigned int getHeight() const;
+
+	/** @brief Number of parts the rays of each pixel were split into by last render(), 1 if only rows were split.*/
+	unsigned int getParts() const;
+
+	/** @brief Finished part of the current render() from 0 to 1, can be called from any thread.*/
+	float getProgress() const;
+private:
+	const RayTracerCam * cam;
+	unsigned int left, top, width, height;
+	unsigned int parts;
+	unsigned int rays;	//rays of each pixel in all parts
+	std::vector< std::vector<float> > sums;	//RGB sums of each part
+	mutable QAtomicInt tasks;	//rows times parts
+	mutable QAtomicInt finishedTasks;
+
+	friend class RegionTask;
+	void renderRow(const unsigned int row, const unsigned int part);	//row of rectangle
+};
+
+#endif
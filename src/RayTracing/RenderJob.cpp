@@ -0,0 +1,49 @@
+#include "RenderJob.h"
+
+#include <cstdio>
+
+//--------------------------------------RenderJob----------------------------------------------------------------
+RenderJob::RenderJob() {
+	priority = 0;
+}
+RenderJob::RenderJob(const QString & scene, const RayTracerCam & cam, const int priority) {
+	this->scene = scene;
+	this->priority = priority;
+	this->cam.setRes(cam.getXres(), cam.getYres());
+	this->cam.setProjection(cam.getProjection());
+	this->cam.setAov(cam.getAov());
+	this->cam.setDensity(cam.getDensity());
+	this->cam.setFocusDist(cam.getFocusDist());
+	this->cam.setDof(cam.getDof());
+	this->cam.setPos(cam.getPos());
+	this->cam.setHVDir(cam.getHdir(), cam.getVdir(), cam.getDir());
+}
+bool RenderJob::parse(const QByteArray & line) {
+	int w, h, projection, n = 0;
+	float v[16];
+	if(std::sscanf(line.constData(), "%d %d %d %d %f %f %f %f %f %f %f %f %f %f %f %f %f %f %f %f %n",
+		&priority, &w, &h, &projection, v, v+1, v+2, v+3, v+4, v+5, v+6, v+7, v+8, v+9, v+10, v+11, v+12, v+13, v+14, v+15, &n) != 20 || ! n) return false;	//%n is not counted
+	if(w <= 0 || h <= 0 || projection < RayTracerCam::PERSPECTIVE || projection > RayTracerCam::CUBEMAP) return false;
+	scene = QString::fromLocal8Bit(line.constData() + n).trimmed();
+	if(scene.isEmpty()) return false;
+	cam.setRes(w, h);
+	cam.setProjection((RayTracerCam::Projection)projection);
+	cam.setAov(v[0]);
+	cam.setDensity(v[1]);
+	cam.setFocusDist(v[2]);
+	cam.setDof(v[3]);
+	cam.setPos(Vect3D(v[4], v[5], v[6]));
+	cam.setHVDir(Vect3D(v[7], v[8], v[9]), Vect3D(v[10], v[11], v[12]), Vect3D(v[13], v[14], v[15]));
+	return true;
+}
+QByteArray RenderJob::toLine() const {
+	const Vect3D p[4] = {cam.getPos(), cam.getHdir(), cam.getVdir(), cam.getDir()};
+	char text[512];
+	int length = std::sprintf(text, "%d %d %d %d %.9g %.9g %.9g %.9g", priority, cam.getXres(), cam.getYres(), cam.getProjection(), cam.getAov(), cam.getDensity(), cam.getFocusDist(), cam.getDof());
+	for(unsigned int i=0; i<4; i++) length += std::sprintf(text + length, " %.9g %.9g %.9g", p[i].getX(), p[i].getY(), p[i].getZ());
+	text[length++] = ' ';
+	return QByteArray(text, length) + scene.toLocal8Bit();
+}
+const QString & RenderJob::getScene() const		{return scene;}
+const RayTracerCam & RenderJob::getCam() const	{return cam;}
+int RenderJob::getPriority() const				{return priority;}
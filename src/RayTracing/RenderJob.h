@@ -0,0 +1,48 @@
+/**
+ * @file RenderJob.h
+ * @brief description of a rendering that can be sent between processes
+ */
+
+#ifndef RENDERJOB_H
+#define RENDERJOB_H
+
+#include "Camera.h"
+
+#include <QByteArray>
+#include <QString>
+
+/**
+ * @brief Scene file, camera and priority of a rendering, convertible to one line of text.
+ *
+ * Line is "priority width height projection aov density focus dof px py pz hx hy hz vx vy vz dx dy dz scene":
+ * projection is a RayTracerCam::Projection number, then position, horizontal and vertical normal vectors and direction of camera, scene is the name of a SceneFile (can contain spaces).
+ */
+class RenderJob {
+public:
+	/** @brief Constructs a job with no scene, default camera and 0 priority.*/
+	RenderJob();
+
+	/** @brief Constructs a job from a camera (space of camera is not used).*/
+	RenderJob(const QString & scene, const RayTracerCam & cam, const int priority = 0);
+
+	/** @brief Reads job from a line made by toLine(), false if line is invalid.*/
+	bool parse(const QByteArray & line);
+
+	/** @brief Job as one line of text, without line end.*/
+	QByteArray toLine() const;
+
+	/** @brief Name of scene file.*/
+	const QString & getScene() const;
+
+	/** @brief Camera without space: resolution, projection, angle of view, position, direction, focus, depth of field and density.*/
+	const RayTracerCam & getCam() const;
+
+	/** @brief Jobs with higher priority are rendered first.*/
+	int getPriority() const;
+private:
+	QString scene;
+	RayTracerCam cam;
+	int priority;
+};
+
+#endif
@@ -0,0 +1,75 @@
+#include "SceneFile.h"
+
+#include <QFile>
+
+#include <cstdio>
+#include <cstring>
+
+namespace {
+	const unsigned int LINESIZE = 256;	//longest line of a scene file
+}
+//--------------------------------------SceneFile----------------------------------------------------------------
+bool SceneFile::load(const QString & fileName, DetailedSpace3D & space) {
+	QFile file(fileName);
+	if(! file.open(QIODevice::ReadOnly)) return false;
+	const qint64 size = file.size();
+	const char * data = size ? (const char*)file.map(0, size) : 0;
+	if(size && ! data) return false;
+
+	DetailedMesh3D mesh;
+	unsigned int material = mesh.addMaterial(Material());
+	Material current;
+	const char * end = data + size;
+	for(const char * s = data; s < end; ) {
+		const char * next = (const char*)std::memchr(s, '\n', end - s);
+		if(! next) next = end;
+		char line[LINESIZE];
+		const unsigned int length = next - s;
+		if(length >= LINESIZE) return false;
+		std::memcpy(line, s, length);	//sscanf needs terminated strings
+		line[length] = 0;
+		s = next + 1;
+
+		char command[16];
+		int n = 0;
+		if(std::sscanf(line, " %15s %n", command, &n) != 1 || command[0] == '#') continue;
+		const char * args = line + n;
+		float v[10];
+		if(! std::strcmp(command, "v")) {
+			if(std::sscanf(args, "%f %f %f", v, v+1, v+2) != 3) return false;
+			mesh.addVertex(Vect3D(v[0], v[1], v[2]));
+		} else if(! std::strcmp(command, "f")) {
+			unsigned int a, b, c;
+			if(std::sscanf(args, "%u %u %u", &a, &b, &c) != 3) return false;
+			const unsigned int count = mesh.getVertexCount();
+			if(! a || ! b || ! c || a > count || b > count || c > count) return false;
+			mesh.addTri(a-1, b-1, c-1, material);
+		} else if(! std::strcmp(command, "mat")) {
+			const int read = std::sscanf(args, "%f %f %f %f %f %f %f %f %f %f", v, v+1, v+2, v+3, v+4, v+5, v+6, v+7, v+8, v+9);
+			if(read != 3 && read != 6 && read != 9 && read != 10) return false;
+			current = Material();
+			current.setActive(Color(v[0], v[1], v[2]));
+			if(read >= 6) current.setRefl(Color(v[3], v[4], v[5]));
+			if(read >= 9) current.setTransp(Color(v[6], v[7], v[8]));
+			if(read == 10) current.setRefr(v[9]);
+			material = mesh.addMaterial(current);
+		} else if(! std::strcmp(command, "sphere")) {
+			if(std::sscanf(args, "%f %f %f %f", v, v+1, v+2, v+3) != 4) return false;
+			DetailedShape3D shape(Vect3D(v[0], v[1], v[2]), v[3]);
+			shape.setMaterial(current);
+			space.addShape(shape);
+		} else if(! std::strcmp(command, "plane")) {
+			if(std::sscanf(args, "%f %f %f %f %f %f", v, v+1, v+2, v+3, v+4, v+5) != 6) return false;
+			DetailedShape3D shape(Plane3D(Vect3D(v[0], v[1], v[2]), Vect3D(v[3], v[4], v[5])));
+			shape.setMaterial(current);
+			space.addShape(shape);
+		} else if(! std::strcmp(command, "box")) {
+			if(std::sscanf(args, "%f %f %f %f %f %f", v, v+1, v+2, v+3, v+4, v+5) != 6) return false;
+			DetailedShape3D shape(Box3D(Vect3D(v[0], v[1], v[2]), Vect3D(v[3], v[4], v[5])));
+			shape.setMaterial(current);
+			space.addShape(shape);
+		} else return false;
+	}
+	if(mesh.size()) space.addInstance(space.addMesh(mesh), Transform3D());
+	return true;
+}
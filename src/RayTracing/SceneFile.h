@@ -0,0 +1,35 @@
+/**
+ * @file SceneFile.h
+ * @brief loading spaces from text files
+ */
+
+#ifndef SCENEFILE_H
+#define SCENEFILE_H
+
+#include "DetailedSpaces.h"
+
+#include <QString>
+
+/**
+ * @brief Reads a scene in a simple text format, similar to Wavefront OBJ.
+ *
+ * Each line is one command, empty lines and lines starting with # are skipped:
+ * - v x y z: vertex of the mesh of scene
+ * - mat r g b [rr rg rb [tr tg tb [refr]]]: active color, reflection, transparency and refraction of the next faces and shapes
+ * - f a b c: triangle of vertices a, b, c (numbered from 1, in order of v lines)
+ * - sphere x y z r, plane px py pz nx ny nz, box x0 y0 z0 x1 y1 z1: shapes
+ *
+ * File is mapped into memory and parsed in place, it is not copied.
+ */
+class SceneFile {
+public:
+	/**
+	 * @brief Adds the scene of file to space: faces as one mesh with one instance, shapes one by one.
+	 *
+	 * Space is not built.
+	 * @return false if file can not be read or has an invalid line (space may contain part of the scene then)
+	 */
+	static bool load(const QString & fileName, DetailedSpace3D & space);
+};
+
+#endif
@@ -1,7 +1,6 @@
 #include "Space2D.h"
 
 #include <cmath>
-#include <iostream>
 //--------------------------------------Vect2D----------------------------------------------------------------
 Vect2D::Vect2D()								{set(0,0);}
 Vect2D::Vect2D(const float x, const float y)	{set(x,y);}
@@ -51,20 +50,10 @@ Vect2D Line2D::getV() const {return v;}
 //--------------------------------------Rot2D----------------------------------------------------------------
 Rot2D::Rot2D(const float f) {set(f);}
 void Rot2D::set(const float f) {
-	//f: rotation in [0, M_PI[ range
+	//f: rotation in [0, M_PI[ range => angle of rotation is 2*f
 	this->f = f;
-	
-	//sin and cos are defined on some widely used values:
-	//switch is not working with float values
-	//TODO: check and make more precise - and also think over the type..
-	if(f == 0) 					{cos=1;				sin=0; 					return;}
-	if(f == (float)M_PI/4)		{cos=0;				sin=1;					return;}
-	if(f == (float)M_PI/360)	{cos=0.999847695156;sin=0.0174524064373;	return;}
-	if(f == (float)M_PI/1440)	{cos=0.999990480721;sin=0.00436330928475;	return;}
-	
-	cos = std::cos(f);
-	sin = std::sin(f);
-	std::cout << "used sin() and cos(), baad" << std::endl;
+	cos = std::cos(2*f);
+	sin = std::sin(2*f);
 }
 void Rot2D::operator+=(const Rot2D o) {
 	float ncos = cos*o.cos - sin*o.sin;	//new value of cos, we store it so we can calcualte with the old one
@@ -78,12 +67,7 @@ void Rot2D::operator-=(const Rot2D o) {
 	cos = ncos;
 	f -= o.f;
 }
-Rot2D Rot2D::operator*(int v) const {
-	Rot2D result;
-	if(v>0) for(int i=0; i<v; i++) result+=*this;
-	if(v<0) for(int i=v; i<0; i++) result-=*this;
-	return result;
-}
+Rot2D Rot2D::operator*(int v) const	{return Rot2D(f*v);}
 Vect2D Rot2D::dir() const	{return Vect2D(cos,sin);}
 float Rot2D::getCos() const		{return cos;}
 float Rot2D::getSin() const		{return sin;}
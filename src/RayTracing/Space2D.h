@@ -182,7 +182,7 @@ public:
 	void operator-=(const Rot2D o);
 	
 	/**
-	 * @brief Multiplies rotation with given integer.
+	 * @brief Multiplies rotation with given integer: sin and cos are calculated once, whatever v is.
 	 */
 	Rot2D operator*(int v) const;
 
@@ -210,8 +210,6 @@ public:
 private:
 	float cos,sin;	//we only deal with cos and sin directly.
 	float f;	//[0,M_PI[ range. Stored for external useage (e.g. drawing a rotating object) and for recalculating sin and cos values
-	//TODO: recalculator
-	//TODO: keep f in range 0, M_PI
 };
 
 #endif
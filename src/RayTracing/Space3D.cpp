@@ -1,5 +1,9 @@
 #include <Space3D.h>
 
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
 //--------------------------------------Vect3D----------------------------------------------------------------
 Vect3D::Vect3D(){set(0,0,0);}
 Vect3D::Vect3D(float x, float y, float z) {set(x,y,z);}
@@ -107,4 +111,167 @@ Vect3D Axis3D::rot(const Vect3D q, const Rot2D rot) const {
 	//len(ry) == len(rx)*len(v) => if v is 1, we are good, if not, coordinate system will be deformed
 	const Vect3D ry(v,rx);	//order is important: it defines the direction of rotation. I want it to be anticlockwise looking FROM the direction of line. Why?, because then rx,ry,v looks like a coordinate system
 	return o + rx*rot.getCos() + ry*rot.getSin();
+}
+//--------------------------------------Quat3D----------------------------------------------------------------
+Quat3D::Quat3D() : w(1), v(0,0,0) {}
+Quat3D::Quat3D(const Vect3D axis, const Rot2D rot) : w(std::cos(rot.getF())), v(axis * std::sin(rot.getF())) {}
+Quat3D Quat3D::operator*(const Quat3D o) const {
+	Quat3D result;
+	result.w = w*o.w - v*o.v;
+	result.v = o.v*w + v*o.w + Vect3D(v, o.v);
+	return result;
+}
+Quat3D Quat3D::inverse() const {
+	Quat3D result;
+	result.w = w;
+	result.v = -v;
+	return result;
+}
+Vect3D Quat3D::rot(const Vect3D p) const {
+	const Vect3D t = Vect3D(v, p) * 2;
+	return p + t*w + Vect3D(v, t);
+}
+void Quat3D::normalize() {
+	const float len = std::sqrt(w*w + v*v);
+	w /= len;
+	v = v / len;
+}
+//--------------------------------------Box3D----------------------------------------------------------------
+Box3D::Box3D() {
+	const float inf = std::numeric_limits<float>::infinity();
+	min.set(inf,inf,inf);
+	max.set(-inf,-inf,-inf);
+}
+Box3D::Box3D(const Vect3D min, const Vect3D max) {this->min = min; this->max = max;}
+void Box3D::extend(const Vect3D p) {
+	min.set(std::min(min.getX(),p.getX()), std::min(min.getY(),p.getY()), std::min(min.getZ(),p.getZ()));
+	max.set(std::max(max.getX(),p.getX()), std::max(max.getY(),p.getY()), std::max(max.getZ(),p.getZ()));
+}
+void Box3D::extend(const Box3D o) {
+	if(o.isEmpty()) return;
+	extend(o.min);
+	extend(o.max);
+}
+bool Box3D::isEmpty() const {return min.getX() > max.getX();}
+bool Box3D::contains(const Vect3D p) const {
+	return min.getX() <= p.getX() && p.getX() <= max.getX()
+		&& min.getY() <= p.getY() && p.getY() <= max.getY()
+		&& min.getZ() <= p.getZ() && p.getZ() <= max.getZ();
+}
+float Box3D::area() const {
+	if(isEmpty()) return 0;
+	const Vect3D d = max-min;
+	return 2*(d.getX()*d.getY() + d.getY()*d.getZ() + d.getZ()*d.getX());
+}
+Vect3D Box3D::getCenter() const	{return (min+max)/2;}
+Vect3D Box3D::getMin() const	{return min;}
+Vect3D Box3D::getMax() const	{return max;}
+float Box3D::distsign(const Vect3D p, const Vect3D inv, const float tmin, const float tmax) const {
+	//slab method: the line enters box when it is inside all 3 slabs
+	//t of crossing the 2 planes of a slab: (min-p)*inv and (max-p)*inv - their order depends on sign of v
+	float t0 = tmin;
+	float t1 = tmax;
+
+	float tnear = (min.getX()-p.getX())*inv.getX();
+	float tfar = (max.getX()-p.getX())*inv.getX();
+	if(tnear > tfar) std::swap(tnear,tfar);
+	t0 = std::max(t0,tnear); t1 = std::min(t1,tfar);
+
+	tnear = (min.getY()-p.getY())*inv.getY();
+	tfar = (max.getY()-p.getY())*inv.getY();
+	if(tnear > tfar) std::swap(tnear,tfar);
+	t0 = std::max(t0,tnear); t1 = std::min(t1,tfar);
+
+	tnear = (min.getZ()-p.getZ())*inv.getZ();
+	tfar = (max.getZ()-p.getZ())*inv.getZ();
+	if(tnear > tfar) std::swap(tnear,tfar);
+	t0 = std::max(t0,tnear); t1 = std::min(t1,tfar);
+
+	if(t0 > t1) return std::numeric_limits<float>::infinity();
+	return t0;
+}
+//--------------------------------------Frustum3D----------------------------------------------------------------
+Frustum3D::Frustum3D() {count = 0;}
+void Frustum3D::add(const Plane3D plane) {
+	if(count < 6) planes[count++] = plane;
+}
+bool Frustum3D::contains(const Vect3D p) const {
+	for(unsigned int i=0; i<count; i++)
+		if((p - planes[i].getP()) * planes[i].getN() < 0) return false;
+	return true;
+}
+Frustum3D::Overlap Frustum3D::overlap(const Box3D box) const {
+	if(box.isEmpty()) return OUTSIDE;
+	const Vect3D min = box.getMin();
+	const Vect3D max = box.getMax();
+	Overlap result = INSIDE;
+	for(unsigned int i=0; i<count; i++) {
+		const Vect3D n = planes[i].getN();
+		//corners farthest above and under plane
+		const Vect3D above(n.getX() >= 0 ? max.getX() : min.getX(), n.getY() >= 0 ? max.getY() : min.getY(), n.getZ() >= 0 ? max.getZ() : min.getZ());
+		const Vect3D under(n.getX() >= 0 ? min.getX() : max.getX(), n.getY() >= 0 ? min.getY() : max.getY(), n.getZ() >= 0 ? min.getZ() : max.getZ());
+		if((above - planes[i].getP()) * n < 0) return OUTSIDE;
+		if((under - planes[i].getP()) * n < 0) result = PARTIAL;
+	}
+	return result;
+}
+//--------------------------------------Transform3D----------------------------------------------------------------
+Transform3D::Transform3D() {set(Vect3D(1,0,0), Vect3D(0,1,0), Vect3D(0,0,1), Vect3D(0,0,0));}
+Transform3D::Transform3D(const Vect3D o) {set(Vect3D(1,0,0), Vect3D(0,1,0), Vect3D(0,0,1), o);}
+Transform3D::Transform3D(const Vect3D x, const Vect3D y, const Vect3D z, const Vect3D o) {set(x,y,z,o);}
+void Transform3D::set(const Vect3D x, const Vect3D y, const Vect3D z, const Vect3D o) {
+	//x,y,z are columns of matrix
+	rx.set(x.getX(), y.getX(), z.getX());
+	ry.set(x.getY(), y.getY(), z.getY());
+	rz.set(x.getZ(), y.getZ(), z.getZ());
+	t = o;
+	calcInverse();
+}
+Vect3D Transform3D::point(const Vect3D p) const		{return Vect3D(rx*p, ry*p, rz*p) + t;}
+Vect3D Transform3D::vector(const Vect3D v) const		{return Vect3D(rx*v, ry*v, rz*v);}
+Vect3D Transform3D::normal(const Vect3D n) const {
+	//inverse transpose: rows of inverse are columns of result
+	return ix*n.getX() + iy*n.getY() + iz*n.getZ();
+}
+Line3D Transform3D::line(const Line3D l) const {
+	const Vect3D p = point(l.getP());
+	return Line3D(p, p + vector(l.getV()));
+}
+Box3D Transform3D::box(const Box3D b) const {
+	Box3D result;
+	if(b.isEmpty()) return result;
+	const Vect3D min = b.getMin();
+	const Vect3D max = b.getMax();
+	for(int i=0; i<8; i++) result.extend(point(Vect3D(
+		i&1 ? max.getX() : min.getX(),
+		i&2 ? max.getY() : min.getY(),
+		i&4 ? max.getZ() : min.getZ())));
+	return result;
+}
+Transform3D Transform3D::inverse() const {
+	Transform3D result(*this);
+	std::swap(result.rx,result.ix);
+	std::swap(result.ry,result.iy);
+	std::swap(result.rz,result.iz);
+	std::swap(result.t,result.it);
+	return result;
+}
+Transform3D Transform3D::operator*(const Transform3D o) const {
+	//columns of result are this applied on columns of o
+	const Vect3D x(o.rx.getX(), o.ry.getX(), o.rz.getX());
+	const Vect3D y(o.rx.getY(), o.ry.getY(), o.rz.getY());
+	const Vect3D z(o.rx.getZ(), o.ry.getZ(), o.rz.getZ());
+	return Transform3D(vector(x), vector(y), vector(z), point(o.t));
+}
+//privates:
+void Transform3D::calcInverse() {
+	//columns of matrix: x,y,z => rows of inverse: (y,z)/det, (z,x)/det, (x,y)/det where (a,b) is cross product
+	const Vect3D x(rx.getX(), ry.getX(), rz.getX());
+	const Vect3D y(rx.getY(), ry.getY(), rz.getY());
+	const Vect3D z(rx.getZ(), ry.getZ(), rz.getZ());
+	const float det = x*Vect3D(y,z);
+	ix = Vect3D(y,z)/det;
+	iy = Vect3D(z,x)/det;
+	iz = Vect3D(x,y)/det;
+	it = -Vect3D(ix*t, iy*t, iz*t);
 }
\ No newline at end of file
@@ -312,4 +312,186 @@ public:
 	Vect3D rot(const Vect3D q, const Rot2D rot) const;
 };
 
+/**
+ * @brief Rotation in 3D stored as a unit quaternion: w + v.
+ * 
+ * Rotations are composed by a multiplication, without any trigonometric function, and a vector is rotated with 2 cross products.
+ * Direction of rotation is the same as Axis3D::rot(): anticlockwise looking from the direction of the axis.
+ */
+class Quat3D {
+public:
+	/** @brief Constructs the identity: no rotation.*/
+	Quat3D();
+	
+	/**
+	 * @brief Constructs a rotation around axis.
+	 * 
+	 * @param axis direction of axis, has to be a unit vector
+	 * @param rot angle of rotation (the f of Rot2D is half of the angle, exactly what a quaternion needs)
+	 */
+	Quat3D(const Vect3D axis, const Rot2D rot);
+	
+	/** @brief Rotation that applies o first, then this: (a*b).rot(v) == a.rot(b.rot(v)).*/
+	Quat3D operator*(const Quat3D o) const;
+	
+	/** @brief Inverse rotation.*/
+	Quat3D inverse() const;
+	
+	/** @brief Rotated v.*/
+	Vect3D rot(const Vect3D v) const;
+	
+	/** @brief Scales quaternion to unit length: a long chain of compositions doesn't deform vectors.*/
+	void normalize();
+private:
+	float w;
+	Vect3D v;
+};
+
+/**
+ * @brief axis aligned box in 3D
+ * 
+ * Box3D is stored by 2 vectors: the corner with minimal coordinates (min) and the corner with maximal coordinates (max). Used for bounding objects in space.
+ * @note An empty box has min = +infinity and max = -infinity, so extending it with a point results a box that contains only that point.
+ */
+class Box3D {
+public:
+	/** @brief Constructs an empty box.*/
+	Box3D();
+	
+	/** @brief Constructs a box with min and max corners.*/
+	Box3D(const Vect3D min, const Vect3D max);
+	
+	/** @brief Extends box so it contains p.*/
+	void extend(const Vect3D p);
+	
+	/** @brief Extends box so it contains o.*/
+	void extend(const Box3D o);
+	
+	/** @brief True if box contains no point.*/
+	bool isEmpty() const;
+	
+	/** @brief True if p is inside box (or on its border).*/
+	bool contains(const Vect3D p) const;
+	
+	/**
+	 * @brief Surface area of box.
+	 * 
+	 * Probability of a random line crossing a box is proportional to its surface area: this is what acceleration structures use to estimate cost of a box.
+	 * @note Area of an empty box is 0.
+	 */
+	float area() const;
+	
+	/** @brief Middle of box.*/
+	Vect3D getCenter() const;
+	
+	/** @brief Corner with minimal coordinates.*/
+	Vect3D getMin() const;
+	
+	/** @brief Corner with maximal coordinates.*/
+	Vect3D getMax() const;
+	
+	/**
+	 * @brief Value of t where line p + v*t enters box.
+	 * 
+	 * Only [tmin, tmax] range of line is checked.
+	 * @param p starting point of line.
+	 * @param inv (1/v.x, 1/v.y, 1/v.z) where v is direction of line - it is given this way so it is calculated only once for a line and not for each box.
+	 * @param tmin start of range.
+	 * @param tmax end of range.
+	 * @return t where line enters box (tmin if p+v*tmin is inside box), +infinity if range of line does not cross box.
+	 */
+	float distsign(const Vect3D p, const Vect3D inv, const float tmin, const float tmax) const;
+private:
+	Vect3D min,max;
+};
+
+/**
+ * @brief Convex region bounded by at most 6 planes, e.g. the part of space that a camera sees.
+ * 
+ * A point is inside if it is above (or on) each plane: normal vectors of planes point inwards.
+ */
+class Frustum3D {
+public:
+	/** @brief Position of a box compared to region.*/
+	enum Overlap {
+		OUTSIDE,	/**< no point of box is inside*/
+		PARTIAL,	/**< box may be partly inside*/
+		INSIDE		/**< whole box is inside*/
+	};
+	
+	/** @brief Constructs a region with no planes: whole space.*/
+	Frustum3D();
+	
+	/** @brief Adds a bounding plane, its normal vector points inwards. Planes over 6 are ignored.*/
+	void add(const Plane3D plane);
+	
+	/** @brief True if p is inside region (or on its border).*/
+	bool contains(const Vect3D p) const;
+	
+	/**
+	 * @brief Position of box compared to region.
+	 * 
+	 * Each plane is checked with the corner of box that is the farthest above it and the one that is the farthest under it.
+	 * The result is conservative: a box near an edge of region may be PARTIAL even if it is outside.
+	 */
+	Overlap overlap(const Box3D box) const;
+private:
+	Plane3D planes[6];
+	unsigned int count;
+};
+
+/**
+ * @brief affine transformation in 3D: rotation, scaling and translation
+ * 
+ * Transformation is defined by a coordinate system: x,y,z axes and origin o. Point (1,0,0) is transformed to o+x, (0,0,0) is transformed to o.
+ * Inverse of transformation is calculated when transformation is set - objects using transformations usually need both directions.
+ */
+class Transform3D {
+public:
+	/** @brief Constructs identity transformation.*/
+	Transform3D();
+	
+	/** @brief Constructs a translation: (0,0,0) is moved to o.*/
+	Transform3D(const Vect3D o);
+	
+	/**
+	 * @brief Constructs transformation from a coordinate system.
+	 * 
+	 * @warning If x,y,z are on the same plane, transformation has no inverse: inverse() results nan values.
+	 */
+	Transform3D(const Vect3D x, const Vect3D y, const Vect3D z, const Vect3D o);
+	
+	/** @brief Sets transformation from a coordinate system.*/
+	void set(const Vect3D x, const Vect3D y, const Vect3D z, const Vect3D o);
+	
+	/** @brief Transformed position of point p.*/
+	Vect3D point(const Vect3D p) const;
+	
+	/** @brief Transformed direction v (translation is not used).*/
+	Vect3D vector(const Vect3D v) const;
+	
+	/**
+	 * @brief Transformed normal vector of a plane.
+	 * 
+	 * Normal vectors need inverse transpose of transformation: this way transformed n keeps having right angle to transformed plane even if scaling is not uniform.
+	 */
+	Vect3D normal(const Vect3D n) const;
+	
+	/** @brief Transformed line: the points of result are the transformed points of line (same t in p + v*t).*/
+	Line3D line(const Line3D l) const;
+	
+	/** @brief Smallest axis aligned box containing the transformed box.*/
+	Box3D box(const Box3D b) const;
+	
+	/** @brief Inverse of transformation: point(inverse().point(p)) == p.*/
+	Transform3D inverse() const;
+	
+	/** @brief Transformation that first applies o then this.*/
+	Transform3D operator*(const Transform3D o) const;
+private:
+	Vect3D rx,ry,rz,t;	//rows of matrix and translation
+	Vect3D ix,iy,iz,it;	//rows of inverse matrix and translation of inverse
+	void calcInverse();
+};
+
 #endif
\ No newline at end of file
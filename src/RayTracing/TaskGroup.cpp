@@ -0,0 +1,90 @@
+#include "TaskGroup.h"
+
+#include <QAtomicInt>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QWaitCondition>
+
+#include <algorithm>
+#include <deque>
+#include <functional>
+#include <map>
+
+//queued tasks of a group, shared by group and its runners
+class TaskGroupState {
+public:
+	TaskGroupState() : refs(1), unfinished(0) {}
+
+	void release() {if(! refs.deref()) delete this;}
+
+	//takes the next task with the lock held, 0 if there is none
+	QRunnable * take() {
+		if(queued.empty()) return 0;
+		std::map<int, std::deque<QRunnable*>, std::greater<int> >::iterator i = queued.begin();
+		QRunnable * task = i->second.front();
+		i->second.pop_front();
+		if(i->second.empty()) queued.erase(i);
+		return task;
+	}
+
+	//runs a taken task without the lock held
+	void run(QRunnable * task) {
+		task->run();
+		if(task->autoDelete()) delete task;
+		QMutexLocker locker(&mutex);
+		unfinished--;
+		changed.wakeAll();
+	}
+
+	QAtomicInt refs;
+	QMutex mutex;
+	QWaitCondition changed;	//a task finished or was queued
+	std::map<int, std::deque<QRunnable*>, std::greater<int> > queued;	//by decreasing priority
+	unsigned int unfinished;	//queued or running
+};
+
+//runs the next task of a group in pool, there is one for each started task
+class TaskRunner : public QRunnable {
+public:
+	TaskRunner(TaskGroupState * state) : state(state) {state->refs.ref();}
+	~TaskRunner() {state->release();}
+	void run() {
+		QRunnable * task;
+		{
+			QMutexLocker locker(&state->mutex);
+			task = state->take();
+		}
+		if(task) state->run(task);	//else a waiting thread ran it
+	}
+private:
+	TaskGroupState * state;
+};
+//--------------------------------------TaskGroup----------------------------------------------------------------
+TaskGroup::TaskGroup(QThreadPool * pool) : pool(pool), state(new TaskGroupState()) {}
+TaskGroup::~TaskGroup() {
+	wait();
+	state->release();
+}
+void TaskGroup::start(QRunnable * task, const int priority) {
+	{
+		QMutexLocker locker(&state->mutex);
+		state->queued[priority].push_back(task);
+		state->unfinished++;
+		state->changed.wakeAll();
+	}
+	pool->start(new TaskRunner(state), priority);
+}
+void TaskGroup::wait() {
+	QMutexLocker locker(&state->mutex);
+	while(state->unfinished) {
+		QRunnable * task = state->take();
+		if(! task) {
+			state->changed.wait(&state->mutex);
+			continue;
+		}
+		locker.unlock();
+		state->run(task);	//its runner may be behind this thread in queue of pool
+		locker.relock();
+	}
+}
+unsigned int TaskGroup::getThreads() const	{return std::max(pool->maxThreadCount(), 1);}
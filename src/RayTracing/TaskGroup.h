@@ -0,0 +1,53 @@
+/**
+ * @file TaskGroup.h
+ * @brief tasks of one job on the thread pool shared by the whole program
+ */
+
+#ifndef TASKGROUP_H
+#define TASKGROUP_H
+
+#include <QRunnable>
+#include <QThreadPool>
+
+class TaskGroupState;
+
+/**
+ * @brief Starts the tasks of one job on a shared QThreadPool and waits for them, without waiting for the tasks of other jobs.
+ *
+ * All parallel work (renderers, denoiser, hierarchy builds) runs on one pool, QThreadPool::globalInstance() by default, so its maximal thread count limits the threads of the whole program.
+ * QThreadPool::waitForDone() would wait for every task of the pool, wait() waits only for the tasks of this group.
+ *
+ * Tasks are queued in the group, the pool gets a runner for each of them that takes the next task of the group.
+ * A thread that waits for a group runs the tasks that no runner took yet: a task can start tasks and wait for them
+ * (e.g. a hierarchy build in a background rebuild) even if all threads of the pool are waiting,
+ * and the GUI thread finishes a preview even if the pool is busy with a long render.
+ */
+class TaskGroup {
+public:
+	/** @brief Constructs a group of tasks of pool.*/
+	TaskGroup(QThreadPool * pool = QThreadPool::globalInstance());
+
+	/** @brief Waits for the tasks of group.*/
+	~TaskGroup();
+
+	/**
+	 * @brief Queues a task, it is deleted after it ran if its autoDelete() is true.
+	 *
+	 * @param priority tasks with higher priority run first, both in group and in pool (see QThreadPool::start())
+	 */
+	void start(QRunnable * task, const int priority = 0);
+
+	/** @brief Returns when all started tasks are finished.*/
+	void wait();
+
+	/** @brief Maximal number of threads of pool: tasks that can run at the same time.*/
+	unsigned int getThreads() const;
+private:
+	QThreadPool * pool;
+	TaskGroupState * state;	//shared with runners in pool: deleted by the last one
+
+	TaskGroup(const TaskGroup &);	//runners refer to the state of group
+	void operator=(const TaskGroup &);
+};
+
+#endif
@@ -0,0 +1,146 @@
+#include "TiledRenderer.h"
+
+#include <QFile>
+#include <QMutexLocker>
+#include <QRunnable>
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+
+namespace {
+	const unsigned int DESCRIPTIONSIZE = 512;	//longest first lines of a checkpoint file
+}
+
+//renders one tile of a band
+class TileTask : public QRunnable {
+public:
+	TileTask(TiledRenderer & renderer, TiledRenderer::Band & band, const unsigned int firstColumn, const unsigned int endColumn)
+		: renderer(renderer), band(band), firstColumn(firstColumn), endColumn(endColumn) {}
+	void run() {renderer.renderTile(band, firstColumn, endColumn);}
+private:
+	TiledRenderer & renderer;
+	TiledRenderer::Band & band;
+	const unsigned int firstColumn, endColumn;
+};
+//--------------------------------------TiledRenderer----------------------------------------------------------------
+TiledRenderer::TiledRenderer() : finishedRows(0), cancelled(0) {
+	tileSize = 64;
+	bandCount = 4;
+	checkpointInterval = 10000;
+	cam = 0;
+}
+void TiledRenderer::setTileSize(const unsigned int size)	{tileSize = std::max(size, 1u);}
+void TiledRenderer::setBands(const unsigned int bands)		{bandCount = std::max(bands, 1u);}
+void TiledRenderer::setCheckpoint(const QString & fileName, const unsigned int interval) {
+	checkpoint = fileName;
+	checkpointInterval = interval;
+}
+unsigned int TiledRenderer::getCheckpointRows(const RayTracerCam & cam) const {
+	if(checkpoint.isEmpty()) return 0;
+	QFile file(checkpoint);
+	if(! file.open(QIODevice::ReadOnly)) {
+		file.setFileName(checkpoint + ".tmp");	//killed while replacing checkpoint
+		if(! file.open(QIODevice::ReadOnly)) return 0;
+	}
+	char description[DESCRIPTIONSIZE];
+	describe(cam, description);
+	const qint64 length = std::strlen(description);
+	char text[DESCRIPTIONSIZE + 32];
+	const qint64 size = file.read(text, sizeof(text) - 1);
+	if(size < length || std::memcmp(text, description, length)) return 0;	//checkpoint of an other image
+	text[size] = 0;
+	unsigned int rows = 0;
+	if(std::sscanf(text + length, "%u", &rows) != 1 || rows % tileSize || rows > (unsigned int)cam.getYres()) return 0;
+	return rows;
+}
+bool TiledRenderer::render(const RayTracerCam & cam, ImageWriter & writer, const unsigned int firstRow) {
+	this->cam = &cam;
+	finishedRows.fetchAndStoreOrdered(firstRow);
+	cancelled.fetchAndStoreOrdered(0);
+	checkpointTimer.start();
+	const unsigned int width = cam.getXres();
+	const unsigned int height = cam.getYres();
+	const unsigned int first = firstRow / tileSize;
+	const unsigned int total = (height + tileSize-1) / tileSize;
+	bands.resize(std::min(bandCount, total - std::min(first, total)));
+	for(unsigned int i=0; i<bands.size(); i++) {
+		bands[i].rgb.resize((size_t)width*tileSize*3);
+		startBand(bands[i], (first + i)*tileSize);
+	}
+
+	bool ok = true;
+	for(unsigned int i=first; i<total; i++) {
+		Band & band = bands[(i - first) % bands.size()];
+		{
+			QMutexLocker locker(&lock);
+			while(band.tilesLeft) tileDone.wait(&lock);
+		}
+		if(cancelled.fetchAndAddOrdered(0) || ! writer.writeRows(&band.rgb[0], band.rows)) {
+			ok = false;
+			break;
+		}
+		const unsigned int rows = finishedRows.fetchAndAddOrdered(band.rows) + band.rows;
+		if(i + bands.size() < total) startBand(band, (i + bands.size())*tileSize);
+		if(! checkpoint.isEmpty() && rows < height && checkpointTimer.hasExpired(checkpointInterval)) {
+			if(writer.flush() && saveCheckpoint(rows)) checkpointTimer.start();	//rows are in the image file before checkpoint says so
+		}
+	}
+	cancelled.fetchAndStoreOrdered(1);	//tasks still queued return at once
+	tasks.wait();
+	std::vector<Band>().swap(bands);
+	if(ok && ! checkpoint.isEmpty()) removeCheckpoint();
+	return ok;
+}
+void TiledRenderer::cancel()					{cancelled.fetchAndStoreOrdered(1);}
+unsigned int TiledRenderer::getFinishedRows() const	{return finishedRows.fetchAndAddOrdered(0);}
+//privates:
+void TiledRenderer::startBand(Band & band, const unsigned int firstRow) {
+	const unsigned int width = cam->getXres();
+	band.firstRow = firstRow;
+	band.rows = std::min(tileSize, cam->getYres() - firstRow);
+	band.tilesLeft = (width + tileSize-1) / tileSize;
+	for(unsigned int x=0; x<width; x+=tileSize) tasks.start(new TileTask(*this, band, x, std::min(x+tileSize, width)));
+}
+void TiledRenderer::renderTile(Band & band, const unsigned int firstColumn, const unsigned int endColumn) {
+	if(! cancelled.fetchAndAddOrdered(0)) {
+		const int width = cam->getXres();
+		const int height = cam->getYres();
+		for(unsigned int r=0; r<band.rows; r++) {
+			const int y = band.firstRow + r;
+			float * out = &band.rgb[((size_t)r*width + firstColumn)*3];
+			for(int x=firstColumn; x<(int)endColumn; x++) {
+				const Color c = cam->calcColor(x - width/2, height/2 - y);
+				*out++ = c.getR();
+				*out++ = c.getG();
+				*out++ = c.getB();
+			}
+		}
+	}
+	QMutexLocker locker(&lock);
+	if(! --band.tilesLeft) tileDone.wakeAll();
+}
+void TiledRenderer::describe(const RayTracerCam & cam, char * text) const {
+	const Vect3D v[4] = {cam.getPos(), cam.getHdir(), cam.getVdir(), cam.getDir()};
+	int length = std::sprintf(text, "RayTracer checkpoint\n%d %d %u %u\n", cam.getXres(), cam.getYres(), tileSize, cam.getSpace() ? cam.getSpace()->getTriCount() : 0);
+	for(unsigned int i=0; i<4; i++) length += std::sprintf(text + length, "%.9g %.9g %.9g\n", v[i].getX(), v[i].getY(), v[i].getZ());
+	std::sprintf(text + length, "%.9g %.9g %.9g %.9g %d\n", cam.getAov(), cam.getFocusDist(), cam.getDof(), cam.getDensity(), cam.getProjection());
+}
+bool TiledRenderer::saveCheckpoint(const unsigned int rows) const {
+	//old checkpoint is replaced only by a complete one: killed while writing, the old one stays valid
+	const QString temp = checkpoint + ".tmp";
+	QFile file(temp);
+	if(! file.open(QIODevice::WriteOnly | QIODevice::Truncate)) return false;
+	char text[DESCRIPTIONSIZE + 32];
+	describe(*cam, text);
+	std::sprintf(text + std::strlen(text), "%u\n", rows);
+	const qint64 length = std::strlen(text);
+	if(file.write(text, length) != length || ! file.flush()) return false;
+	file.close();
+	QFile::remove(checkpoint);
+	return QFile::rename(temp, checkpoint);
+}
+void TiledRenderer::removeCheckpoint() const {
+	QFile::remove(checkpoint);
+	QFile::remove(checkpoint + ".tmp");
+}
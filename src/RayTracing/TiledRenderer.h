@@ -0,0 +1,103 @@
+/**
+ * @file TiledRenderer.h
+ * @brief rendering images of any size straight to disk
+ */
+
+#ifndef TILEDRENDERER_H
+#define TILEDRENDERER_H
+
+#include "Camera.h"
+#include "ImageWriter.h"
+#include "TaskGroup.h"
+
+#include <QAtomicInt>
+#include <QElapsedTimer>
+#include <QMutex>
+#include <QWaitCondition>
+
+#include <vector>
+
+/**
+ * @brief Renders an image with a RayTracerCam in tiles and streams it to an ImageWriter.
+ *
+ * Image is divided into bands of tile rows. Tiles of the next few bands are rendered by the shared thread pool (TaskGroup), the calling thread writes each band as soon as it is complete,
+ * then reuses its buffer for a later band. So memory is bounded by the bands in flight (bands*tileSize*width pixels), not by the size of the image.
+ * Primary cache of camera should be disabled: it would allocate memory for each pixel of the image.
+ *
+ * With a checkpoint file, the number of written rows is saved periodically (after the rows are flushed to the image file).
+ * A render killed before it finished can be continued from there: rays of a pixel depend only on the camera, so the result is the same as an uninterrupted render.
+ */
+class TiledRenderer {
+public:
+	/** @brief Constructs a renderer with 64 pixel tiles and 4 bands in memory.*/
+	TiledRenderer();
+
+	/** @brief Setter for width and height of tiles in pixels.*/
+	void setTileSize(const unsigned int size);
+
+	/** @brief Setter for number of bands (rows of tiles) kept in memory, at least 2 to render while writing.*/
+	void setBands(const unsigned int bands);
+
+	/**
+	 * @brief Sets file where progress of render() is saved, empty name disables checkpoints (default).
+	 *
+	 * @param fileName checkpoint file, removed when render() finishes the image
+	 * @param interval minimal time between 2 saves in ms
+	 */
+	void setCheckpoint(const QString & fileName, const unsigned int interval = 10000);
+
+	/**
+	 * @brief Rows written by an earlier render() of the same camera and tile size, according to checkpoint file.
+	 *
+	 * Space is not checked: it has to be the same as well.
+	 * @return 0 if there is no checkpoint of this image
+	 */
+	unsigned int getCheckpointRows(const RayTracerCam & cam) const;
+
+	/**
+	 * @brief Renders the image of camera into writer, returns when it is written.
+	 *
+	 * Writer has to be open with the resolution of camera (or resumed after firstRow rows), it is not closed.
+	 * @param firstRow rows already written, value of getCheckpointRows()
+	 * @return false if writing failed or cancel() was called
+	 */
+	bool render(const RayTracerCam & cam, ImageWriter & writer, const unsigned int firstRow = 0);
+
+	/** @brief Stops render() as soon as the tiles being rendered finish. Can be called from any thread.*/
+	void cancel();
+
+	/** @brief Rows written by the current render(), can be called from any thread.*/
+	unsigned int getFinishedRows() const;
+private:
+	//buffer of one band of tile rows
+	struct Band {
+		std::vector<float> rgb;
+		unsigned int firstRow, rows;
+		unsigned int tilesLeft;	//protected by lock
+	};
+
+	unsigned int tileSize;
+	unsigned int bandCount;
+	QString checkpoint;
+	unsigned int checkpointInterval;
+	QElapsedTimer checkpointTimer;	//time since last save
+	const RayTracerCam * cam;
+	std::vector<Band> bands;
+	mutable QAtomicInt finishedRows;
+	QAtomicInt cancelled;
+	QMutex lock;
+	QWaitCondition tileDone;
+	TaskGroup tasks;
+
+	friend class TileTask;
+	void startBand(Band & band, const unsigned int firstRow);	//starts tasks of all tiles of band
+	void renderTile(Band & band, const unsigned int firstColumn, const unsigned int endColumn);
+	void describe(const RayTracerCam & cam, char * text) const;	//first lines of checkpoint file: parameters of image
+	bool saveCheckpoint(const unsigned int rows) const;
+	void removeCheckpoint() const;
+
+	TiledRenderer(const TiledRenderer &);	//tasks refer to renderer
+	void operator=(const TiledRenderer &);
+};
+
+#endif
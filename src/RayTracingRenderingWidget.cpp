@@ -1,7 +1,15 @@
 #include "RayTracingRenderingWidget.h"
 
 #include <QElapsedTimer>
-#include <iostream>
+#include <QThreadPool>
+
+#include <algorithm>
+
+#include "RayTracing/Log.h"
+
+namespace {
+	const int PROGRESSSTEPS = 1000;	//maximum of progress bar when progress is a fraction
+}
 
 //--------------------------------------RayTracingThread----------------------------------------------------------------
 RayTracingThread::RayTracingThread(const RayTracerCam * cam, const int starty, const int endy, QImage * img, QWidget * parent) : QThread(parent) {
@@ -21,7 +29,7 @@ void RayTracingThread::run() {
 		emit rowRendered();
 	}
 }
-QColor RayTracingThread::toQColor(const Color color) const {
+QColor RayTracingThread::toQColor(const Color color) {
 	QColor result(255,255,255);
 	const float r = color.getR();
 	const float g = color.getG();
@@ -31,12 +39,57 @@ QColor RayTracingThread::toQColor(const Color color) const {
 	if(b <= 1.0) result.setBlue(b*255);
 	return result;
 }
+//--------------------------------------StreamingThread----------------------------------------------------------------
+StreamingThread::StreamingThread(TiledRenderer * renderer, const RayTracerCam * cam, ImageWriter * writer, const unsigned int firstRow, QWidget * parent) : QThread(parent) {
+	this->renderer = renderer;
+	this->cam = cam;
+	this->writer = writer;
+	this->firstRow = firstRow;
+	succeeded = false;
+}
+bool StreamingThread::isSucceeded() const {return succeeded;}
+void StreamingThread::run() {
+	const bool rendered = renderer->render(*cam, *writer, firstRow);
+	succeeded = writer->close() && rendered;
+}
+//--------------------------------------AnimationThread----------------------------------------------------------------
+AnimationThread::AnimationThread(AnimationRenderer * renderer, const RayTracerCam * cam, const CameraPath & path, const QString & fileName, QWidget * parent) : QThread(parent) {
+	this->renderer = renderer;
+	this->cam = cam;
+	this->path = path;
+	this->fileName = fileName;
+	succeeded = false;
+}
+bool AnimationThread::isSucceeded() const {return succeeded;}
+void AnimationThread::run() {succeeded = renderer->render(*cam, path, fileName);}
+//--------------------------------------BudgetThread----------------------------------------------------------------
+BudgetThread::BudgetThread(BudgetRenderer * renderer, const RayTracerCam * cam, const qint64 msecs, QWidget * parent) : QThread(parent) {
+	this->renderer = renderer;
+	this->cam = cam;
+	this->msecs = msecs;
+}
+void BudgetThread::run() {renderer->render(*cam, msecs);}
+//--------------------------------------RegionThread----------------------------------------------------------------
+RegionThread::RegionThread(RegionRenderer * renderer, const RayTracerCam * cam, const QRect & region, QWidget * parent) : QThread(parent) {
+	this->renderer = renderer;
+	this->cam = cam;
+	this->region = region;
+}
+void RegionThread::run() {renderer->render(*cam, region.x(), region.y(), region.width(), region.height());}
 //--------------------------------------RayTracingRenderingWidget----------------------------------------------------------------
 RayTracingRenderingWidget::RayTracingRenderingWidget(QWidget * parent) : QWidget(parent) {
 	progressBar = new QProgressBar(this);
 
 	progress = 0;
 	numberofActiveThreads = 0;
+	img = 0;
+	streamingThread = 0;
+	writer = 0;
+	animationThread = 0;
+	budgetThread = 0;
+	regionThread = 0;
+	progressTimer.setInterval(100);
+	connect(&progressTimer, SIGNAL(timeout()), this, SLOT(pollProgress()));
 }
 
 void RayTracingRenderingWidget::render(const RayTracerCam * cam, QImage * img) {
@@ -54,7 +107,75 @@ void RayTracingRenderingWidget::render(const RayTracerCam * cam, QImage * img) {
 	renderThread(cam, (numberofThreads-1)*ystep, cam->getYres(), img);
 }
 
-void RayTracingRenderingWidget::setNumberofThreads(unsigned int numberofThreads) {this->numberofThreads = numberofThreads;}
+bool RayTracingRenderingWidget::renderToFile(const RayTracerCam * cam, const QString & fileName) {
+	tiledRenderer.setCheckpoint(fileName + ".checkpoint");
+	unsigned int firstRow = tiledRenderer.getCheckpointRows(*cam);
+	writer = ImageWriter::create(fileName);
+	if(firstRow && ! writer->resume(fileName, cam->getXres(), cam->getYres(), firstRow)) {
+		delete writer;	//file doesn't belong to checkpoint: rendering starts again
+		writer = ImageWriter::create(fileName);
+		firstRow = 0;
+	}
+	if(! firstRow && ! writer->open(fileName, cam->getXres(), cam->getYres())) {
+		delete writer;
+		writer = 0;
+		return false;
+	}
+	if(firstRow) LOG_INFO("continuing rendering from row " << firstRow);
+	elapsedTimer.start();
+	progressBar->setMinimum(0);
+	progressBar->setMaximum(cam->getYres());
+	progressBar->setValue(firstRow);
+
+	streamingThread = new StreamingThread(&tiledRenderer, cam, writer, firstRow, this);
+	connect(streamingThread, SIGNAL(finished()), this, SLOT(streamFinished()));
+	streamingThread->start();
+	progressTimer.start();
+	return true;
+}
+
+void RayTracingRenderingWidget::renderAnimation(const RayTracerCam * cam, const CameraPath & path, const QString & fileName) {
+	elapsedTimer.start();
+	progressBar->setMinimum(0);
+	progressBar->setMaximum(path.getFrameCount());
+	progressBar->setValue(0);
+
+	animationThread = new AnimationThread(&animationRenderer, cam, path, fileName, this);
+	connect(animationThread, SIGNAL(finished()), this, SLOT(animationFinished()));
+	animationThread->start();
+	progressTimer.start();
+}
+
+void RayTracingRenderingWidget::renderTimed(const RayTracerCam * cam, QImage * img, const qint64 msecs) {
+	elapsedTimer.start();
+	this->img = img;
+	progressBar->setMinimum(0);
+	progressBar->setMaximum(msecs);
+	progressBar->setValue(0);
+
+	budgetThread = new BudgetThread(&budgetRenderer, cam, msecs, this);
+	connect(budgetThread, SIGNAL(finished()), this, SLOT(budgetFinished()));
+	budgetThread->start();
+	progressTimer.start();
+}
+
+void RayTracingRenderingWidget::renderRegion(const RayTracerCam * cam, QImage * img, const QRect & region) {
+	elapsedTimer.start();
+	this->img = img;
+	progressBar->setMinimum(0);
+	progressBar->setMaximum(PROGRESSSTEPS);
+	progressBar->setValue(0);
+
+	regionThread = new RegionThread(&regionRenderer, cam, region, this);
+	connect(regionThread, SIGNAL(finished()), this, SLOT(regionFinished()));
+	regionThread->start();
+	progressTimer.start();
+}
+
+void RayTracingRenderingWidget::setNumberofThreads(unsigned int numberofThreads) {
+	this->numberofThreads = numberofThreads;
+	QThreadPool::globalInstance()->setMaxThreadCount(std::max(numberofThreads, 1u));	//renderers and hierarchy builds all run on this pool
+}
 
 void RayTracingRenderingWidget::renderThread(const RayTracerCam * cam, unsigned int starty, unsigned int endy, QImage * img) {
 	RayTracingThread * thread = new RayTracingThread(cam,starty,endy, img, this);
@@ -76,6 +197,53 @@ void RayTracingRenderingWidget::threadFinished() {
 		QList<RayTracingThread*>::iterator i;
 		for (i = threads.begin(); i!=threads.end(); i++) delete(*i);
 		threads.clear();
-		std::cout << "rendering time: " << elapsedTimer.elapsed() << " ms" << std::endl;
+		LOG_INFO("rendering time: " << elapsedTimer.elapsed() << " ms");
 	}
+}
+
+void RayTracingRenderingWidget::pollProgress() {
+	if(animationThread) progressBar->setValue(animationRenderer.getFinishedFrames());
+	else if(budgetThread) progressBar->setValue(std::min(elapsedTimer.elapsed(), (qint64)progressBar->maximum()));
+	else if(regionThread) progressBar->setValue(regionRenderer.getProgress() * PROGRESSSTEPS);
+	else progressBar->setValue(tiledRenderer.getFinishedRows());
+}
+
+void RayTracingRenderingWidget::streamFinished() {
+	progressTimer.stop();
+	if(streamingThread->isSucceeded()) LOG_INFO("rendering time: " << elapsedTimer.elapsed() << " ms, image written to file");
+	else LOG_CRITICAL("writing rendered image failed");
+	delete streamingThread;
+	streamingThread = 0;
+	delete writer;
+	writer = 0;
+	emit(finished());
+}
+
+void RayTracingRenderingWidget::animationFinished() {
+	progressTimer.stop();
+	if(animationThread->isSucceeded()) LOG_INFO("animation rendering time: " << elapsedTimer.elapsed() << " ms, " << animationRenderer.getFramesPerHour() << " frames/hour");
+	else LOG_CRITICAL("rendering animation failed after " << animationRenderer.getFinishedFrames() << " frames");
+	delete animationThread;
+	animationThread = 0;
+	emit(finished());
+}
+
+void RayTracingRenderingWidget::budgetFinished() {
+	progressTimer.stop();
+	for(unsigned int y=0; y<budgetRenderer.getHeight(); y++)
+		for(unsigned int x=0; x<budgetRenderer.getWidth(); x++) img->setPixel(x,y, RayTracingThread::toQColor(budgetRenderer.getColor(x,y)).rgb());
+	LOG_INFO("rendering time: " << elapsedTimer.elapsed() << " ms, " << budgetRenderer.getSamplesPerPixel() << " rays/pixel (at least " << budgetRenderer.getMinSamples() << ")");
+	delete budgetThread;
+	budgetThread = 0;
+	emit(finished());
+}
+
+void RayTracingRenderingWidget::regionFinished() {
+	progressTimer.stop();
+	for(unsigned int y=0; y<regionRenderer.getHeight(); y++)
+		for(unsigned int x=0; x<regionRenderer.getWidth(); x++) img->setPixel(x,y, RayTracingThread::toQColor(regionRenderer.getColor(x,y)).rgb());
+	LOG_INFO("crop rendering time: " << elapsedTimer.elapsed() << " ms, rays of pixels split into " << regionRenderer.getParts() << " parts");
+	delete regionThread;
+	regionThread = 0;
+	emit(finished());
 }
\ No newline at end of file
@@ -6,9 +6,16 @@
 #include <QThread>
 #include <QWidget>
 #include <QProgressBar>
+#include <QRect>
 #include <QElapsedTimer>
+#include <QTimer>
 
+#include "RayTracing/AnimationRenderer.h"
+#include "RayTracing/BudgetRenderer.h"
 #include "RayTracing/Camera.h"
+#include "RayTracing/ImageWriter.h"
+#include "RayTracing/RegionRenderer.h"
+#include "RayTracing/TiledRenderer.h"
 
 /** @brief Thread for rendering part of image: always whole lines.*/
 class RayTracingThread : public QThread {
@@ -24,6 +31,9 @@ public:
 	 * @param parent parent of thread
 	 */
 	RayTracingThread(const RayTracerCam * cam, const int starty, const int endy, QImage * img, QWidget * parent);
+	
+	/** @brief Color of a pixel: components are clamped to white.*/
+	static QColor toQColor(const Color color);
 protected:
 	/** @brief http://doc.qt.digia.com/qt/qthread.html#run */
 	void run();
@@ -31,13 +41,107 @@ signals:
 	/** @brief signal emited when rendering of one row is finished*/
 	void rowRendered();
 private:
-	QColor toQColor(const Color color) const;
-
 	const RayTracerCam * cam;
 	int starty, endy;
 	QImage * img;
 };
 
+/** @brief Thread rendering a whole image into a file with a TiledRenderer, so the image doesn't have to fit into memory.*/
+class StreamingThread : public QThread {
+public:
+	/**
+	 * @brief construts a thread with given parameters.
+	 * 
+	 * @param renderer renderer of tiles, its threads do the rendering
+	 * @param cam camera for raytracing
+	 * @param writer open file of resolution of cam, closed by the thread
+	 * @param firstRow rows already in file (continuing a checkpoint)
+	 * @param parent parent of thread
+	 */
+	StreamingThread(TiledRenderer * renderer, const RayTracerCam * cam, ImageWriter * writer, const unsigned int firstRow, QWidget * parent);
+	
+	/** @brief true if whole image was written.*/
+	bool isSucceeded() const;
+protected:
+	/** @brief http://doc.qt.digia.com/qt/qthread.html#run */
+	void run();
+private:
+	TiledRenderer * renderer;
+	const RayTracerCam * cam;
+	ImageWriter * writer;
+	unsigned int firstRow;
+	bool succeeded;
+};
+
+/** @brief Thread rendering all frames of a CameraPath into files with an AnimationRenderer.*/
+class AnimationThread : public QThread {
+public:
+	/**
+	 * @brief construts a thread with given parameters.
+	 * 
+	 * @param renderer renderer of frames, its threads do the rendering
+	 * @param cam camera for raytracing, moved along path
+	 * @param path movement of camera
+	 * @param fileName name of files, frame numbers are inserted before extension
+	 * @param parent parent of thread
+	 */
+	AnimationThread(AnimationRenderer * renderer, const RayTracerCam * cam, const CameraPath & path, const QString & fileName, QWidget * parent);
+	
+	/** @brief true if all frames were written.*/
+	bool isSucceeded() const;
+protected:
+	/** @brief http://doc.qt.digia.com/qt/qthread.html#run */
+	void run();
+private:
+	AnimationRenderer * renderer;
+	const RayTracerCam * cam;
+	CameraPath path;
+	QString fileName;
+	bool succeeded;
+};
+
+/** @brief Thread rendering an image in a given time with a BudgetRenderer.*/
+class BudgetThread : public QThread {
+public:
+	/**
+	 * @brief construts a thread with given parameters.
+	 * 
+	 * @param renderer renderer of image, its threads do the rendering
+	 * @param cam camera for raytracing
+	 * @param msecs time of rendering in ms
+	 * @param parent parent of thread
+	 */
+	BudgetThread(BudgetRenderer * renderer, const RayTracerCam * cam, const qint64 msecs, QWidget * parent);
+protected:
+	/** @brief http://doc.qt.digia.com/qt/qthread.html#run */
+	void run();
+private:
+	BudgetRenderer * renderer;
+	const RayTracerCam * cam;
+	qint64 msecs;
+};
+
+/** @brief Thread rendering a rectangle of an image with a RegionRenderer.*/
+class RegionThread : public QThread {
+public:
+	/**
+	 * @brief construts a thread with given parameters.
+	 * 
+	 * @param renderer renderer of rectangle, its threads do the rendering
+	 * @param cam camera for raytracing
+	 * @param region rectangle of image of cam
+	 * @param parent parent of thread
+	 */
+	RegionThread(RegionRenderer * renderer, const RayTracerCam * cam, const QRect & region, QWidget * parent);
+protected:
+	/** @brief http://doc.qt.digia.com/qt/qthread.html#run */
+	void run();
+private:
+	RegionRenderer * renderer;
+	const RayTracerCam * cam;
+	QRect region;
+};
+
 /** @brief Wwidget that manage process of ray tracing and informs user about the status of rendering.*/
 class RayTracingRenderingWidget : public QWidget {
 	Q_OBJECT
@@ -53,7 +157,46 @@ public:
 	 */
 	void render(const RayTracerCam * cam, QImage * img);
 	
-	/** @brief sets number of threads for rendering*/
+	/**
+	 * @brief starts rendering into a file: tiles are written as they are finished, only a few rows of tiles are kept in memory.
+	 * 
+	 * Progress is saved into fileName.checkpoint: if an earlier rendering of the same image was killed, it is continued.
+	 * @param cam camera for raytracing, its primary cache should be disabled
+	 * @param fileName image file, format is given by its extension (see ImageWriter::create())
+	 * @return false if file can not be written
+	 */
+	bool renderToFile(const RayTracerCam * cam, const QString & fileName);
+	
+	/**
+	 * @brief starts rendering each frame of path into its own file (see AnimationRenderer).
+	 * 
+	 * @param cam camera for raytracing: its resolution, angle of view and density are used, position, direction, focus and depth of field are set by path
+	 * @param path movement of camera
+	 * @param fileName name of files, frame numbers are inserted before extension
+	 */
+	void renderAnimation(const RayTracerCam * cam, const CameraPath & path, const QString & fileName);
+	
+	/**
+	 * @brief starts rendering that takes the given time, rays are added to noisy parts of the image until then (see BudgetRenderer).
+	 * 
+	 * Density of camera is not used.
+	 * @param cam camera for raytracing
+	 * @param img QImage that stores result
+	 * @param msecs time of rendering in ms
+	 */
+	void renderTimed(const RayTracerCam * cam, QImage * img, const qint64 msecs);
+	
+	/**
+	 * @brief starts rendering only a rectangle of the image (crop window), with all threads even if it is small (see RegionRenderer).
+	 * 
+	 * Primary cache of camera is not used.
+	 * @param cam camera for raytracing
+	 * @param img QImage that stores result, size of region
+	 * @param region rectangle of image of cam
+	 */
+	void renderRegion(const RayTracerCam * cam, QImage * img, const QRect & region);
+	
+	/** @brief sets number of threads for rendering, it limits the shared thread pool of the whole program as well*/
 	void setNumberofThreads(unsigned int numberofThreads);
 
 signals:
@@ -62,6 +205,11 @@ signals:
 private slots:
 	void stepProgressBar();
 	void threadFinished();
+	void pollProgress();
+	void streamFinished();
+	void animationFinished();
+	void budgetFinished();
+	void regionFinished();
 private:
 	void renderThread(const RayTracerCam * cam, unsigned int starty, unsigned int endy, QImage * img);
 	QProgressBar * progressBar;
@@ -70,7 +218,17 @@ private:
 	unsigned int numberofThreads;
 	unsigned int numberofActiveThreads;
 	QElapsedTimer elapsedTimer;		//to calculate time of rendering
-	
+	QImage * img;
+	TiledRenderer tiledRenderer;
+	StreamingThread * streamingThread;
+	ImageWriter * writer;	//file of streamingThread
+	AnimationRenderer animationRenderer;
+	AnimationThread * animationThread;
+	BudgetRenderer budgetRenderer;
+	BudgetThread * budgetThread;
+	RegionRenderer regionRenderer;
+	RegionThread * regionThread;
+	QTimer progressTimer;	//polls finished rows of tiledRenderer, frames of animationRenderer, time of budgetThread or progress of regionRenderer
 };
 
 #endif
\ No newline at end of file
@@ -1,14 +1,22 @@
 #include "RayTracingSettingsPanel.h"
 
-#include <iostream>
+#include "RayTracing/Log.h"
 
+#include <QHBoxLayout>
 #include <QVBoxLayout>
 #include <QLabel>
+#include <QFileDialog>
+
+namespace {
+	const int MAXRES = 65536;	//largest resolution of spin boxes
+	const qint64 MAXIMAGEPIXELS = 4096*4096;	//larger images are always streamed to a file
+}
 
 RayTracingSettingsPanel::RayTracingSettingsPanel(DetailedSpace3D * space, QWidget * parent) : QFrame(parent) {
 	
 	this->space = space;
 	cam.setSpace(space);
+	streaming = false;
 
 	renderingWidget = new RayTracingRenderingWidget();
 	connect(renderingWidget, SIGNAL(finished()), this, SLOT(renderingFinished()));
@@ -16,6 +24,9 @@ RayTracingSettingsPanel::RayTracingSettingsPanel(DetailedSpace3D * space, QWidge
 	renderButton = new QPushButton("render", this);
 	connect(renderButton, SIGNAL(clicked()), this, SLOT(render()));
 	
+	animationButton = new QPushButton("render animation", this);
+	connect(animationButton, SIGNAL(clicked()), this, SLOT(renderAnimation()));
+	
 	aovSpinBox = new QDoubleSpinBox(this);
 	aovSpinBox->setSingleStep(0.2);
 	aovSpinBox->setValue(1.0);
@@ -26,18 +37,17 @@ RayTracingSettingsPanel::RayTracingSettingsPanel(DetailedSpace3D * space, QWidge
 	
 	xSpinBox = new QSpinBox(this);
 	xSpinBox->setMinimum(1);
-	xSpinBox->setMaximum(2048);
+	xSpinBox->setMaximum(MAXRES);
 	xSpinBox->setValue(640);
 	xSpinBox->setSuffix(" px");
 	connect(xSpinBox, SIGNAL(valueChanged(int)), this, SLOT(setRes()));
 	
 	ySpinBox = new QSpinBox(this);
 	ySpinBox->setMinimum(1);
-	ySpinBox->setMaximum(2048);
+	ySpinBox->setMaximum(MAXRES);
 	ySpinBox->setValue(480);
 	ySpinBox->setSuffix(" px");
 	connect(ySpinBox, SIGNAL(valueChanged(int)), this, SLOT(setRes()));
-	emit(setRes());
 	
 	focusSpinBox = new QDoubleSpinBox(this);
 	focusSpinBox->setSingleStep(0.5);
@@ -60,16 +70,68 @@ RayTracingSettingsPanel::RayTracingSettingsPanel(DetailedSpace3D * space, QWidge
 	connect(densitySpinBox, SIGNAL(valueChanged(double)), this, SLOT(setDensity(double)));
 	emit(setDensity(1.0));
 	
+	projectionComboBox = new QComboBox(this);
+	projectionComboBox->addItem("perspective");	//index is RayTracerCam::Projection
+	projectionComboBox->addItem("panorama (2:1)");
+	projectionComboBox->addItem("cube map (3:2)");
+	connect(projectionComboBox, SIGNAL(currentIndexChanged(int)), this, SLOT(setProjection(int)));
+	
+	budgetSpinBox = new QDoubleSpinBox(this);
+	budgetSpinBox->setSingleStep(1);
+	budgetSpinBox->setMaximum(86400);
+	budgetSpinBox->setSuffix(" s");
+	budgetSpinBox->setSpecialValueText("off (use density)");
+	connect(budgetSpinBox, SIGNAL(valueChanged(double)), this, SLOT(setBudget(double)));
+	
 	threadSpinBox = new QSpinBox(this);
 	threadSpinBox->setMinimum(1);
 	threadSpinBox->setMaximum(1024);
 	threadSpinBox->setValue(2);
 	connect(threadSpinBox, SIGNAL(valueChanged(int)), this, SLOT(setThreadNum(int)));
 	emit(setThreadNum(2));
+	
+	buildComboBox = new QComboBox(this);
+	buildComboBox->addItem("binned SAH");	//index is BoundingHierarchy::BuildMethod
+	buildComboBox->addItem("Morton");
+	connect(buildComboBox, SIGNAL(currentIndexChanged(int)), this, SLOT(setBuildMethod(int)));
+	
+	lazyCheckBox = new QCheckBox("lazy build (fast start)", this);
+	connect(lazyCheckBox, SIGNAL(toggled(bool)), this, SLOT(setLazyBuild(bool)));
+	
+	compressionComboBox = new QComboBox(this);
+	compressionComboBox->addItem("full precision");
+	compressionComboBox->addItem("16 bit boxes");
+	compressionComboBox->addItem("8 bit boxes");
+	connect(compressionComboBox, SIGNAL(currentIndexChanged(int)), this, SLOT(setCompression(int)));
+	
+	cacheCheckBox = new QCheckBox("cache primary hits", this);
+	connect(cacheCheckBox, SIGNAL(toggled(bool)), this, SLOT(setPrimaryCache(bool)));
+	
+	dofPreviewCheckBox = new QCheckBox("DOF preview from depth", this);
+	dofPreviewCheckBox->setEnabled(false);
+	connect(dofPreviewCheckBox, SIGNAL(toggled(bool)), this, SLOT(setDofPreview(bool)));
+	
+	streamCheckBox = new QCheckBox("stream to file (large images)", this);
+	connect(streamCheckBox, SIGNAL(toggled(bool)), this, SLOT(setStream(bool)));
+	emit(setRes());	//after check boxes: large resolutions switch them
+	
+	cropCheckBox = new QCheckBox("render crop window only", this);
+	connect(cropCheckBox, SIGNAL(toggled(bool)), this, SLOT(setCrop(bool)));
+	const int cropDefaults[4] = {0, 0, 64, 64};
+	QHBoxLayout * croplayout = new QHBoxLayout();
+	for(unsigned int i=0; i<4; i++) {
+		cropSpinBoxes[i] = new QSpinBox(this);
+		cropSpinBoxes[i]->setMinimum(i < 2 ? 0 : 1);
+		cropSpinBoxes[i]->setMaximum(MAXRES);
+		cropSpinBoxes[i]->setValue(cropDefaults[i]);
+		croplayout->addWidget(cropSpinBoxes[i]);
+	}
+	emit(setCrop(false));
 
 	QVBoxLayout * panellayout = new QVBoxLayout(this);
 	panellayout->setAlignment(Qt::AlignTop);
 	panellayout->addWidget(renderButton);
+	panellayout->addWidget(animationButton);
 	panellayout->addWidget(new QLabel("AOV:", this));
 	panellayout->addWidget(aovSpinBox);
 	panellayout->addWidget(new QLabel("x resolution:", this));
@@ -82,8 +144,23 @@ RayTracingSettingsPanel::RayTracingSettingsPanel(DetailedSpace3D * space, QWidge
 	panellayout->addWidget(dofSpinBox);
 	panellayout->addWidget(new QLabel("density:", this));
 	panellayout->addWidget(densitySpinBox);
+	panellayout->addWidget(new QLabel("projection:", this));
+	panellayout->addWidget(projectionComboBox);
+	panellayout->addWidget(new QLabel("time budget:", this));
+	panellayout->addWidget(budgetSpinBox);
 	panellayout->addWidget(new QLabel("Number of Threads:", this));
 	panellayout->addWidget(threadSpinBox);
+	panellayout->addWidget(new QLabel("Hierarchy build:", this));
+	panellayout->addWidget(buildComboBox);
+	panellayout->addWidget(lazyCheckBox);
+	panellayout->addWidget(new QLabel("Hierarchy nodes:", this));
+	panellayout->addWidget(compressionComboBox);
+	panellayout->addWidget(cacheCheckBox);
+	panellayout->addWidget(dofPreviewCheckBox);
+	panellayout->addWidget(streamCheckBox);
+	panellayout->addWidget(cropCheckBox);
+	panellayout->addWidget(new QLabel("crop x, y, width, height:", this));
+	panellayout->addLayout(croplayout);
 	
 	setFrameStyle(QFrame::StyledPanel | QFrame::Raised);
 }
@@ -98,22 +175,101 @@ void RayTracingSettingsPanel::setAov(double value) {
 void RayTracingSettingsPanel::setRes() {
 	const int x = xSpinBox->value();
 	const int y = ySpinBox->value();
+	const bool large = (qint64)x*y > MAXIMAGEPIXELS;
+	if(large) streamCheckBox->setChecked(true);	//before setting resolution: disables primary cache
+	streamCheckBox->setEnabled(! large);
 	cam.setRes(x,y);
 }
 void RayTracingSettingsPanel::setFocusDist(double value)	{cam.setFocusDist(value);}
 void RayTracingSettingsPanel::setDOF(double value)			{cam.setDof(value);}
 void RayTracingSettingsPanel::setDensity(double value) 	{cam.setDensity(value);}
+void RayTracingSettingsPanel::setProjection(int index)	{cam.setProjection((RayTracerCam::Projection)index);}
+void RayTracingSettingsPanel::setBudget(double seconds)	{densitySpinBox->setEnabled(seconds <= 0);}
 void RayTracingSettingsPanel::setThreadNum(int value)		{renderingWidget->setNumberofThreads(value);}
+void RayTracingSettingsPanel::setBuildMethod(int index)	{space->setBuildMethod((BoundingHierarchy::BuildMethod)index);}
+void RayTracingSettingsPanel::setLazyBuild(bool lazy)		{space->setLazyBuild(lazy);}
+void RayTracingSettingsPanel::setCompression(int index) {
+	const unsigned int bits[] = {0, 16, 8};	//items of compressionComboBox
+	space->setCompression(bits[index]);
+}
+void RayTracingSettingsPanel::setPrimaryCache(bool enabled) {
+	cam.setPrimaryCache(enabled);
+	dofPreviewCheckBox->setEnabled(enabled);
+}
+void RayTracingSettingsPanel::setDofPreview(bool preview)	{cam.setDofPreview(preview);}
+void RayTracingSettingsPanel::setStream(bool stream) {
+	if(stream) cacheCheckBox->setChecked(false);	//it needs memory for each pixel of image
+	cacheCheckBox->setEnabled(! stream);
+}
+void RayTracingSettingsPanel::setCrop(bool crop) {
+	for(unsigned int i=0; i<4; i++) cropSpinBoxes[i]->setEnabled(crop);
+}
 void RayTracingSettingsPanel::render() {
+	space->build();	//only changed parts are rebuilt
+	LOG_INFO("hierarchy build time: " << space->getBuildTime() << " ms, SAH cost: " << space->getCost());
+	if(space->getTriCount()) LOG_INFO("hierarchy memory: " << (float)space->getMemory() / space->getTriCount() << " bytes/triangle");
+	streaming = streamCheckBox->isChecked();
+	if(streaming) {
+		const QString fileName = QFileDialog::getSaveFileName(this, "Save rendered image", "render.pfm", "Float map (*.pfm);;16 bit pixmap (*.ppm)");
+		if(fileName.isEmpty()) return;
+		if(! renderingWidget->renderToFile(&cam, fileName)) {
+			LOG_CRITICAL("can not write file: " << fileName.toLocal8Bit().constData());
+			return;
+		}
+		setRendering(true);
+		renderingWidget->show();
+		return;
+	}
+	if(cropCheckBox->isChecked()) {
+		const QRect region = QRect(cropSpinBoxes[0]->value(), cropSpinBoxes[1]->value(), cropSpinBoxes[2]->value(), cropSpinBoxes[3]->value())
+			& QRect(0, 0, cam.getXres(), cam.getYres());
+		if(region.isEmpty()) {
+			LOG_CRITICAL("crop window is outside of image");
+			return;
+		}
+		renderedImage = new QImage(region.width(), region.height(), QImage::Format_RGB32);
+		renderingWidget->renderRegion(&cam, renderedImage, region);
+		setRendering(true);
+		renderingWidget->show();
+		return;
+	}
 	renderedImage = new QImage(cam.getXres(), cam.getYres(), QImage::Format_RGB32);
 
-	renderingWidget->render(&cam, renderedImage);
+	if(budgetSpinBox->value() > 0) renderingWidget->renderTimed(&cam, renderedImage, budgetSpinBox->value()*1000);
+	else renderingWidget->render(&cam, renderedImage);
+	setRendering(true);
+	renderingWidget->show();
+}
+void RayTracingSettingsPanel::renderAnimation() {
+	const QString pathName = QFileDialog::getOpenFileName(this, "Open camera path", "", "Camera path (*.txt);;All files (*)");
+	if(pathName.isEmpty()) return;
+	CameraPath path;
+	if(! path.load(pathName) || ! path.getFrameCount()) {
+		LOG_CRITICAL("can not read camera path: " << pathName.toLocal8Bit().constData());
+		return;
+	}
+	const QString fileName = QFileDialog::getSaveFileName(this, "Save frames", "frame.pfm", "Float map (*.pfm);;16 bit pixmap (*.ppm)");
+	if(fileName.isEmpty()) return;
+
+	space->build();	//built once, shared by all frames
+	cacheCheckBox->setChecked(false);	//each frame is seen from a different place
+	streaming = true;
+	renderingWidget->renderAnimation(&cam, path, fileName);
+	setRendering(true);
 	renderingWidget->show();
 }
 void RayTracingSettingsPanel::renderingFinished() {
+	setRendering(false);
 	renderingWidget->hide();
+	if(streaming) return;	//image is in its file
 
 	QLabel * imageLabel = new QLabel();	//TODO: garbage collection
     imageLabel->setPixmap(QPixmap::fromImage(*renderedImage));
 	imageLabel->show();
+}
+//privates:
+void RayTracingSettingsPanel::setRendering(const bool rendering) {
+	//a new render would build the space while threads of the current one walk its hierarchies
+	renderButton->setEnabled(! rendering);
+	animationButton->setEnabled(! rendering);
 }
\ No newline at end of file
@@ -5,6 +5,8 @@
 
 #include <QFrame>
 #include <QPushButton>
+#include <QComboBox>
+#include <QCheckBox>
 #include <QDoubleSpinBox>
 #include <QSpinBox>
 #include <QDoubleSpinBox>
@@ -36,9 +38,19 @@ private slots:
 	void setFocusDist(double value);
 	void setDOF(double value);
 	void setDensity(double value);
+	void setProjection(int index);
+	void setBudget(double seconds);
 	void setThreadNum(int value);
+	void setBuildMethod(int index);
+	void setLazyBuild(bool lazy);
+	void setCompression(int index);
+	void setPrimaryCache(bool enabled);
+	void setDofPreview(bool preview);
+	void setStream(bool stream);
+	void setCrop(bool crop);
 	
 	void render();
+	void renderAnimation();
 	void renderingFinished();
 private:
 	DetailedSpace3D * space;
@@ -48,13 +60,27 @@ private:
 	QImage * renderedImage;
 
 	QPushButton* renderButton;
+	QPushButton* animationButton;
 	QDoubleSpinBox * aovSpinBox;
 	QSpinBox * xSpinBox;
 	QSpinBox * ySpinBox;
 	QDoubleSpinBox * focusSpinBox;
 	QDoubleSpinBox * dofSpinBox;
 	QDoubleSpinBox * densitySpinBox;
+	QComboBox * projectionComboBox;
+	QDoubleSpinBox * budgetSpinBox;
 	QSpinBox * threadSpinBox;
+	QComboBox * buildComboBox;
+	QCheckBox * lazyCheckBox;
+	QComboBox * compressionComboBox;
+	QCheckBox * cacheCheckBox;
+	QCheckBox * dofPreviewCheckBox;
+	QCheckBox * streamCheckBox;
+	QCheckBox * cropCheckBox;
+	QSpinBox * cropSpinBoxes[4];	//x, y, width, height of crop window
+	bool streaming;	//images of current rendering are written to files, not shown
+
+	void setRendering(const bool rendering);	//disables starting an other rendering
 };
 
 #endif
\ No newline at end of file
@@ -0,0 +1,186 @@
+#include "RenderServer.h"
+
+#include <QMutexLocker>
+#include <QRunnable>
+
+#include <algorithm>
+#include <cstdio>
+
+#include "RayTracing/Log.h"
+#include "RayTracing/SceneFile.h"
+
+namespace {
+	const unsigned int TILE = 64;	//width and height of tiles sent to clients
+}
+
+//renders one tile of a job
+class ServerTileTask : public QRunnable {
+public:
+	ServerTileTask(RenderServer & server, RenderServer::Tile * tile) : server(server), tile(tile) {}
+	void run() {server.renderTile(tile);}
+private:
+	RenderServer & server;
+	RenderServer::Tile * tile;
+};
+//--------------------------------------RenderServer----------------------------------------------------------------
+RenderServer::RenderServer(QObject * parent) : QObject(parent) {
+	cacheSize = 4;
+	nextId = 0;
+	connect(&server, SIGNAL(newConnection()), this, SLOT(newConnection()));
+}
+RenderServer::~RenderServer() {
+	for(std::list<Job>::iterator i = jobs.begin(); i != jobs.end(); i++) i->cancelled.fetchAndStoreOrdered(1);
+	tasks.wait();
+	for(unsigned int i=0; i<finished.size(); i++) delete finished[i];
+	for(std::list<Scene>::iterator i = scenes.begin(); i != scenes.end(); i++) delete i->space;
+}
+bool RenderServer::listen(const QString & name) {
+	QLocalServer::removeServer(name);	//socket file left by a killed server
+	return server.listen(name);
+}
+void RenderServer::setCacheSize(const unsigned int scenes) {
+	cacheSize = scenes;
+	evictScenes();
+}
+//private slots:
+void RenderServer::newConnection() {
+	while(QLocalSocket * client = server.nextPendingConnection()) {
+		connect(client, SIGNAL(readyRead()), this, SLOT(readRequests()));
+		connect(client, SIGNAL(disconnected()), this, SLOT(clientDisconnected()));
+	}
+}
+void RenderServer::readRequests() {
+	QLocalSocket * client = (QLocalSocket*)sender();
+	while(client->canReadLine()) {
+		const QByteArray line = client->readLine().trimmed();
+		RenderJob request;
+		if(line.startsWith("render ") && request.parse(line.mid(7))) startJob(client, request);
+		else client->write("error invalid request\n");
+	}
+}
+void RenderServer::clientDisconnected() {
+	QLocalSocket * client = (QLocalSocket*)sender();
+	for(std::list<Job>::iterator i = jobs.begin(); i != jobs.end(); i++) {
+		if(i->client != client) continue;
+		i->client = 0;
+		i->cancelled.fetchAndStoreOrdered(1);	//tiles still queued are skipped
+	}
+	client->deleteLater();
+}
+void RenderServer::sendTiles() {
+	std::vector<Tile*> tiles;
+	{
+		QMutexLocker locker(&lock);
+		tiles.swap(finished);
+	}
+	for(unsigned int i=0; i<tiles.size(); i++) {
+		Tile & tile = *tiles[i];
+		Job & job = *tile.job;
+		char header[96];
+		if(job.client && ! tile.rgb.empty()) {
+			std::sprintf(header, "tile %u %u %u %u %u\n", job.id, tile.x, tile.y, tile.width, tile.height);
+			job.client->write(header);
+			job.client->write((const char*)&tile.rgb[0], tile.rgb.size()*sizeof(float));
+		}
+		delete tiles[i];
+		if(--job.tilesLeft) continue;
+
+		if(job.client) {
+			std::sprintf(header, "done %u\n", job.id);
+			job.client->write(header);
+		}
+		LOG_INFO("job " << job.id << (job.client ? " finished" : " cancelled"));
+		job.scene->jobs--;
+		for(std::list<Job>::iterator j = jobs.begin(); j != jobs.end(); j++) if(&*j == &job) {
+			jobs.erase(j);
+			break;
+		}
+	}
+	evictScenes();
+}
+//privates:
+RenderServer::Scene * RenderServer::getScene(const QString & fileName) {
+	for(std::list<Scene>::iterator i = scenes.begin(); i != scenes.end(); i++) {
+		if(i->fileName != fileName) continue;
+		scenes.splice(scenes.begin(), scenes, i);	//most recently used
+		return &scenes.front();
+	}
+	Scene scene;
+	scene.fileName = fileName;
+	scene.space = new DetailedSpace3D();
+	scene.jobs = 0;
+	if(! SceneFile::load(fileName, *scene.space)) {
+		delete scene.space;
+		return 0;
+	}
+	scene.space->finalize();	//built once, used by all jobs of scene
+	LOG_INFO("scene loaded: " << fileName.toLocal8Bit().constData() << ", " << scene.space->getTriCount() << " triangles");
+	scenes.push_front(scene);
+	return &scenes.front();
+}
+void RenderServer::evictScenes() {
+	std::list<Scene>::iterator i = scenes.end();
+	while(scenes.size() > cacheSize && i != scenes.begin()) {
+		i--;
+		if(i->jobs) continue;	//in use: older unused scenes go first
+		LOG_INFO("scene dropped: " << i->fileName.toLocal8Bit().constData());
+		delete i->space;
+		i = scenes.erase(i);
+	}
+}
+void RenderServer::startJob(QLocalSocket * client, const RenderJob & request) {
+	Scene * scene = getScene(request.getScene());
+	if(! scene) {
+		client->write("error can not load scene\n");
+		return;
+	}
+	scene->jobs++;
+	evictScenes();	//a new scene may have filled the cache
+	Job job;
+	job.id = nextId++;
+	job.client = client;
+	job.cancelled.fetchAndStoreOrdered(0);
+	job.scene = scene;
+	job.cam = request.getCam();
+	job.cam.setSpace(scene->space);
+	const unsigned int width = job.cam.getXres();
+	const unsigned int height = job.cam.getYres();
+	job.tilesLeft = ((width + TILE-1) / TILE) * ((height + TILE-1) / TILE);
+	jobs.push_back(job);
+	Job * stored = &jobs.back();
+
+	char answer[32];
+	std::sprintf(answer, "job %u\n", stored->id);
+	client->write(answer);
+	for(unsigned int y=0; y<height; y+=TILE) {
+		for(unsigned int x=0; x<width; x+=TILE) {
+			Tile * tile = new Tile();
+			tile->job = stored;
+			tile->x = x;
+			tile->y = y;
+			tile->width = std::min(TILE, width - x);
+			tile->height = std::min(TILE, height - y);
+			tasks.start(new ServerTileTask(*this, tile), request.getPriority());
+		}
+	}
+}
+void RenderServer::renderTile(Tile * tile) {
+	Job & job = *tile->job;
+	if(! job.cancelled.fetchAndAddOrdered(0)) {
+		const int width = job.cam.getXres();
+		const int height = job.cam.getYres();
+		tile->rgb.resize(tile->width*tile->height*3);
+		float * out = &tile->rgb[0];
+		for(unsigned int y=tile->y; y<tile->y+tile->height; y++) {
+			for(unsigned int x=tile->x; x<tile->x+tile->width; x++) {
+				const Color c = job.cam.calcColor((int)x - width/2, height/2 - (int)y);
+				*out++ = c.getR();
+				*out++ = c.getG();
+				*out++ = c.getB();
+			}
+		}
+	}
+	QMutexLocker locker(&lock);
+	finished.push_back(tile);
+	if(finished.size() == 1) QMetaObject::invokeMethod(this, "sendTiles", Qt::QueuedConnection);	//one call sends all tiles finished until then
+}
@@ -0,0 +1,87 @@
+/** @file RenderServer.h @brief long running rendering service for other processes*/
+
+#ifndef RENDERSERVER_H
+#define RENDERSERVER_H
+
+#include <QObject>
+#include <QAtomicInt>
+#include <QLocalServer>
+#include <QLocalSocket>
+#include <QMutex>
+
+#include <list>
+#include <vector>
+
+#include "RayTracing/RenderJob.h"
+#include "RayTracing/TaskGroup.h"
+
+/**
+ * @brief Renders jobs sent through a local socket, keeping loaded scenes in memory.
+ *
+ * Protocol is line based. Client sends "render <job>" lines (see RenderJob::toLine()), server answers:
+ * - "job <id>" when job is accepted, or "error <message>"
+ * - "tile <id> <x> <y> <width> <height>" for each finished tile, followed by width*height RGB pixels as 32 bit floats (byte order of server), rows from top to bottom
+ * - "done <id>" after the last tile of a job
+ *
+ * Scenes (SceneFile names) are loaded and built when a job first needs them, the least recently used ones are dropped when there are more than the cache size.
+ * Tiles of all jobs are rendered by the shared thread pool (TaskGroup), tiles of jobs with higher priority first. Jobs of a disconnected client are cancelled.
+ */
+class RenderServer : public QObject {
+	Q_OBJECT
+public:
+	/** @brief Constructs a server that doesn't listen yet, with a cache of 4 scenes.*/
+	RenderServer(QObject * parent = 0);
+
+	/** @brief Waits for tiles being rendered, frees scenes.*/
+	~RenderServer();
+
+	/** @brief Starts accepting clients on local socket of given name, false if it is not possible.*/
+	bool listen(const QString & name);
+
+	/** @brief Sets number of scenes kept in memory. Scenes of unfinished jobs are kept even if there are more.*/
+	void setCacheSize(const unsigned int scenes);
+private slots:
+	void newConnection();
+	void readRequests();
+	void clientDisconnected();
+	void sendTiles();
+private:
+	struct Scene {
+		QString fileName;
+		DetailedSpace3D * space;
+		unsigned int jobs;	//unfinished jobs using scene
+	};
+	struct Job {
+		unsigned int id;
+		QLocalSocket * client;	//0 if client disconnected
+		QAtomicInt cancelled;	//client disconnected: read by threads of pool
+		Scene * scene;
+		RayTracerCam cam;
+		unsigned int tilesLeft;
+	};
+	struct Tile {
+		Job * job;
+		unsigned int x, y, width, height;
+		std::vector<float> rgb;	//empty if job was cancelled
+	};
+
+	QLocalServer server;
+	unsigned int cacheSize;
+	std::list<Scene> scenes;	//most recently used first
+	std::list<Job> jobs;
+	unsigned int nextId;
+	TaskGroup tasks;
+	QMutex lock;
+	std::vector<Tile*> finished;	//tiles rendered but not sent, protected by lock
+
+	friend class ServerTileTask;
+	Scene * getScene(const QString & fileName);	//loads scene if it is not in cache, 0 if it can not be loaded
+	void evictScenes();	//drops least recently used scenes over cacheSize
+	void startJob(QLocalSocket * client, const RenderJob & request);
+	void renderTile(Tile * tile);	//called by threads of pool
+
+	RenderServer(const RenderServer &);	//tasks refer to server
+	void operator=(const RenderServer &);
+};
+
+#endif
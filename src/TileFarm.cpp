@@ -0,0 +1,196 @@
+#include "TileFarm.h"
+
+#include <QCoreApplication>
+#include <QStringList>
+
+#include <algorithm>
+#include <cstdio>
+#include <limits>
+
+#include "RayTracing/ImageWriter.h"
+#include "RayTracing/Log.h"
+#include "RayTracing/SceneFile.h"
+
+namespace {
+	const unsigned int PREFETCH = 2;	//tiles sent to a worker at once: next one is waiting while it reports the previous
+}
+//--------------------------------------TileFarm----------------------------------------------------------------
+TileFarm::TileFarm(QObject * parent) : QObject(parent) {
+	workerCount = 2;
+	tileSize = 64;
+	tileCount = 0;
+	finishedTiles = 0;
+	succeeded = false;
+}
+TileFarm::~TileFarm() {
+	for(unsigned int i=0; i<workers.size(); i++) {
+		QProcess * process = workers[i].process;
+		if(! process) continue;
+		disconnect(process, 0, this, 0);
+		process->kill();
+		process->waitForFinished();
+	}
+}
+void TileFarm::setWorkers(const unsigned int workers)	{workerCount = std::max(workers, 1u);}
+void TileFarm::setTileSize(const unsigned int size)		{tileSize = std::max(size, 1u);}
+bool TileFarm::start(const RenderJob & job, const QString & fileName) {
+	this->job = job;
+	this->fileName = fileName;
+	succeeded = false;
+	const unsigned int width = job.getCam().getXres();
+	const unsigned int height = job.getCam().getYres();
+	const unsigned int tilesX = (width + tileSize-1) / tileSize;
+	tileCount = tilesX * ((height + tileSize-1) / tileSize);
+	finishedTiles = 0;
+
+	memory.setKey(QString("RayTracerFarm%1").arg(QCoreApplication::applicationPid()));
+	const qint64 bytes = frameBytes(width, height);
+	if(bytes > std::numeric_limits<int>::max()) {
+		LOG_CRITICAL("tile farm: frame of " << bytes << " bytes does not fit into shared memory");
+		return false;
+	}
+	if(! memory.create(bytes)) return false;
+	FrameHeader & header = *(FrameHeader*)memory.data();
+	header.width = width;
+	header.height = height;
+	header.tileSize = tileSize;
+
+	pending.clear();
+	for(unsigned int i=0; i<tileCount; i++) pending.push_back(i);
+	timer.start();
+	workers.resize(workerCount);
+	const QStringList arguments = QStringList() << "--worker" << memory.key() << QString::fromLocal8Bit(job.toLine().constData());
+	for(unsigned int i=0; i<workers.size(); i++) {
+		Worker & worker = workers[i];
+		worker.tiles.clear();
+		worker.process = new QProcess(this);
+		connect(worker.process, SIGNAL(readyReadStandardOutput()), this, SLOT(readResults()));
+		connect(worker.process, SIGNAL(finished(int, QProcess::ExitStatus)), this, SLOT(workerFinished()));
+		connect(worker.process, SIGNAL(error(QProcess::ProcessError)), this, SLOT(workerFinished()));
+		worker.process->start(QCoreApplication::applicationFilePath(), arguments);
+		assign(worker);	//written when process is started
+	}
+	LOG_INFO("tile farm: " << tileCount << " tiles, " << workerCount << " workers");
+	return true;
+}
+bool TileFarm::isSucceeded() const	{return succeeded;}
+int TileFarm::runWorker(const QString & key, const QByteArray & line) {
+	RenderJob job;
+	if(! job.parse(line)) return 1;
+	DetailedSpace3D space;
+	if(! SceneFile::load(job.getScene(), space)) return 1;
+	space.finalize();
+	RayTracerCam cam = job.getCam();
+	cam.setSpace(&space);
+
+	QSharedMemory memory(key);
+	if(! memory.attach()) return 1;
+	const FrameHeader header = *(const FrameHeader*)memory.constData();
+	const int width = cam.getXres();
+	const int height = cam.getYres();
+	if((int)header.width != width || (int)header.height != height || ! header.tileSize) return 1;
+	if(memory.size() < frameBytes(width, height)) return 1;	//tiles would be written past its end
+	float * pixels = (float*)((char*)memory.data() + sizeof(FrameHeader));
+	const unsigned int tilesX = (width + header.tileSize-1) / header.tileSize;
+
+	char text[64];
+	while(std::fgets(text, sizeof(text), stdin)) {
+		unsigned int tile;
+		if(std::sscanf(text, "tile %u", &tile) != 1) continue;
+		const int x0 = (tile % tilesX) * header.tileSize;
+		const int y0 = (tile / tilesX) * header.tileSize;
+		const int x1 = std::min(x0 + (int)header.tileSize, width);
+		const int y1 = std::min(y0 + (int)header.tileSize, height);
+		for(int y=y0; y<y1; y++) {
+			float * out = pixels + ((qint64)y*width + x0)*3;	//straight into the framebuffer of coordinator
+			for(int x=x0; x<x1; x++) {
+				const Color c = cam.calcColor(x - width/2, height/2 - y);
+				*out++ = c.getR();
+				*out++ = c.getG();
+				*out++ = c.getB();
+			}
+		}
+		std::printf("done %u\n", tile);
+		std::fflush(stdout);
+	}
+	memory.detach();
+	return 0;
+}
+//private slots:
+void TileFarm::readResults() {
+	Worker * worker = findWorker(sender());
+	if(! worker) return;
+	while(worker->process->canReadLine()) {
+		unsigned int tile;
+		if(std::sscanf(worker->process->readLine().constData(), "done %u", &tile) != 1) continue;
+		std::vector<unsigned int>::iterator i = std::find(worker->tiles.begin(), worker->tiles.end(), tile);
+		if(i == worker->tiles.end()) continue;
+		worker->tiles.erase(i);
+		if(++finishedTiles == tileCount) {
+			finish(true);
+			return;
+		}
+	}
+	assign(*worker);
+}
+void TileFarm::workerFinished() {
+	Worker * worker = findWorker(sender());
+	if(! worker) return;	//error and finished can both come
+	QProcess * process = worker->process;
+	if(process->state() != QProcess::NotRunning) return;	//error while running: finished comes later
+	LOG_WARNING("tile farm: worker died, " << (unsigned int)worker->tiles.size() << " tiles are given to others");
+	for(unsigned int i=0; i<worker->tiles.size(); i++) pending.push_front(worker->tiles[i]);
+	worker->tiles.clear();
+	worker->process = 0;
+	disconnect(process, 0, this, 0);
+	process->deleteLater();
+
+	bool alive = false;
+	for(unsigned int i=0; i<workers.size(); i++) {
+		if(! workers[i].process) continue;
+		alive = true;
+		assign(workers[i]);
+	}
+	if(! alive) finish(false);
+}
+//privates:
+TileFarm::Worker * TileFarm::findWorker(const QObject * process) {
+	for(unsigned int i=0; i<workers.size(); i++) if(workers[i].process && workers[i].process == process) return &workers[i];
+	return 0;
+}
+void TileFarm::assign(Worker & worker) {
+	char text[32];
+	while(worker.tiles.size() < PREFETCH && ! pending.empty()) {
+		const unsigned int tile = pending.front();
+		pending.pop_front();
+		worker.tiles.push_back(tile);
+		std::sprintf(text, "tile %u\n", tile);
+		worker.process->write(text);
+	}
+}
+void TileFarm::finish(const bool ok) {
+	for(unsigned int i=0; i<workers.size(); i++) {
+		QProcess * process = workers[i].process;
+		if(! process) continue;
+		disconnect(process, 0, this, 0);
+		process->closeWriteChannel();	//worker exits after its last tile
+		process->waitForFinished();
+		process->deleteLater();
+		workers[i].process = 0;
+	}
+	if(ok) {
+		const float * pixels = (const float*)((const char*)memory.constData() + sizeof(FrameHeader));
+		ImageWriter * writer = ImageWriter::create(fileName);
+		succeeded = writer->open(fileName, job.getCam().getXres(), job.getCam().getYres())
+			&& writer->writeRows(pixels, job.getCam().getYres())
+			&& writer->close();
+		delete writer;
+	}
+	if(succeeded) LOG_INFO("tile farm rendering time: " << timer.elapsed() << " ms");
+	else LOG_CRITICAL("tile farm rendering failed");
+	memory.detach();
+	emit(finished());
+}
+qint64 TileFarm::frameBytes(const unsigned int width, const unsigned int height) {
+	return sizeof(FrameHeader) + (qint64)width*height*3*sizeof(float);
+}
@@ -0,0 +1,92 @@
+/** @file TileFarm.h @brief rendering one image with several worker processes*/
+
+#ifndef TILEFARM_H
+#define TILEFARM_H
+
+#include <QObject>
+#include <QElapsedTimer>
+#include <QProcess>
+#include <QSharedMemory>
+
+#include <deque>
+#include <vector>
+
+#include "RayTracing/RenderJob.h"
+
+/**
+ * @brief Coordinator that splits the image of a RenderJob into tiles and hands them out to worker processes.
+ *
+ * Workers are this program started with "--worker <key> <job>" (see runWorker()): each one loads the scene file itself and renders the tiles it gets into a shared memory framebuffer,
+ * so pixels are never copied between processes. Tiles are sent on the standard input of workers ("tile <index>" lines), finished tiles are reported on their standard output ("done <index>").
+ * If a worker dies, its unfinished tiles are given to the others. When all tiles are done, the framebuffer is written to the image file.
+ */
+class TileFarm : public QObject {
+	Q_OBJECT
+public:
+	/** @brief Constructs a coordinator of 2 workers and 64 pixel tiles.*/
+	TileFarm(QObject * parent = 0);
+
+	/** @brief Stops workers.*/
+	~TileFarm();
+
+	/** @brief Setter for number of worker processes.*/
+	void setWorkers(const unsigned int workers);
+
+	/** @brief Setter for width and height of tiles in pixels.*/
+	void setTileSize(const unsigned int size);
+
+	/**
+	 * @brief Starts workers, returns at once: finished() is emitted when image is written or rendering failed.
+	 *
+	 * @param job scene and camera of image
+	 * @param fileName image file, format is given by its extension (see ImageWriter::create())
+	 * @return false if shared memory can not be created, e.g. frame is larger than 2 GB (QSharedMemory has an int size)
+	 */
+	bool start(const RenderJob & job, const QString & fileName);
+
+	/** @brief True if image of last start() is written.*/
+	bool isSucceeded() const;
+
+	/**
+	 * @brief Main function of a worker process: renders tiles given on standard input until it is closed.
+	 *
+	 * @param key key of shared memory of coordinator
+	 * @param job line of RenderJob
+	 * @return exit code of process, 0 on success
+	 */
+	static int runWorker(const QString & key, const QByteArray & job);
+signals:
+	/** @brief emited when image is written or rendering failed*/
+	void finished();
+private slots:
+	void readResults();
+	void workerFinished();
+private:
+	//beginning of shared memory, followed by width*height RGB floats
+	struct FrameHeader {
+		unsigned int width, height, tileSize;
+	};
+	struct Worker {
+		QProcess * process;	//0 after it died
+		std::vector<unsigned int> tiles;	//sent, not finished
+	};
+
+	unsigned int workerCount;
+	unsigned int tileSize;
+	RenderJob job;
+	QString fileName;
+	QSharedMemory memory;
+	std::vector<Worker> workers;
+	std::deque<unsigned int> pending;	//tiles not sent to any worker
+	unsigned int tileCount;
+	unsigned int finishedTiles;
+	bool succeeded;
+	QElapsedTimer timer;
+
+	Worker * findWorker(const QObject * process);
+	void assign(Worker & worker);	//sends pending tiles until worker has enough
+	void finish(const bool ok);
+	static qint64 frameBytes(const unsigned int width, const unsigned int height);	//size of shared memory of a frame
+};
+
+#endif
@@ -1,14 +1,60 @@
 #include "VectorCamWidget.h"
 
+#include <QElapsedTimer>
+#include <QImage>
+#include <QRunnable>
+#include <algorithm>
 #include <cmath>
 #include <iostream>
 
+#include "RayTracing/TaskGroup.h"
+
+namespace {
+	const int FRAMETIME = 33;	//ms: target time of a frame while moving (30 fps)
+	const int STOPDELAY = 150;	//ms: camera is stopped if it didn't move for this long
+	const unsigned int MAXSCALE = 8;	//largest traced pixel while moving
+	const int ROWSPERTASK = 8;	//rows traced by one task
+
+	//traces a band of rows of the preview, unless the frame is already over its time
+	class TraceRowsTask : public QRunnable {
+	public:
+		TraceRowsTask(const RayTracerCam & cam, QImage & img, const int starty, const int endy, const QElapsedTimer & timer, const qint64 budget) : cam(cam), img(img), starty(starty), endy(endy), timer(timer), budget(budget) {}
+		void run() {
+			if(budget >= 0 && timer.elapsed() > budget) return;	//rows keep the previous frame
+			const int resx = img.width();
+			const int resy = img.height();
+			for(int y=starty; y<endy; y++) {
+				QRgb * line = (QRgb*)img.scanLine(y);
+				for(int x=0; x<resx; x++) line[x] = RayTracingThread::toQColor(cam.calcColor(x - resx/2, resy/2-y)).rgb();
+			}
+		}
+	private:
+		const RayTracerCam & cam;
+		QImage & img;
+		const int starty, endy;
+		const QElapsedTimer & timer;	//started when frame started
+		const qint64 budget;	//ms, negative: no limit
+	};
+}
+
 VectorCamWidget::VectorCamWidget(DetailedSpace3D * space, QWidget * parent) : QFrame(parent) {
 	this->space = space;
 
 	cam.setPos(Vect3D(0,0,40));
 	cam.setSpace(space);
 	rotStep.set(M_PI/1440);
+	
+	traced = false;
+	wireframe = false;
+	traceCam.setSpace(space);
+	traceCam.setDof(0);	//pinhole: each pixel is its primary hit
+	traceCam.setDensity(1);
+	traceScale = 1;
+	moveScale = 4;
+	refineTimer.setSingleShot(true);
+	connect(&refineTimer, SIGNAL(timeout()), this, SLOT(refine()));
+	traceCam.setPrimaryCache(true);
+	traceCam.setReprojection(true);
 
 	setFocusPolicy(Qt::StrongFocus);	//to make keyboard visible
 	setFrameStyle(QFrame::StyledPanel | QFrame::Sunken);
@@ -23,8 +69,17 @@ void VectorCamWidget::paintEvent(QPaintEvent* evt) {
 	cam.setHVDir(rot);
 	cam.setRes(width(), height());
 
-	drawer.set(size());
-	drawer.draw(painter, cam.project());
+	if(traced) paintTraced(painter);
+	else if(wireframe) {
+		drawer.set(size());
+		cam.project(projected);
+		drawer.draw(painter, projected);
+	} else {
+		if(frame.size() != size()) frame = QImage(size(), QImage::Format_RGB32);
+		cam.project(projected);
+		rasterizer.draw(projected, (unsigned int*)frame.bits(), frame.width(), frame.height(), frame.bytesPerLine());
+		painter.drawImage(0,0, frame);
+	}
 	painter.drawEllipse(width()/2-5, height()/2-5, 10, 10);
 
 	QFrame::paintEvent(evt);		//frame is not visible othervise
@@ -39,6 +94,7 @@ void VectorCamWidget::mouseMoveEvent(QMouseEvent* evt) {
 
 	rot.rotLon(rotStep*mx);
 	rot.rotLat(rotStep*my);
+	moved();
 	repaint();
 	emit(changedCameraHVDir(cam.getHdir(),cam.getVdir(),cam.getDir()));
 }
@@ -50,19 +106,63 @@ void VectorCamWidget::keyPressEvent(QKeyEvent *evt) {
 		case Qt::Key_D: cam.stepPos(1,0,0); break;
 		case Qt::Key_Y: rot.rotTwi(rotStep*(-1)); break;
 		case Qt::Key_X: rot.rotTwi(rotStep); break;
+		case Qt::Key_T: traced = ! traced; break;
+		case Qt::Key_F: wireframe = ! wireframe; break;
 		default: return;
 	}
+	moved();
 	repaint();
 	emit(changedCameraPos(cam.getPos()));
 }
 void VectorCamWidget::wheelEvent(QWheelEvent* evt) {
 	float v = evt->delta()/100;
 	cam.stepPos(0,0,v);
+	moved();
 	repaint();
 	emit(changedCameraPos(cam.getPos()));
 }
 
 void VectorCamWidget::changeCameraAov(double value) {
 	cam.setAov(value);
+	moved();
+	repaint();
+}
+//privates:
+void VectorCamWidget::refine() {
+	if(! traced || traceScale <= 1) return;
+	traceScale /= 2;
 	repaint();
-}
\ No newline at end of file
+	if(traceScale > 1) refineTimer.start(0);	//next step after pending events: a move stops refining
+}
+void VectorCamWidget::paintTraced(QPainter & painter) {
+	traceCam.setRes(std::max(1, cam.getXres() / (int)traceScale), std::max(1, cam.getYres() / (int)traceScale));
+	traceCam.setAov(cam.getAov());
+	traceCam.setPos(cam.getPos());
+	traceCam.setHVDir(cam.getHdir(), cam.getVdir(), cam.getDir());
+	traceCam.updatePrimaryCache();	//only pixels without a reprojected hit are traced
+
+	QElapsedTimer timer;
+	timer.start();
+	const int resx = traceCam.getXres();
+	const int resy = traceCam.getYres();
+	//while moving, bands that would start after the time of a frame are not traced: they show the previous frame
+	const bool moving = refineTimer.isActive() && traceScale == moveScale;
+	QImage img = lastTraced.isNull() ? QImage(resx, resy, QImage::Format_RGB32) : lastTraced.scaled(resx, resy);
+	img.bits();	//detaches from lastTraced before threads write its rows
+	TaskGroup group;	//waiting for the whole pool would wait for background rebuilds too
+	for(int y=0; y<resy; y+=ROWSPERTASK) group.start(new TraceRowsTask(traceCam, img, y, std::min(y+ROWSPERTASK, resy), timer, moving ? FRAMETIME : -1));
+	group.wait();
+	painter.drawImage(rect(), img);
+	lastTraced = img;
+
+	//while moving: pixels get 2x bigger if frame was too slow, 2x smaller if even 4x more pixels would fit in time
+	if(moving) {
+		const qint64 elapsed = timer.elapsed();
+		if(elapsed > FRAMETIME && moveScale < MAXSCALE) moveScale *= 2;
+		else if(elapsed*4 < FRAMETIME*3/4 && moveScale > 1) moveScale /= 2;
+	}
+}
+void VectorCamWidget::moved() {
+	traceScale = moveScale;
+	refineTimer.start(STOPDELAY);
+}
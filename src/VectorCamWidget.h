@@ -5,15 +5,20 @@
 
 #include <QFrame>
 #include <QKeyEvent>
+#include <QTimer>
 
 #include "Space2DDrawer.h"
+#include "RayTracingRenderingWidget.h"
 
 #include "RayTracing/Camera.h"
+#include "RayTracing/Rasterizer.h"
 
 /**
  * @brief Widget showing image of -, and controlling a VectorCam.
  * 
  * Changing position of camera: using keyboard and mouse: W,A,S,D => moving camera in space up,left,down,right. Pressing a mouse button and moving mouse => rotation of camera. Using mouse wheel => moving camera forward and backwards. These changes are communicated via signals.
+ * Triangles are drawn by a Rasterizer with depth test and flat shading, F switches to drawing only their borders. T switches to a ray traced view. The ray traced view reprojects the previous frame into the new pose, so only pixels that came into view are traced while moving.
+ * While the camera moves, the ray traced view is rendered at 1/2..1/8 resolution with 1 ray per pixel: the resolution adapts to the speed of the machine to keep about 30 frames per second, and rows that a slow frame has no time for show the previous frame. Once the camera stops, the image is refined step by step to full resolution.
  */
 class VectorCamWidget : public QFrame {
 	Q_OBJECT
@@ -25,7 +30,7 @@ public:
 	void emitCamDetails();
 protected:
 	/**
-	 * @brief Draws borders of triangles.
+	 * @brief Draws triangles (filled, borders or ray traced).
 	 * 
 	 * More information: http://qt-project.org/doc/qt-4.8/qwidget.html#paintEvent
 	 */
@@ -54,6 +59,8 @@ protected:
 	 * A: move camera left<br/>
 	 * S: move camera right<br/>
 	 * D: move camera down<br/>
+	 * T: switch ray traced view on/off<br/>
+	 * F: switch between filled triangles and borders<br/>
 	 * http://qt-project.org/doc/qt-4.8/qwidget.html#keyPressEvent
 	 */
 	void keyPressEvent(QKeyEvent *evt);
@@ -75,10 +82,24 @@ signals:
 public slots:
 	/** @brief Slot for changing Angle of View of camera*/
 	void changeCameraAov(double value);
+private slots:
+	void refine();	//halves pixel size of ray traced view while camera doesn't move
 private:
 	DetailedSpace3D * space;
 	GeoRot3D rot;
 	VectorCam cam;
+	RayTracerCam traceCam;	//ray traced view, keeps its last frame for reprojection
+	bool traced;	//ray traced view is shown
+	unsigned int traceScale;	//size of a traced pixel on screen
+	unsigned int moveScale;	//pixel size while camera moves, adapted to frame time
+	QTimer refineTimer;	//fires when camera stopped moving, then for each refining step
+	QImage lastTraced;	//previous ray traced frame, shown where a late frame has no time to trace
+	void paintTraced(QPainter & painter);
+	void moved();	//camera was moved by user
+	bool wireframe;	//only borders of triangles are drawn
+	Rasterizer rasterizer;
+	QImage frame;	//image of rasterizer, kept between frames
+	DetailedSpace2D projected;	//triangles of last frame, memory is reused by next one
 
 	Space2DDrawer drawer;
 	QPoint mouseTracer;		//variable for calculating movement of mouse
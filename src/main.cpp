@@ -1,15 +1,51 @@
 #include <QApplication>
+#include <QThreadPool>
 
 #include <iostream>
 #include <cmath>
+#include <cstdlib>
+#include <cstring>
 
 #include "RayTracing/Space2D.h"
 #include "RayTracing/Space3D.h"
 #include "RayTracing/Camera.h"
+#include "RayTracing/Log.h"
+#include "RenderServer.h"
+#include "TileFarm.h"
 #include "SceneSetterWidget.h"
 
 int main(int argc, char *argv[])
 {
+	if(argc >= 3 && ! std::strcmp(argv[1], "--server")) {	//--server <socket name> [threads] [cached scenes]: render service, no window
+		QCoreApplication app(argc, argv);
+		RenderServer server;
+		if(argc >= 4 && std::atoi(argv[3]) > 0) QThreadPool::globalInstance()->setMaxThreadCount(std::atoi(argv[3]));	//all parallel work runs on this pool
+		if(argc >= 5) server.setCacheSize(std::atoi(argv[4]));
+		if(! server.listen(argv[2])) {
+			LOG_CRITICAL("can not listen on " << argv[2]);
+			Log::flush();
+			return 1;
+		}
+		LOG_INFO("render server listening on " << argv[2]);
+		return app.exec();
+	}
+	if(argc >= 4 && ! std::strcmp(argv[1], "--worker")) return TileFarm::runWorker(argv[2], argv[3]);	//started by --farm
+	if(argc >= 5 && ! std::strcmp(argv[1], "--farm")) {	//--farm <workers> <image file> "<job line>": one image rendered by worker processes
+		QCoreApplication app(argc, argv);
+		RenderJob job;
+		TileFarm farm;
+		farm.setWorkers(std::atoi(argv[2]));
+		QObject::connect(&farm, SIGNAL(finished()), &app, SLOT(quit()));
+		if(! job.parse(argv[4]) || ! farm.start(job, argv[3])) {
+			LOG_CRITICAL("can not start tile farm");
+			Log::flush();
+			return 1;
+		}
+		app.exec();
+		Log::flush();
+		return farm.isSucceeded() ? 0 : 1;
+	}
+	
 	/*GeoRot3D rot;
 	rot.rotTwi(Rot2D(M_PI/4));
 	
@@ -32,6 +68,7 @@ int main(int argc, char *argv[])
 	space.push_back(bob);
 	space.push_back(joe);
 	space.push_back(sue);
+	space.finalize();	//scene is complete: triangles are laid out for the hierarchies
 
 	QApplication app(argc, argv);
 	SceneSetterWidget* window = new SceneSetterWidget(&space);